@@ -0,0 +1,76 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/benchmark/wallet_benchmark.h"
+
+#include "wallet/benchmark/wallet_benchmark_common.h"
+#include "wallet/benchmark/wallet_benchmark_functions.h"
+#include "wallet/benchmark/wallet_benchmark_scroll.h"
+#include "wallet/wallet_backend_fake.h"
+
+#include <QtCore/QFile>
+
+namespace Wallet::Benchmark {
+namespace {
+
+constexpr auto kDefaultBatches = 200;
+
+[[nodiscard]] QString Value(
+		const QStringList &arguments,
+		const QString &name) {
+	const auto index = arguments.indexOf(name);
+	return (index >= 0 && index + 1 < arguments.size())
+		? arguments[index + 1]
+		: QString();
+}
+
+[[nodiscard]] bool Write(const QString &path, const QByteArray &data) {
+	auto file = QFile(path);
+	const auto opened = path.isEmpty()
+		? file.open(stdout, QIODevice::WriteOnly)
+		: file.open(QIODevice::WriteOnly);
+	return opened && (file.write(data) == data.size());
+}
+
+} // namespace
+
+int Run(const QStringList &arguments) {
+	auto config = FakeConfig();
+	if (const auto count = Value(arguments, "-transactions").toInt()) {
+		config.transactions = count;
+	}
+	if (const auto seed = Value(arguments, "-seed").toUInt()) {
+		config.seed = seed;
+	}
+
+	auto report = Report();
+	if (arguments.contains("-scroll")) {
+		const auto path = Value(arguments, "-events");
+		auto events = DefaultScrollEvents();
+		if (!path.isEmpty()) {
+			auto file = QFile(path);
+			if (!file.open(QIODevice::ReadOnly)) {
+				return 1;
+			}
+			const auto parsed = ParseScrollEvents(file.readAll());
+			if (!parsed) {
+				return 1;
+			}
+			events = *parsed;
+		}
+		RunScrollReplay(events, config, &report);
+	}
+	if (arguments.contains("-functions")) {
+		const auto batches = Value(arguments, "-batches").toInt();
+		RunFunctions(
+			config.seed,
+			(batches > 0) ? batches : kDefaultBatches,
+			&report);
+	}
+	return Write(Value(arguments, "-output"), report.serialize()) ? 0 : 1;
+}
+
+} // namespace Wallet::Benchmark
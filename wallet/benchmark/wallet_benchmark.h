@@ -0,0 +1,24 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+namespace Wallet::Benchmark {
+
+// Entry point of the wallet_benchmark executable, called once the
+// application and its integrations are set up with QT_QPA_PLATFORM set to
+// "offscreen" by default. Prints the report and returns the exit code.
+//
+//   -scroll                 replay scroll, resize, hover and decrypt events
+//   -events <path>          events to replay instead of the default ones
+//   -transactions <count>   size of the synthetic history
+//   -functions              measure the hot functions one by one
+//   -batches <count>        batches of calls for each measured function
+//   -seed <number>          seed of the synthetic history and inputs
+//   -output <path>          write the report to a file instead of stdout
+[[nodiscard]] int Run(const QStringList &arguments);
+
+} // namespace Wallet::Benchmark
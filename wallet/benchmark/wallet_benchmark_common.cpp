@@ -0,0 +1,118 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/benchmark/wallet_benchmark_common.h"
+
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Counted per thread, the measured code runs on the main thread while
+// the crl workers prepare rows and read files in the background.
+thread_local int64 AllocationsCount = 0;
+std::atomic<const void*> KeptValue = nullptr;
+
+} // namespace
+
+void *operator new(std::size_t size) {
+	++AllocationsCount;
+	if (const auto result = std::malloc(size ? size : 1)) {
+		return result;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t size) noexcept {
+	std::free(pointer);
+}
+
+namespace Wallet::Benchmark {
+namespace {
+
+[[nodiscard]] int64 Percentile(const std::vector<int64> &sorted, int p) {
+	Expects(!sorted.empty());
+
+	const auto index = (int64(sorted.size()) - 1) * p / 100;
+	return sorted[index];
+}
+
+} // namespace
+
+int64 Now() {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(
+		steady_clock::now().time_since_epoch()).count();
+}
+
+int64 NowNanoseconds() {
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(
+		steady_clock::now().time_since_epoch()).count();
+}
+
+void Keep(const void *value) {
+	KeptValue.store(value, std::memory_order_relaxed);
+}
+
+int64 Allocations() {
+	return AllocationsCount;
+}
+
+void Report::add(
+		const QString &name,
+		const QString &unit,
+		std::vector<int64> values) {
+	if (values.empty()) {
+		return;
+	}
+	ranges::sort(values);
+	auto series = Series();
+	series.name = name;
+	series.unit = unit;
+	series.count = int(values.size());
+	series.min = values.front();
+	series.p50 = Percentile(values, 50);
+	series.p95 = Percentile(values, 95);
+	series.p99 = Percentile(values, 99);
+	series.max = values.back();
+	series.mean = ranges::accumulate(values, 0.) / values.size();
+	_series.push_back(std::move(series));
+}
+
+void Report::add(const QString &name, MeasuredCalls measured) {
+	add(name + ".time", "ns", std::move(measured.nanoseconds));
+	add(name + ".allocations", "count", std::move(measured.allocations));
+}
+
+QByteArray Report::serialize() const {
+	auto result = QByteArray();
+	for (const auto &series : _series) {
+		auto object = QJsonObject();
+		object.insert("name", series.name);
+		object.insert("unit", series.unit);
+		object.insert("count", series.count);
+		object.insert("min", double(series.min));
+		object.insert("p50", double(series.p50));
+		object.insert("p95", double(series.p95));
+		object.insert("p99", double(series.p99));
+		object.insert("max", double(series.max));
+		object.insert("mean", series.mean);
+		result.append(QJsonDocument(object).toJson(QJsonDocument::Compact));
+		result.append('\n');
+	}
+	return result;
+}
+
+} // namespace Wallet::Benchmark
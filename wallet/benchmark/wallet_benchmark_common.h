@@ -0,0 +1,93 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+namespace Wallet::Benchmark {
+
+// Microseconds from an arbitrary point, for measuring intervals.
+[[nodiscard]] int64 Now();
+
+// Nanoseconds from an arbitrary point, for measuring fast calls.
+[[nodiscard]] int64 NowNanoseconds();
+
+// Keeps a computed value alive, so that the measured call is not dropped.
+void Keep(const void *value);
+
+// Allocations made by the calling thread since the start. The benchmark
+// library replaces the global operator new to count them, so it is linked
+// only to benchmark executables.
+[[nodiscard]] int64 Allocations();
+
+struct MeasuredCalls {
+	std::vector<int64> nanoseconds;
+	std::vector<int64> allocations;
+};
+
+// Time and allocations per call, both measured for each batch of calls
+// so that the clock overhead is negligible even for the fastest ones. The
+// callback gets the index of the call in the batch to choose the input.
+template <typename Callback>
+[[nodiscard]] MeasuredCalls MeasureCalls(
+		int batches,
+		int batchSize,
+		Callback &&callback) {
+	Expects(batchSize > 0);
+
+	auto result = MeasuredCalls();
+	result.nanoseconds.reserve(batches);
+	result.allocations.reserve(batches);
+	for (auto i = 0; i != batches; ++i) {
+		const auto allocations = Allocations();
+		const auto start = NowNanoseconds();
+		for (auto j = 0; j != batchSize; ++j) {
+			using Result = decltype(callback(j));
+			if constexpr (std::is_void_v<Result>) {
+				callback(j);
+			} else {
+				const auto value = callback(j);
+				Keep(&value);
+			}
+		}
+		const auto time = NowNanoseconds() - start;
+		result.nanoseconds.push_back(time / batchSize);
+		result.allocations.push_back(
+			(Allocations() - allocations) / batchSize);
+	}
+	return result;
+}
+
+// Measured series printed as JSON, one line per series, so that the runs
+// can be compared across commits with any script.
+class Report final {
+public:
+	void add(
+		const QString &name,
+		const QString &unit,
+		std::vector<int64> values);
+
+	void add(const QString &name, MeasuredCalls measured);
+
+	[[nodiscard]] QByteArray serialize() const;
+
+private:
+	struct Series {
+		QString name;
+		QString unit;
+		int count = 0;
+		int64 min = 0;
+		int64 p50 = 0;
+		int64 p95 = 0;
+		int64 p99 = 0;
+		int64 max = 0;
+		double mean = 0.;
+	};
+
+	std::vector<Series> _series;
+
+};
+
+} // namespace Wallet::Benchmark
@@ -0,0 +1,302 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/benchmark/wallet_benchmark_functions.h"
+
+#include "wallet/benchmark/wallet_benchmark_common.h"
+#include "wallet/create/wallet_create_manager.h"
+#include "wallet/wallet_common.h"
+#include "wallet/wallet_history.h"
+#include "ton/ton_state.h"
+#include "ton/ton_wallet.h"
+
+#include <array>
+#include <random>
+
+namespace Wallet::Benchmark {
+namespace {
+
+constexpr auto kInputs = 256;
+constexpr auto kBatchSize = 64;
+constexpr auto kOneGram = int64(1'000'000'000);
+
+struct Magnitude {
+	const char *name = nullptr;
+	int64 from = 0;
+	int64 till = 0;
+};
+
+constexpr auto kMagnitudes = std::array{
+	Magnitude{ "nano", 1, kOneGram - 1 },
+	Magnitude{ "grams", kOneGram, 1'000 * kOneGram },
+	Magnitude{ "millions", 1'000'000 * kOneGram, 1'000'000'000 * kOneGram },
+};
+
+constexpr auto kCommentLengths = std::array{ 0, 64, kMaxCommentLength };
+constexpr auto kOutgoingCounts = std::array{ 0, 1, 4 };
+constexpr auto kPrefixLengths = std::array{ 1, 2, 3 };
+
+class Generator final {
+public:
+	explicit Generator(uint32 seed);
+
+	[[nodiscard]] int64 amount(const Magnitude &magnitude);
+	[[nodiscard]] QString address();
+	[[nodiscard]] QString text(int length);
+	[[nodiscard]] Ton::Transaction transaction(
+		int outgoing,
+		int commentLength);
+	[[nodiscard]] const base::flat_set<QString> &words() const;
+	[[nodiscard]] const QString &word();
+
+private:
+	[[nodiscard]] int64 generate(int64 from, int64 till);
+
+	std::mt19937_64 _random;
+	const base::flat_set<QString> _words;
+	int64 _lt = 0;
+
+};
+
+Generator::Generator(uint32 seed)
+: _random(seed)
+, _words(Ton::Wallet::GetValidWords()) {
+	Expects(!_words.empty());
+}
+
+int64 Generator::amount(const Magnitude &magnitude) {
+	const auto result = generate(magnitude.from, magnitude.till);
+	return generate(0, 1) ? result : -result;
+}
+
+QString Generator::address() {
+	static const auto kChars = QString("ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz0123456789-_");
+	auto result = QString("EQ");
+	result.reserve(kAddressLength);
+	while (result.size() < kAddressLength) {
+		result.append(kChars[int(generate(0, kChars.size() - 1))]);
+	}
+	return result;
+}
+
+QString Generator::text(int length) {
+	auto result = QString();
+	result.reserve(length);
+	while (result.size() < length) {
+		if (!result.isEmpty()) {
+			result.append(' ');
+		}
+		result.append(word());
+	}
+	return result.left(length);
+}
+
+Ton::Transaction Generator::transaction(int outgoing, int commentLength) {
+	const auto own = address();
+	auto result = Ton::Transaction();
+	_lt += generate(1, 1000);
+	result.id.lt = _lt;
+	result.time = TimeId(1'600'000'000 + _lt);
+	result.fee = generate(1'000'000, 10'000'000);
+
+	auto message = Ton::Message();
+	message.message.text = text(commentLength);
+	if (outgoing) {
+		result.incoming.destination = own;
+		for (auto i = 0; i != outgoing; ++i) {
+			message.source = own;
+			message.destination = address();
+			message.value = generate(1, 1000) * kOneGram;
+			result.outgoing.push_back(message);
+		}
+	} else {
+		message.source = address();
+		message.destination = own;
+		message.value = generate(1, 1000) * kOneGram;
+		result.incoming = message;
+	}
+	return result;
+}
+
+const base::flat_set<QString> &Generator::words() const {
+	return _words;
+}
+
+const QString &Generator::word() {
+	return *(_words.begin() + generate(0, int64(_words.size()) - 1));
+}
+
+int64 Generator::generate(int64 from, int64 till) {
+	return std::uniform_int_distribution<int64>(from, till)(_random);
+}
+
+template <typename Input, typename Produce>
+[[nodiscard]] std::vector<Input> Inputs(Produce &&produce) {
+	auto result = std::vector<Input>();
+	result.reserve(kInputs);
+	for (auto i = 0; i != kInputs; ++i) {
+		result.push_back(produce());
+	}
+	return result;
+}
+
+[[nodiscard]] QString FlagsName(FormatFlags flags) {
+	auto result = QStringList();
+	if (flags & FormatFlag::Signed) {
+		result.push_back("signed");
+	}
+	if (flags & FormatFlag::Rounded) {
+		result.push_back("rounded");
+	}
+	if (flags & FormatFlag::Simple) {
+		result.push_back("simple");
+	}
+	return result.isEmpty() ? "none" : result.join('_');
+}
+
+void RunAmounts(
+		Generator &generator,
+		int batches,
+		not_null<Report*> report) {
+	constexpr auto kAllFlags = (FormatFlag::Signed
+		| FormatFlag::Rounded
+		| FormatFlag::Simple).value();
+
+	for (const auto &magnitude : kMagnitudes) {
+		const auto amounts = Inputs<int64>([&] {
+			return generator.amount(magnitude);
+		});
+		for (auto value = 0; value <= kAllFlags; ++value) {
+			const auto flags = FormatFlags::from_raw(value);
+			report->add(
+				QString("common.format_amount.%1.%2"
+				).arg(FlagsName(flags)
+				).arg(magnitude.name),
+				MeasureCalls(batches, kBatchSize, [&](int index) {
+					return FormatAmount(amounts[index % kInputs], flags);
+				}));
+		}
+
+		// Amounts as they are typed, without the group separators.
+		const auto typed = ranges::view::all(
+			amounts
+		) | ranges::view::transform([](int64 amount) {
+			return FormatAmount(amount, FormatFlag::Simple).full;
+		}) | ranges::to_vector;
+		report->add(
+			QString("common.parse_amount_string.%1").arg(magnitude.name),
+			MeasureCalls(batches, kBatchSize, [&](int index) {
+				return ParseAmountString(typed[index % kInputs]);
+			}));
+	}
+}
+
+void RunLinks(
+		Generator &generator,
+		int batches,
+		not_null<Report*> report) {
+	for (const auto length : kCommentLengths) {
+		const auto invoices = Inputs<PreparedInvoice>([&] {
+			auto result = PreparedInvoice();
+			result.amount = generator.amount(kMagnitudes[1]);
+			result.address = generator.address();
+			result.comment = generator.text(length);
+			return result;
+		});
+		const auto links = ranges::view::all(
+			invoices
+		) | ranges::view::transform([](const PreparedInvoice &invoice) {
+			return TransferLink(
+				invoice.address,
+				std::abs(invoice.amount),
+				invoice.comment);
+		}) | ranges::to_vector;
+		const auto suffix = QString(".comment_%1").arg(length);
+
+		report->add(
+			"common.transfer_link" + suffix,
+			MeasureCalls(batches, kBatchSize, [&](int index) {
+				const auto &invoice = invoices[index % kInputs];
+				return TransferLink(
+					invoice.address,
+					std::abs(invoice.amount),
+					invoice.comment);
+			}));
+		report->add(
+			"common.parse_invoice" + suffix,
+			MeasureCalls(batches, kBatchSize, [&](int index) {
+				return ParseInvoice(links[index % kInputs]);
+			}));
+		report->add(
+			"common.validate_transfer_link" + suffix,
+			MeasureCalls(batches, kBatchSize, [&](int index) {
+				return ValidateTransferLink(links[index % kInputs]);
+			}));
+	}
+}
+
+void RunTransactions(
+		Generator &generator,
+		int batches,
+		not_null<Report*> report) {
+	for (const auto count : kOutgoingCounts) {
+		const auto transactions = Inputs<Ton::Transaction>([&] {
+			return generator.transaction(count, 0);
+		});
+		report->add(
+			QString("common.calculate_value.outgoing_%1").arg(count),
+			MeasureCalls(batches, kBatchSize, [&](int index) {
+				return CalculateValue(transactions[index % kInputs]);
+			}));
+	}
+	for (const auto length : kCommentLengths) {
+		const auto transactions = Inputs<Ton::Transaction>([&] {
+			return generator.transaction(1, length);
+		});
+		report->add(
+			QString("history.prepare_row_layout.comment_%1").arg(length),
+			MeasureCalls(batches, kBatchSize, [&](int index) {
+				PrepareRowLayout(transactions[index % kInputs], true);
+			}));
+	}
+}
+
+void RunWords(
+		Generator &generator,
+		int batches,
+		not_null<Report*> report) {
+	const auto &words = generator.words();
+	const auto run = [&](const QString &name, int length) {
+		const auto prefixes = Inputs<QString>([&] {
+			const auto &word = generator.word();
+			return length ? word.mid(0, length) : word;
+		});
+		report->add(
+			"create.words_by_prefix." + name,
+			MeasureCalls(batches, kBatchSize, [&](int index) {
+				return Create::WordsByPrefix(
+					words,
+					prefixes[index % kInputs]);
+			}));
+	};
+	for (const auto length : kPrefixLengths) {
+		run(QString("prefix_%1").arg(length), length);
+	}
+	run("word", 0);
+}
+
+} // namespace
+
+void RunFunctions(uint32 seed, int batches, not_null<Report*> report) {
+	auto generator = Generator(seed);
+	RunAmounts(generator, batches, report);
+	RunLinks(generator, batches, report);
+	RunTransactions(generator, batches, report);
+	RunWords(generator, batches, report);
+}
+
+} // namespace Wallet::Benchmark
@@ -0,0 +1,20 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+namespace Wallet::Benchmark {
+
+class Report;
+
+// Measures the hot functions of the wallet one by one: the amounts
+// formatting and parsing, the invoices and transfer links, the word hints
+// and the history row layout. The inputs are generated from the seed and
+// grouped by their size, every group has its own series. The row layout
+// expects the application and the styles to be already set up.
+void RunFunctions(uint32 seed, int batches, not_null<Report*> report);
+
+} // namespace Wallet::Benchmark
@@ -0,0 +1,125 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/benchmark/wallet_benchmark.h"
+
+#include "base/integration.h"
+#include "ui/integration.h"
+#include "ui/emoji_config.h"
+#include "ui/style/style_core.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QEvent>
+#include <QtCore/QStandardPaths>
+#include <QtWidgets/QApplication>
+#include <crl/crl_on_main.h>
+#include <iostream>
+
+namespace {
+
+const auto kProcessorEvent = QEvent::Type(QEvent::registerEventType());
+
+class ProcessorEvent final : public QEvent {
+public:
+	ProcessorEvent(void (*callable)(void*), void *argument)
+	: QEvent(kProcessorEvent)
+	, _callable(callable)
+	, _argument(argument) {
+	}
+
+	void process() {
+		_callable(_argument);
+	}
+
+private:
+	void (*_callable)(void*) = nullptr;
+	void *_argument = nullptr;
+
+};
+
+// Runs the crl::on_main callbacks from the Qt event loop.
+class MainQueueProcessor final : public QObject {
+public:
+	MainQueueProcessor() {
+		Instance = this;
+		crl::init_main_queue([](void (*callable)(void*), void *argument) {
+			QCoreApplication::postEvent(
+				Instance,
+				new ProcessorEvent(callable, argument),
+				Qt::HighEventPriority);
+		});
+	}
+	~MainQueueProcessor() {
+		Instance = nullptr;
+	}
+
+protected:
+	bool event(QEvent *event) override {
+		if (event->type() == kProcessorEvent) {
+			static_cast<ProcessorEvent*>(event)->process();
+			return true;
+		}
+		return QObject::event(event);
+	}
+
+private:
+	static inline MainQueueProcessor *Instance = nullptr;
+
+};
+
+class BaseIntegration final : public base::Integration {
+public:
+	using base::Integration::Integration;
+
+	void enterFromEventLoop(FnMut<void()> &&method) override {
+		method();
+	}
+	void logMessage(const QString &message) override {
+		std::cerr << message.toStdString() << std::endl;
+	}
+
+};
+
+class UiIntegration final : public Ui::Integration {
+public:
+	void postponeCall(FnMut<void()> &&callable) override {
+		crl::on_main(std::move(callable));
+	}
+	void registerLeaveSubscription(not_null<QWidget*> widget) override {
+	}
+	void unregisterLeaveSubscription(not_null<QWidget*> widget) override {
+	}
+	QString emojiCacheFolder() override {
+		return QStandardPaths::writableLocation(
+			QStandardPaths::TempLocation) + "/wallet_benchmark_emoji";
+	}
+
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	// The replay needs no screen, so it runs the same way on CI machines.
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	auto base = BaseIntegration(argc, argv);
+	base::Integration::Set(&base);
+
+	auto application = QApplication(argc, argv);
+	auto processor = MainQueueProcessor();
+
+	auto ui = UiIntegration();
+	Ui::Integration::Set(&ui);
+	style::StartManager(style::kScaleDefault);
+	Ui::Emoji::Init();
+
+	const auto result = Wallet::Benchmark::Run(application.arguments());
+
+	Ui::Emoji::Clear();
+	style::StopManager();
+	return result;
+}
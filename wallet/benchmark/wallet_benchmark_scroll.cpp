@@ -0,0 +1,197 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/benchmark/wallet_benchmark_scroll.h"
+
+#include "wallet/benchmark/wallet_benchmark_common.h"
+#include "wallet/wallet_backend_fake.h"
+#include "wallet/wallet_window.h"
+#include "ui/widgets/scroll_area.h"
+#include "ui/rp_widget.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtGui/QCursor>
+#include <QtGui/QMouseEvent>
+
+namespace Wallet::Benchmark {
+namespace {
+
+constexpr auto kLoadWait = 2000;
+constexpr auto kScrollStep = 60;
+constexpr auto kScrollSteps = 200;
+
+using Type = ScrollEvent::Type;
+
+void Wait(int milliseconds) {
+	auto timer = QElapsedTimer();
+	timer.start();
+	while (timer.elapsed() < milliseconds) {
+		QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+	}
+}
+
+[[nodiscard]] Ui::ScrollArea *FindScroll(not_null<QWidget*> widget) {
+	for (const auto scroll : widget->findChildren<Ui::ScrollArea*>()) {
+		if (scroll->isVisible()) {
+			return scroll;
+		}
+	}
+	return nullptr;
+}
+
+void SendMouse(
+		not_null<QWidget*> widget,
+		QEvent::Type type,
+		QPoint point) {
+	const auto global = widget->mapToGlobal(point);
+	QCursor::setPos(global);
+	const auto child = widget->childAt(point);
+	const auto target = child ? child : widget.get();
+	const auto button = (type == QEvent::MouseMove)
+		? Qt::NoButton
+		: Qt::LeftButton;
+	const auto buttons = (type == QEvent::MouseButtonPress)
+		? Qt::LeftButton
+		: Qt::NoButton;
+	auto event = QMouseEvent(
+		type,
+		target->mapFromGlobal(global),
+		global,
+		button,
+		buttons,
+		Qt::NoModifier);
+	QCoreApplication::sendEvent(target, &event);
+}
+
+void Apply(not_null<QWidget*> widget, const ScrollEvent &event) {
+	switch (event.type) {
+	case Type::Wait: Wait(event.value); return;
+	case Type::Resize: widget->resize(event.size); return;
+	case Type::Scroll:
+		if (const auto scroll = FindScroll(widget)) {
+			scroll->scrollToY(scroll->scrollTop() + event.value);
+		}
+		return;
+	case Type::Hover:
+		SendMouse(widget, QEvent::MouseMove, event.point);
+		return;
+	case Type::Decrypt:
+		SendMouse(widget, QEvent::MouseMove, event.point);
+		SendMouse(widget, QEvent::MouseButtonPress, event.point);
+		SendMouse(widget, QEvent::MouseButtonRelease, event.point);
+		return;
+	}
+	Unexpected("Type in Benchmark::Apply.");
+}
+
+} // namespace
+
+std::optional<std::vector<ScrollEvent>> ParseScrollEvents(
+		const QByteArray &data) {
+	auto result = std::vector<ScrollEvent>();
+	for (const auto &line : data.split('\n')) {
+		const auto parts = line.simplified().split(' ');
+		if (parts.isEmpty() || parts[0].isEmpty() || parts[0][0] == '#') {
+			continue;
+		}
+		const auto number = [&](int index) {
+			return (index < parts.size()) ? parts[index].toInt() : 0;
+		};
+		const auto &name = parts[0];
+		auto event = ScrollEvent();
+		if (name == "wait" && parts.size() == 2) {
+			event.type = Type::Wait;
+			event.value = number(1);
+		} else if (name == "resize" && parts.size() == 3) {
+			event.type = Type::Resize;
+			event.size = QSize(number(1), number(2));
+		} else if (name == "scroll" && parts.size() == 2) {
+			event.type = Type::Scroll;
+			event.value = number(1);
+		} else if (name == "hover" && parts.size() == 3) {
+			event.type = Type::Hover;
+			event.point = QPoint(number(1), number(2));
+		} else if (name == "decrypt" && parts.size() == 3) {
+			event.type = Type::Decrypt;
+			event.point = QPoint(number(1), number(2));
+		} else {
+			return std::nullopt;
+		}
+		result.push_back(event);
+	}
+	return result;
+}
+
+std::vector<ScrollEvent> DefaultScrollEvents() {
+	auto result = std::vector<ScrollEvent>();
+	const auto add = [&](Type type, int value, QPoint point, QSize size) {
+		result.push_back({ type, point, size, value });
+	};
+	add(Type::Resize, 0, QPoint(), QSize(420, 720));
+	add(Type::Wait, kLoadWait, QPoint(), QSize());
+	for (auto i = 0; i != kScrollSteps; ++i) {
+		add(Type::Scroll, kScrollStep, QPoint(), QSize());
+		add(Type::Hover, 0, QPoint(200, 300 + (i % 8) * 40), QSize());
+		if (i % 50 == 25) {
+			add(Type::Decrypt, 0, QPoint(120, 420), QSize());
+			add(Type::Resize, 0, QPoint(), QSize(640, 720));
+		} else if (i % 50 == 49) {
+			add(Type::Resize, 0, QPoint(), QSize(420, 720));
+		}
+	}
+	for (auto i = 0; i != kScrollSteps; ++i) {
+		add(Type::Scroll, -kScrollStep, QPoint(), QSize());
+	}
+	return result;
+}
+
+void RunScrollReplay(
+		const std::vector<ScrollEvent> &events,
+		const FakeConfig &config,
+		not_null<Report*> report) {
+	// Start from empty local caches, so that every run loads the same.
+	const auto folder = QDir::tempPath() + "/wallet_benchmark";
+	QDir(folder).removeRecursively();
+
+	auto window = std::make_unique<Window>(
+		std::make_unique<FakeBackend>(config),
+		nullptr,
+		folder);
+	window->showAndActivate();
+	const auto widget = window->widget();
+
+	auto layout = std::vector<int64>();
+	auto paint = std::vector<int64>();
+	auto allocations = std::vector<int64>();
+	for (const auto &event : events) {
+		if (event.type == Type::Wait) {
+			Apply(widget, event);
+			continue;
+		}
+		const auto allocated = Allocations();
+		const auto started = Now();
+		Apply(widget, event);
+		const auto applied = Now();
+		widget->repaint();
+		const auto painted = Now();
+		layout.push_back(applied - started);
+		paint.push_back(painted - applied);
+		allocations.push_back(Allocations() - allocated);
+
+		// Let the backend callbacks and the posted events go unmeasured.
+		QCoreApplication::processEvents();
+	}
+	report->add("scroll.layout", "us", std::move(layout));
+	report->add("scroll.paint", "us", std::move(paint));
+	report->add("scroll.allocations", "count", std::move(allocations));
+
+	window = nullptr;
+	QDir(folder).removeRecursively();
+}
+
+} // namespace Wallet::Benchmark
@@ -0,0 +1,48 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+namespace Wallet {
+struct FakeConfig;
+} // namespace Wallet
+
+namespace Wallet::Benchmark {
+
+class Report;
+
+struct ScrollEvent {
+	enum class Type {
+		Wait,
+		Resize,
+		Scroll,
+		Hover,
+		Decrypt,
+	};
+	Type type = Type::Wait;
+	QPoint point;
+	QSize size;
+	int value = 0;
+};
+
+// One event per line: "wait <ms>", "resize <width> <height>",
+// "scroll <delta>", "hover <x> <y>" or "decrypt <x> <y>", where decrypt
+// clicks at a point recorded over an encrypted comment. Lines starting
+// with '#' are skipped.
+[[nodiscard]] std::optional<std::vector<ScrollEvent>> ParseScrollEvents(
+	const QByteArray &data);
+[[nodiscard]] std::vector<ScrollEvent> DefaultScrollEvents();
+
+// Shows a Window on top of FakeBackend and replays the events, measuring
+// the layout (handling the event) and the paint of every frame. Expects
+// the application to be already set up, on the offscreen platform for
+// the results to be stable.
+void RunScrollReplay(
+	const std::vector<ScrollEvent> &events,
+	const FakeConfig &config,
+	not_null<Report*> report);
+
+} // namespace Wallet::Benchmark
@@ -374,16 +374,22 @@ rpl::lifetime &Manager::lifetime() {
 }
 
 std::vector<QString> Manager::wordsByPrefix(const QString &word) const {
+	return WordsByPrefix(_validWords, word);
+}
+
+std::vector<QString> WordsByPrefix(
+		const base::flat_set<QString> &validWords,
+		const QString &word) {
 	const auto adjusted = word.trimmed().toLower();
 	if (adjusted.isEmpty()) {
 		return {};
-	} else if (_validWords.empty()) {
+	} else if (validWords.empty()) {
 		return { word };
 	}
 	auto prefix = QString();
 	auto count = 0;
 	auto maxCount = 0;
-	for (const auto &word : _validWords) {
+	for (const auto &word : validWords) {
 		if (word.midRef(0, 3) != prefix) {
 			prefix = word.mid(0, 3);
 			count = 1;
@@ -395,8 +401,8 @@ std::vector<QString> Manager::wordsByPrefix(const QString &word) const {
 		}
 	}
 	auto result = std::vector<QString>();
-	const auto from = ranges::lower_bound(_validWords, adjusted);
-	const auto end = _validWords.end();
+	const auto from = ranges::lower_bound(validWords, adjusted);
+	const auto end = validWords.end();
 	for (auto i = from; i != end && i->startsWith(adjusted); ++i) {
 		result.push_back(*i);
 	}
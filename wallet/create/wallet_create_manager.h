@@ -26,6 +26,11 @@ class UpdateInfo;
 
 namespace Wallet::Create {
 
+// Valid words starting with the typed prefix, used for the word hints.
+[[nodiscard]] std::vector<QString> WordsByPrefix(
+	const base::flat_set<QString> &validWords,
+	const QString &word);
+
 class Manager final {
 public:
 	Manager(not_null<QWidget*> parent, UpdateInfo *updateInfo);
@@ -0,0 +1,99 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+#include "ton/ton_result.h"
+
+namespace Ton {
+struct Settings;
+} // namespace Ton
+
+namespace Wallet {
+
+// The part of Ton::AccountViewer used by the window.
+class BackendViewer {
+public:
+	virtual ~BackendViewer() = default;
+
+	[[nodiscard]] virtual rpl::producer<Ton::WalletViewerState> state() = 0;
+	[[nodiscard]] virtual auto loaded()
+		-> rpl::producer<Ton::Result<Ton::LoadedSlice>> = 0;
+
+	virtual void refreshNow(Fn<void(Ton::Result<>)> done) = 0;
+	virtual void setRefreshEach(crl::time delay) = 0;
+	virtual void preloadSlice(const Ton::TransactionId &lastId) = 0;
+
+};
+
+// The part of Ton::Wallet used by the window, so that the window can run
+// on top of the real library as well as on top of FakeBackend.
+class Backend {
+public:
+	virtual ~Backend() = default;
+
+	[[nodiscard]] virtual const Ton::Settings &settings() const = 0;
+	[[nodiscard]] virtual rpl::producer<Ton::Update> updates() const = 0;
+	[[nodiscard]] virtual std::vector<QByteArray> publicKeys() const = 0;
+	[[nodiscard]] virtual QString getUsedAddress(
+		const QByteArray &publicKey) const = 0;
+	[[nodiscard]] virtual std::unique_ptr<BackendViewer> createAccountViewer(
+		const QByteArray &publicKey,
+		const QString &address) = 0;
+
+	virtual void updateSettings(
+		const Ton::Settings &settings,
+		Fn<void(Ton::Result<>)> done) = 0;
+	virtual void checkConfig(
+		const QByteArray &config,
+		Fn<void(Ton::Result<>)> done) = 0;
+	virtual void loadWebResource(
+		const QString &url,
+		Fn<void(Ton::Result<QByteArray>)> done) = 0;
+	virtual void sync() = 0;
+
+	virtual void createKey(
+		Fn<void(Ton::Result<std::vector<QString>>)> done) = 0;
+	virtual void importKey(
+		const std::vector<QString> &words,
+		Fn<void(Ton::Result<>)> done) = 0;
+	virtual void queryWalletAddress(Fn<void(Ton::Result<QString>)> done) = 0;
+	virtual void saveKey(
+		const QByteArray &passcode,
+		const QString &address,
+		Fn<void(Ton::Result<QByteArray>)> done) = 0;
+	virtual void exportKey(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		Fn<void(Ton::Result<std::vector<QString>>)> done) = 0;
+	virtual void deleteAllKeys(Fn<void(Ton::Result<>)> done) = 0;
+	virtual void changePassword(
+		const QByteArray &oldPasscode,
+		const QByteArray &newPasscode,
+		Fn<void(Ton::Result<>)> done) = 0;
+
+	virtual void checkSendGrams(
+		const QByteArray &publicKey,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::TransactionCheckResult>)> done) = 0;
+	virtual void sendGrams(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::PendingTransaction>)> ready,
+		Fn<void(Ton::Result<>)> done) = 0;
+	virtual void decrypt(
+		const QByteArray &publicKey,
+		std::vector<Ton::Transaction> &&list,
+		Fn<void(Ton::Result<std::vector<Ton::Transaction>>)> done) = 0;
+	virtual void updateViewersPassword(
+		const QByteArray &publicKey,
+		const QByteArray &passcode) = 0;
+
+};
+
+} // namespace Wallet
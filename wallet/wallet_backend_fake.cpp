@@ -0,0 +1,542 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_backend_fake.h"
+
+#include "wallet/wallet_common.h"
+#include "ton/ton_wallet.h"
+#include "base/call_delayed.h"
+#include "base/timer.h"
+#include "base/unixtime.h"
+
+namespace Wallet {
+namespace {
+
+constexpr auto kWordsCount = 24;
+constexpr auto kHashSize = 32;
+constexpr auto kKeySize = 32;
+constexpr auto kFirstLt = int64(1000000);
+constexpr auto kMaxValueUnits = 100000;
+constexpr auto kValueUnit = int64(100000);
+constexpr auto kFeeUnit = int64(1000);
+constexpr auto kConfirmLatencies = 5;
+
+[[nodiscard]] int64 Change(const Ton::Transaction &data) {
+	return data.outgoing.empty()
+		? (data.incoming.value - data.fee)
+		: (-data.outgoing.front().value - data.fee);
+}
+
+} // namespace
+
+struct FakeBackend::Account {
+	QByteArray publicKey;
+	QString address;
+	std::vector<QString> words;
+
+	// Newest first, as the real viewer gives them.
+	std::vector<Ton::Transaction> history;
+	std::vector<Ton::PendingTransaction> pending;
+	base::flat_map<int64, QString> encrypted;
+	int64 balance = 0;
+	int64 lastLt = kFirstLt;
+	rpl::event_stream<> changes;
+};
+
+class FakeBackend::Viewer final
+	: public BackendViewer
+	, public base::has_weak_ptr {
+public:
+	Viewer(not_null<FakeBackend*> backend, not_null<Account*> account);
+
+	rpl::producer<Ton::WalletViewerState> state() override;
+	rpl::producer<Ton::Result<Ton::LoadedSlice>> loaded() override;
+
+	void refreshNow(Fn<void(Ton::Result<>)> done) override;
+	void setRefreshEach(crl::time delay) override;
+	void preloadSlice(const Ton::TransactionId &lastId) override;
+
+private:
+	[[nodiscard]] Ton::WalletViewerState computeState(
+		crl::time lastRefresh,
+		bool refreshing) const;
+	[[nodiscard]] Ton::TransactionsSlice slice(int from) const;
+
+	const not_null<FakeBackend*> _backend;
+	const not_null<Account*> _account;
+	rpl::variable<Ton::WalletViewerState> _state;
+	rpl::event_stream<Ton::Result<Ton::LoadedSlice>> _loaded;
+	base::Timer _refreshTimer;
+	rpl::lifetime _lifetime;
+
+};
+
+FakeBackend::Viewer::Viewer(
+	not_null<FakeBackend*> backend,
+	not_null<Account*> account)
+: _backend(backend)
+, _account(account)
+, _state(computeState(crl::now(), false))
+, _refreshTimer([=] { refreshNow([](Ton::Result<>) {}); }) {
+	_account->changes.events(
+	) | rpl::start_with_next([=] {
+		_state = computeState(_state.current().lastRefresh, false);
+	}, _lifetime);
+}
+
+rpl::producer<Ton::WalletViewerState> FakeBackend::Viewer::state() {
+	return _state.value();
+}
+
+auto FakeBackend::Viewer::loaded()
+-> rpl::producer<Ton::Result<Ton::LoadedSlice>> {
+	return _loaded.events();
+}
+
+void FakeBackend::Viewer::refreshNow(Fn<void(Ton::Result<>)> done) {
+	if (!_state.current().refreshing) {
+		_state = computeState(_state.current().lastRefresh, true);
+	}
+	_backend->later(crl::guard(this, [=] {
+		_state = computeState(crl::now(), false);
+		done(Ton::Result<>());
+	}));
+}
+
+void FakeBackend::Viewer::setRefreshEach(crl::time delay) {
+	_refreshTimer.callEach(delay);
+}
+
+void FakeBackend::Viewer::preloadSlice(const Ton::TransactionId &lastId) {
+	_backend->later(crl::guard(this, [=] {
+		const auto &history = _account->history;
+		const auto i = ranges::find(history, lastId, &Ton::Transaction::id);
+		auto result = Ton::LoadedSlice();
+		result.after = lastId;
+		result.data = slice(int(i - begin(history)));
+		_loaded.fire(std::move(result));
+	}));
+}
+
+Ton::WalletViewerState FakeBackend::Viewer::computeState(
+		crl::time lastRefresh,
+		bool refreshing) const {
+	auto result = Ton::WalletViewerState();
+	result.wallet.address = _account->address;
+	result.wallet.account.fullBalance = _account->balance;
+	result.wallet.lastTransactions = slice(0);
+	result.wallet.pendingTransactions = _account->pending;
+	result.lastRefresh = lastRefresh;
+	result.refreshing = refreshing;
+	return result;
+}
+
+Ton::TransactionsSlice FakeBackend::Viewer::slice(int from) const {
+	const auto &history = _account->history;
+	const auto size = int(history.size());
+	const auto till = std::min(from + _backend->_config.sliceSize, size);
+	auto result = Ton::TransactionsSlice();
+	if (from < till) {
+		result.list = { begin(history) + from, begin(history) + till };
+	}
+	if (till < size) {
+		result.previousId = history[till].id;
+	}
+	return result;
+}
+
+FakeBackend::FakeBackend(FakeConfig config)
+: _config(config)
+, _random(config.seed)
+, _timing(config.seed) {
+	Expects(_config.sliceSize > 0);
+	Expects(_config.addresses > 0);
+	Expects(_config.commentLengthMin <= _config.commentLengthMax);
+
+	for (const auto &word : Ton::Wallet::GetValidWords()) {
+		_dictionary.push_back(word);
+	}
+	if (_dictionary.empty()) {
+		_dictionary.push_back("word");
+	}
+	_counterparties.reserve(_config.addresses);
+	for (auto i = 0; i != _config.addresses; ++i) {
+		_counterparties.push_back(generateAddress());
+	}
+	for (auto i = 0; i != _config.keys; ++i) {
+		_accounts.push_back(generateAccount());
+		generateHistory(*_accounts.back());
+	}
+}
+
+FakeBackend::~FakeBackend() = default;
+
+const Ton::Settings &FakeBackend::settings() const {
+	return _settings;
+}
+
+rpl::producer<Ton::Update> FakeBackend::updates() const {
+	return _updates.events();
+}
+
+std::vector<QByteArray> FakeBackend::publicKeys() const {
+	return ranges::view::all(
+		_accounts
+	) | ranges::view::transform([](const std::unique_ptr<Account> &account) {
+		return account->publicKey;
+	}) | ranges::to_vector;
+}
+
+QString FakeBackend::getUsedAddress(const QByteArray &publicKey) const {
+	return account(publicKey).address;
+}
+
+std::unique_ptr<BackendViewer> FakeBackend::createAccountViewer(
+		const QByteArray &publicKey,
+		const QString &address) {
+	return std::make_unique<Viewer>(this, &account(publicKey));
+}
+
+void FakeBackend::updateSettings(
+		const Ton::Settings &settings,
+		Fn<void(Ton::Result<>)> done) {
+	later([=] {
+		_settings = settings;
+		done(Ton::Result<>());
+	});
+}
+
+void FakeBackend::checkConfig(
+		const QByteArray &config,
+		Fn<void(Ton::Result<>)> done) {
+	later([=] {
+		done(Ton::Result<>());
+	});
+}
+
+void FakeBackend::loadWebResource(
+		const QString &url,
+		Fn<void(Ton::Result<QByteArray>)> done) {
+	later([=] {
+		const auto &config = _settings.net().config;
+		done(config.isEmpty() ? QByteArray("{}") : config);
+	});
+}
+
+void FakeBackend::sync() {
+	if (_syncStep >= 0) {
+		return;
+	}
+	const auto steps = std::max(_config.syncSteps, 1);
+	const auto delay = _config.syncDuration / steps;
+	const auto step = std::make_shared<Fn<void()>>();
+	*step = [=] {
+		auto state = Ton::SyncState();
+		state.from = 0;
+		state.current = ++_syncStep;
+		state.to = steps;
+		_updates.fire(Ton::Update{ state });
+		if (_syncStep < steps) {
+			base::call_delayed(delay, this, [=] { (*step)(); });
+		} else {
+			_syncStep = -1;
+		}
+	};
+	_syncStep = 0;
+	base::call_delayed(delay, this, [=] { (*step)(); });
+}
+
+void FakeBackend::createKey(
+		Fn<void(Ton::Result<std::vector<QString>>)> done) {
+	_creating = generateAccount();
+	later([=] {
+		done(_creating->words);
+	});
+}
+
+void FakeBackend::importKey(
+		const std::vector<QString> &words,
+		Fn<void(Ton::Result<>)> done) {
+	_creating = generateAccount();
+	_creating->words = words;
+	later([=] {
+		done(Ton::Result<>());
+	});
+}
+
+void FakeBackend::queryWalletAddress(Fn<void(Ton::Result<QString>)> done) {
+	Expects(_creating != nullptr);
+
+	later([=] {
+		done(_creating->address);
+	});
+}
+
+void FakeBackend::saveKey(
+		const QByteArray &passcode,
+		const QString &address,
+		Fn<void(Ton::Result<QByteArray>)> done) {
+	Expects(_creating != nullptr);
+
+	later([=] {
+		auto created = base::take(_creating);
+		const auto publicKey = created->publicKey;
+		generateHistory(*created);
+		_accounts.push_back(std::move(created));
+		done(publicKey);
+	});
+}
+
+void FakeBackend::exportKey(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		Fn<void(Ton::Result<std::vector<QString>>)> done) {
+	later([=] {
+		done(account(publicKey).words);
+	});
+}
+
+void FakeBackend::deleteAllKeys(Fn<void(Ton::Result<>)> done) {
+	later([=] {
+		_accounts.clear();
+		done(Ton::Result<>());
+	});
+}
+
+void FakeBackend::changePassword(
+		const QByteArray &oldPasscode,
+		const QByteArray &newPasscode,
+		Fn<void(Ton::Result<>)> done) {
+	later([=] {
+		done(Ton::Result<>());
+	});
+}
+
+void FakeBackend::checkSendGrams(
+		const QByteArray &publicKey,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::TransactionCheckResult>)> done) {
+	later([=] {
+		done(Ton::TransactionCheckResult());
+	});
+}
+
+void FakeBackend::sendGrams(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::PendingTransaction>)> ready,
+		Fn<void(Ton::Result<>)> done) {
+	const auto sender = &account(publicKey);
+	auto message = Ton::Message();
+	message.source = sender->address;
+	message.destination = transaction.recipient;
+	message.value = transaction.amount;
+	message.created = base::unixtime::now();
+	message.message.text = transaction.comment;
+
+	auto pending = Ton::PendingTransaction();
+	pending.fake.time = message.created;
+	pending.fake.incoming.destination = sender->address;
+	pending.fake.outgoing.push_back(message);
+
+	later([=] {
+		sender->pending.push_back(pending);
+		sender->changes.fire({});
+		ready(pending);
+
+		const auto confirm = [=] {
+			auto confirmed = pending.fake;
+			confirmed.id.lt = (sender->lastLt += generateInt(1, 1000));
+			confirmed.id.hash = generateBytes(kHashSize);
+			confirmed.fee = generateInt(1000, 10000) * kFeeUnit;
+			sender->balance += Change(confirmed);
+			sender->history.insert(begin(sender->history), confirmed);
+			sender->pending.erase(
+				ranges::remove(sender->pending, pending),
+				end(sender->pending));
+			sender->changes.fire({});
+			done(Ton::Result<>());
+		};
+		base::call_delayed(
+			_config.latency * kConfirmLatencies,
+			this,
+			confirm);
+	});
+}
+
+void FakeBackend::decrypt(
+		const QByteArray &publicKey,
+		std::vector<Ton::Transaction> &&list,
+		Fn<void(Ton::Result<std::vector<Ton::Transaction>>)> done) {
+	const auto owner = &account(publicKey);
+	later([=, list = std::move(list)]() mutable {
+		for (auto &transaction : list) {
+			const auto i = owner->encrypted.find(transaction.id.lt);
+			if (i == end(owner->encrypted)) {
+				continue;
+			}
+			auto &message = transaction.outgoing.empty()
+				? transaction.incoming.message
+				: transaction.outgoing.front().message;
+			message.text = i->second;
+			message.decrypted = true;
+		}
+		done(std::move(list));
+	});
+}
+
+void FakeBackend::updateViewersPassword(
+		const QByteArray &publicKey,
+		const QByteArray &passcode) {
+}
+
+auto FakeBackend::account(const QByteArray &publicKey) const -> Account& {
+	const auto i = ranges::find(
+		_accounts,
+		publicKey,
+		[](const std::unique_ptr<Account> &account) {
+			return account->publicKey;
+		});
+	Assert(i != end(_accounts));
+	return **i;
+}
+
+auto FakeBackend::generateAccount() -> std::unique_ptr<Account> {
+	auto result = std::make_unique<Account>();
+	result->publicKey = generateBytes(kKeySize);
+	result->address = generateAddress();
+	result->words = generateWords();
+	return result;
+}
+
+void FakeBackend::generateHistory(Account &account) {
+	const auto count = _config.transactions;
+	auto time = base::unixtime::now() - count * _config.averageGap;
+	account.history.clear();
+	account.history.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		time += generateInt(1, 2 * _config.averageGap);
+		account.lastLt += generateInt(1, 1000);
+		account.history.push_back(generateTransaction(
+			account,
+			account.lastLt,
+			time,
+			account.balance));
+		account.balance += Change(account.history.back());
+	}
+	ranges::reverse(account.history);
+}
+
+Ton::Transaction FakeBackend::generateTransaction(
+		Account &account,
+		int64 lt,
+		TimeId time,
+		int64 balance) {
+	auto result = Ton::Transaction();
+	result.id.lt = lt;
+	result.id.hash = generateBytes(kHashSize);
+	result.time = time;
+	result.fee = generateInt(1000, 10000) * kFeeUnit;
+
+	auto message = Ton::Message();
+	message.value = generateInt(1, kMaxValueUnits) * kValueUnit;
+	message.created = time;
+	const auto counterparty = _counterparties[
+		generateInt(0, int(_counterparties.size()) - 1)];
+	const auto outgoing = generateBool(0.5)
+		&& (balance >= message.value + result.fee);
+	if (outgoing) {
+		message.source = account.address;
+		message.destination = counterparty;
+		result.incoming.destination = account.address;
+		result.outgoing.push_back(generateComment(account, lt, message));
+	} else {
+		message.source = counterparty;
+		message.destination = account.address;
+		result.incoming = generateComment(account, lt, message);
+	}
+	return result;
+}
+
+Ton::Message FakeBackend::generateComment(
+		Account &account,
+		int64 lt,
+		Ton::Message message) {
+	if (!generateBool(_config.commentRatio)) {
+		return message;
+	}
+	const auto length = generateInt(
+		_config.commentLengthMin,
+		_config.commentLengthMax);
+	auto text = generateText(length);
+	if (generateBool(_config.encryptedRatio)) {
+		message.message.encrypted = generateBytes(length + kHashSize);
+		account.encrypted.emplace(lt, std::move(text));
+	} else {
+		message.message.text = std::move(text);
+	}
+	return message;
+}
+
+QString FakeBackend::generateAddress() {
+	static const auto kChars = QString("ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz0123456789-_");
+	auto result = QString("EQ");
+	result.reserve(kAddressLength);
+	while (result.size() < kAddressLength) {
+		result.append(kChars[generateInt(0, kChars.size() - 1)]);
+	}
+	return result;
+}
+
+QString FakeBackend::generateText(int length) {
+	auto result = QString();
+	result.reserve(length);
+	while (result.size() < length) {
+		if (!result.isEmpty()) {
+			result.append(' ');
+		}
+		result.append(_dictionary[
+			generateInt(0, int(_dictionary.size()) - 1)]);
+	}
+	return result.left(length);
+}
+
+std::vector<QString> FakeBackend::generateWords() {
+	auto result = std::vector<QString>();
+	result.reserve(kWordsCount);
+	for (auto i = 0; i != kWordsCount; ++i) {
+		result.push_back(_dictionary[
+			generateInt(0, int(_dictionary.size()) - 1)]);
+	}
+	return result;
+}
+
+QByteArray FakeBackend::generateBytes(int size) {
+	auto result = QByteArray(size, Qt::Uninitialized);
+	for (auto &byte : result) {
+		byte = char(generateInt(0, 255));
+	}
+	return result;
+}
+
+int FakeBackend::generateInt(int from, int till) {
+	return std::uniform_int_distribution<int>(from, till)(_random);
+}
+
+bool FakeBackend::generateBool(double probability) {
+	return std::bernoulli_distribution(probability)(_random);
+}
+
+void FakeBackend::later(Fn<void()> callback) {
+	const auto jitter = std::uniform_int_distribution<crl::time>(
+		0,
+		std::max(_config.latencyJitter, crl::time(0)))(_timing);
+	base::call_delayed(_config.latency + jitter, this, std::move(callback));
+}
+
+} // namespace Wallet
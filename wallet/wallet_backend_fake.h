@@ -0,0 +1,141 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "wallet/wallet_backend.h"
+#include "ton/ton_settings.h"
+#include "base/weak_ptr.h"
+
+#include <random>
+
+namespace Wallet {
+
+struct FakeConfig {
+	int keys = 1;
+	int transactions = 1000;
+	double encryptedRatio = 0.25;
+	double commentRatio = 0.5;
+	int commentLengthMin = 4;
+	int commentLengthMax = 120;
+	int addresses = 64;
+	int sliceSize = 16;
+	TimeId averageGap = 3600;
+	crl::time latency = 150;
+	crl::time latencyJitter = 100;
+	crl::time syncDuration = 2000;
+	int syncSteps = 20;
+	uint32 seed = 1;
+};
+
+// Synthetic wallet working without tonlib and network, for profiling the
+// window on a reproducible load. The same config gives the same keys,
+// histories and comments, only the timings depend on the event loop.
+//
+// Window works on it as on the real one when constructed with it:
+// Window(std::make_unique<FakeBackend>(config)).
+class FakeBackend final : public Backend, public base::has_weak_ptr {
+public:
+	explicit FakeBackend(FakeConfig config = FakeConfig());
+	~FakeBackend();
+
+	const Ton::Settings &settings() const override;
+	rpl::producer<Ton::Update> updates() const override;
+	std::vector<QByteArray> publicKeys() const override;
+	QString getUsedAddress(const QByteArray &publicKey) const override;
+	std::unique_ptr<BackendViewer> createAccountViewer(
+		const QByteArray &publicKey,
+		const QString &address) override;
+
+	void updateSettings(
+		const Ton::Settings &settings,
+		Fn<void(Ton::Result<>)> done) override;
+	void checkConfig(
+		const QByteArray &config,
+		Fn<void(Ton::Result<>)> done) override;
+	void loadWebResource(
+		const QString &url,
+		Fn<void(Ton::Result<QByteArray>)> done) override;
+	void sync() override;
+
+	void createKey(
+		Fn<void(Ton::Result<std::vector<QString>>)> done) override;
+	void importKey(
+		const std::vector<QString> &words,
+		Fn<void(Ton::Result<>)> done) override;
+	void queryWalletAddress(Fn<void(Ton::Result<QString>)> done) override;
+	void saveKey(
+		const QByteArray &passcode,
+		const QString &address,
+		Fn<void(Ton::Result<QByteArray>)> done) override;
+	void exportKey(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		Fn<void(Ton::Result<std::vector<QString>>)> done) override;
+	void deleteAllKeys(Fn<void(Ton::Result<>)> done) override;
+	void changePassword(
+		const QByteArray &oldPasscode,
+		const QByteArray &newPasscode,
+		Fn<void(Ton::Result<>)> done) override;
+
+	void checkSendGrams(
+		const QByteArray &publicKey,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::TransactionCheckResult>)> done) override;
+	void sendGrams(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::PendingTransaction>)> ready,
+		Fn<void(Ton::Result<>)> done) override;
+	void decrypt(
+		const QByteArray &publicKey,
+		std::vector<Ton::Transaction> &&list,
+		Fn<void(Ton::Result<std::vector<Ton::Transaction>>)> done) override;
+	void updateViewersPassword(
+		const QByteArray &publicKey,
+		const QByteArray &passcode) override;
+
+private:
+	class Viewer;
+	struct Account;
+
+	[[nodiscard]] Account &account(const QByteArray &publicKey) const;
+	[[nodiscard]] std::unique_ptr<Account> generateAccount();
+	void generateHistory(Account &account);
+	[[nodiscard]] Ton::Transaction generateTransaction(
+		Account &account,
+		int64 lt,
+		TimeId time,
+		int64 balance);
+	[[nodiscard]] Ton::Message generateComment(
+		Account &account,
+		int64 lt,
+		Ton::Message message);
+	[[nodiscard]] QString generateAddress();
+	[[nodiscard]] QString generateText(int length);
+	[[nodiscard]] std::vector<QString> generateWords();
+	[[nodiscard]] QByteArray generateBytes(int size);
+	[[nodiscard]] int generateInt(int from, int till);
+	[[nodiscard]] bool generateBool(double probability);
+
+	// Calls back after a simulated network latency.
+	void later(Fn<void()> callback);
+
+	const FakeConfig _config;
+	std::mt19937 _random;
+	std::mt19937 _timing;
+	Ton::Settings _settings;
+	rpl::event_stream<Ton::Update> _updates;
+	std::vector<std::unique_ptr<Account>> _accounts;
+	std::unique_ptr<Account> _creating;
+	std::vector<QString> _dictionary;
+	std::vector<QString> _counterparties;
+	int _syncStep = -1;
+
+};
+
+} // namespace Wallet
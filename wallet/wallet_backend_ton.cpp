@@ -0,0 +1,179 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_backend_ton.h"
+
+#include "ton/ton_wallet.h"
+#include "ton/ton_account_viewer.h"
+
+namespace Wallet {
+namespace {
+
+class TonViewer final : public BackendViewer {
+public:
+	explicit TonViewer(std::unique_ptr<Ton::AccountViewer> viewer);
+
+	rpl::producer<Ton::WalletViewerState> state() override;
+	rpl::producer<Ton::Result<Ton::LoadedSlice>> loaded() override;
+
+	void refreshNow(Fn<void(Ton::Result<>)> done) override;
+	void setRefreshEach(crl::time delay) override;
+	void preloadSlice(const Ton::TransactionId &lastId) override;
+
+private:
+	const std::unique_ptr<Ton::AccountViewer> _viewer;
+
+};
+
+TonViewer::TonViewer(std::unique_ptr<Ton::AccountViewer> viewer)
+: _viewer(std::move(viewer)) {
+}
+
+rpl::producer<Ton::WalletViewerState> TonViewer::state() {
+	return _viewer->state();
+}
+
+rpl::producer<Ton::Result<Ton::LoadedSlice>> TonViewer::loaded() {
+	return _viewer->loaded();
+}
+
+void TonViewer::refreshNow(Fn<void(Ton::Result<>)> done) {
+	_viewer->refreshNow(std::move(done));
+}
+
+void TonViewer::setRefreshEach(crl::time delay) {
+	_viewer->setRefreshEach(delay);
+}
+
+void TonViewer::preloadSlice(const Ton::TransactionId &lastId) {
+	_viewer->preloadSlice(lastId);
+}
+
+} // namespace
+
+TonBackend::TonBackend(not_null<Ton::Wallet*> wallet) : _wallet(wallet) {
+}
+
+const Ton::Settings &TonBackend::settings() const {
+	return _wallet->settings();
+}
+
+rpl::producer<Ton::Update> TonBackend::updates() const {
+	return _wallet->updates();
+}
+
+std::vector<QByteArray> TonBackend::publicKeys() const {
+	return _wallet->publicKeys();
+}
+
+QString TonBackend::getUsedAddress(const QByteArray &publicKey) const {
+	return _wallet->getUsedAddress(publicKey);
+}
+
+std::unique_ptr<BackendViewer> TonBackend::createAccountViewer(
+		const QByteArray &publicKey,
+		const QString &address) {
+	return std::make_unique<TonViewer>(
+		_wallet->createAccountViewer(publicKey, address));
+}
+
+void TonBackend::updateSettings(
+		const Ton::Settings &settings,
+		Fn<void(Ton::Result<>)> done) {
+	_wallet->updateSettings(settings, std::move(done));
+}
+
+void TonBackend::checkConfig(
+		const QByteArray &config,
+		Fn<void(Ton::Result<>)> done) {
+	_wallet->checkConfig(config, std::move(done));
+}
+
+void TonBackend::loadWebResource(
+		const QString &url,
+		Fn<void(Ton::Result<QByteArray>)> done) {
+	_wallet->loadWebResource(url, std::move(done));
+}
+
+void TonBackend::sync() {
+	_wallet->sync();
+}
+
+void TonBackend::createKey(
+		Fn<void(Ton::Result<std::vector<QString>>)> done) {
+	_wallet->createKey(std::move(done));
+}
+
+void TonBackend::importKey(
+		const std::vector<QString> &words,
+		Fn<void(Ton::Result<>)> done) {
+	_wallet->importKey(words, std::move(done));
+}
+
+void TonBackend::queryWalletAddress(Fn<void(Ton::Result<QString>)> done) {
+	_wallet->queryWalletAddress(std::move(done));
+}
+
+void TonBackend::saveKey(
+		const QByteArray &passcode,
+		const QString &address,
+		Fn<void(Ton::Result<QByteArray>)> done) {
+	_wallet->saveKey(passcode, address, std::move(done));
+}
+
+void TonBackend::exportKey(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		Fn<void(Ton::Result<std::vector<QString>>)> done) {
+	_wallet->exportKey(publicKey, passcode, std::move(done));
+}
+
+void TonBackend::deleteAllKeys(Fn<void(Ton::Result<>)> done) {
+	_wallet->deleteAllKeys(std::move(done));
+}
+
+void TonBackend::changePassword(
+		const QByteArray &oldPasscode,
+		const QByteArray &newPasscode,
+		Fn<void(Ton::Result<>)> done) {
+	_wallet->changePassword(oldPasscode, newPasscode, std::move(done));
+}
+
+void TonBackend::checkSendGrams(
+		const QByteArray &publicKey,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::TransactionCheckResult>)> done) {
+	_wallet->checkSendGrams(publicKey, transaction, std::move(done));
+}
+
+void TonBackend::sendGrams(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::PendingTransaction>)> ready,
+		Fn<void(Ton::Result<>)> done) {
+	_wallet->sendGrams(
+		publicKey,
+		passcode,
+		transaction,
+		std::move(ready),
+		std::move(done));
+}
+
+void TonBackend::decrypt(
+		const QByteArray &publicKey,
+		std::vector<Ton::Transaction> &&list,
+		Fn<void(Ton::Result<std::vector<Ton::Transaction>>)> done) {
+	_wallet->decrypt(publicKey, std::move(list), std::move(done));
+}
+
+void TonBackend::updateViewersPassword(
+		const QByteArray &publicKey,
+		const QByteArray &passcode) {
+	_wallet->updateViewersPassword(publicKey, passcode);
+}
+
+} // namespace Wallet
@@ -0,0 +1,84 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "wallet/wallet_backend.h"
+
+namespace Ton {
+class Wallet;
+} // namespace Ton
+
+namespace Wallet {
+
+// Forwards everything to the real Ton::Wallet.
+class TonBackend final : public Backend {
+public:
+	explicit TonBackend(not_null<Ton::Wallet*> wallet);
+
+	const Ton::Settings &settings() const override;
+	rpl::producer<Ton::Update> updates() const override;
+	std::vector<QByteArray> publicKeys() const override;
+	QString getUsedAddress(const QByteArray &publicKey) const override;
+	std::unique_ptr<BackendViewer> createAccountViewer(
+		const QByteArray &publicKey,
+		const QString &address) override;
+
+	void updateSettings(
+		const Ton::Settings &settings,
+		Fn<void(Ton::Result<>)> done) override;
+	void checkConfig(
+		const QByteArray &config,
+		Fn<void(Ton::Result<>)> done) override;
+	void loadWebResource(
+		const QString &url,
+		Fn<void(Ton::Result<QByteArray>)> done) override;
+	void sync() override;
+
+	void createKey(
+		Fn<void(Ton::Result<std::vector<QString>>)> done) override;
+	void importKey(
+		const std::vector<QString> &words,
+		Fn<void(Ton::Result<>)> done) override;
+	void queryWalletAddress(Fn<void(Ton::Result<QString>)> done) override;
+	void saveKey(
+		const QByteArray &passcode,
+		const QString &address,
+		Fn<void(Ton::Result<QByteArray>)> done) override;
+	void exportKey(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		Fn<void(Ton::Result<std::vector<QString>>)> done) override;
+	void deleteAllKeys(Fn<void(Ton::Result<>)> done) override;
+	void changePassword(
+		const QByteArray &oldPasscode,
+		const QByteArray &newPasscode,
+		Fn<void(Ton::Result<>)> done) override;
+
+	void checkSendGrams(
+		const QByteArray &publicKey,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::TransactionCheckResult>)> done) override;
+	void sendGrams(
+		const QByteArray &publicKey,
+		const QByteArray &passcode,
+		const Ton::TransactionToSend &transaction,
+		Fn<void(Ton::Result<Ton::PendingTransaction>)> ready,
+		Fn<void(Ton::Result<>)> done) override;
+	void decrypt(
+		const QByteArray &publicKey,
+		std::vector<Ton::Transaction> &&list,
+		Fn<void(Ton::Result<std::vector<Ton::Transaction>>)> done) override;
+	void updateViewersPassword(
+		const QByteArray &publicKey,
+		const QByteArray &passcode) override;
+
+private:
+	const not_null<Ton::Wallet*> _wallet;
+
+};
+
+} // namespace Wallet
@@ -0,0 +1,163 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_balance_series.h"
+
+#include "wallet/wallet_common.h"
+
+namespace Wallet {
+
+void BalanceSeries::setCurrent(int64 balance) {
+	_current = balance;
+}
+
+void BalanceSeries::insert(int index, Iterator from, Iterator till) {
+	Expects(index >= 0 && index <= size());
+
+	const auto count = int(till - from);
+	if (!count) {
+		return;
+	}
+	const auto wasSize = size();
+	const auto changes = ranges::make_subrange(
+		from,
+		till
+	) | ranges::view::transform(Change) | ranges::to_vector;
+	const auto times = ranges::make_subrange(
+		from,
+		till
+	) | ranges::view::transform(&Ton::Transaction::time) | ranges::to_vector;
+	_change.insert(begin(_change) + index, begin(changes), end(changes));
+	_time.insert(begin(_time) + index, begin(times), end(times));
+	_sum.insert(begin(_sum) + index, count, int64(0));
+
+	// The balance after a transaction is the balance after the older
+	// one plus its own change: sum[i] = sum[i + 1] + change[i].
+	if (index == wasSize && wasSize > 0) {
+		for (auto i = index; i != index + count; ++i) {
+			_sum[i] = _sum[i - 1] - _change[i - 1];
+		}
+		return;
+	}
+	auto i = index + count - 1;
+	if (i == size() - 1) {
+		_sum[i] = _change[i];
+		--i;
+	}
+	for (; i >= 0; --i) {
+		_sum[i] = _sum[i + 1] + _change[i];
+	}
+}
+
+void BalanceSeries::clear() {
+	_time.clear();
+	_change.clear();
+	_sum.clear();
+}
+
+int BalanceSeries::size() const {
+	return int(_sum.size());
+}
+
+bool BalanceSeries::empty() const {
+	return _sum.empty();
+}
+
+bool BalanceSeries::known() const {
+	return !empty() && (_current != Ton::kUnknownBalance);
+}
+
+auto BalanceSeries::point(int index) const -> Point {
+	Expects(known());
+	Expects(index >= 0 && index < size());
+
+	return { _time[index], _current + _sum[index] - _sum.front() };
+}
+
+int64 BalanceSeries::startBalance() const {
+	Expects(known());
+
+	return point(size() - 1).balance - _change.back();
+}
+
+int BalanceSeries::findNegative(int from, int till) const {
+	Expects(known());
+	Expects(from >= 0 && from <= till && till <= size());
+
+	for (auto i = from; i != till; ++i) {
+		if (point(i).balance < 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+auto BalanceSeries::sample(int count) const -> std::vector<Point> {
+	if (!known()) {
+		return {};
+	}
+	const auto total = size();
+	const auto oldest = [&](int index) {
+		return point(total - 1 - index);
+	};
+	auto result = std::vector<Point>();
+	if (count >= total || count < 3) {
+		result.reserve(total);
+		for (auto i = 0; i != total; ++i) {
+			result.push_back(oldest(i));
+		}
+		return result;
+	}
+	result.reserve(count);
+	result.push_back(oldest(0));
+
+	// Each bucket gives the point forming the largest triangle with
+	// the point chosen from the previous bucket and the average one
+	// of the next bucket.
+	const auto bucket = (total - 2) / double(count - 2);
+	auto chosen = oldest(0);
+	for (auto b = 0; b != count - 2; ++b) {
+		const auto nextFrom = int((b + 1) * bucket) + 1;
+		const auto nextTill = std::min(int((b + 2) * bucket) + 1, total);
+		auto averageTime = 0.;
+		auto averageBalance = 0.;
+		for (auto i = nextFrom; i != nextTill; ++i) {
+			const auto next = oldest(i);
+			averageTime += next.time;
+			averageBalance += next.balance;
+		}
+		const auto nextCount = std::max(nextTill - nextFrom, 1);
+		averageTime /= nextCount;
+		averageBalance /= nextCount;
+
+		const auto from = int(b * bucket) + 1;
+		const auto till = int((b + 1) * bucket) + 1;
+		auto best = oldest(from);
+		auto bestArea = -1.;
+		for (auto i = from; i != till; ++i) {
+			const auto current = oldest(i);
+			const auto area = std::abs(
+				(double(chosen.time) - averageTime)
+					* (double(current.balance) - chosen.balance)
+				- (double(chosen.time) - current.time)
+					* (averageBalance - chosen.balance));
+			if (area > bestArea) {
+				bestArea = area;
+				best = current;
+			}
+		}
+		result.push_back(best);
+		chosen = best;
+	}
+	result.push_back(oldest(total - 1));
+	return result;
+}
+
+int64 BalanceSeries::Change(const Ton::Transaction &data) {
+	return CalculateValue(data) - data.fee;
+}
+
+} // namespace Wallet
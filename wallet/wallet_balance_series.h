@@ -0,0 +1,59 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+
+#include <deque>
+
+namespace Wallet {
+
+// Account balance after each loaded transaction, newest first.
+//
+// The balance changes are summed up relative to an arbitrary origin, so
+// adding k transactions to either end costs O(k) and only filling a gap
+// in the middle recomputes the newer part above it. The newest point is
+// anchored to the current balance of the account.
+class BalanceSeries final {
+public:
+	struct Point {
+		TimeId time = 0;
+		int64 balance = 0;
+	};
+	using Iterator = std::vector<Ton::Transaction>::const_iterator;
+
+	void setCurrent(int64 balance);
+	void insert(int index, Iterator from, Iterator till);
+	void clear();
+
+	[[nodiscard]] int size() const;
+	[[nodiscard]] bool empty() const;
+	[[nodiscard]] bool known() const;
+	[[nodiscard]] Point point(int index) const;
+
+	// Balance before the oldest loaded transaction, it is zero when the
+	// whole history is loaded, otherwise some transactions are missing.
+	[[nodiscard]] int64 startBalance() const;
+
+	// First point in the range with a negative balance, -1 if none.
+	[[nodiscard]] int findNegative(int from, int till) const;
+
+	// At most 'count' points, oldest first, that keep the shape of the
+	// series, chosen by the largest triangle three buckets algorithm.
+	[[nodiscard]] std::vector<Point> sample(int count) const;
+
+private:
+	[[nodiscard]] static int64 Change(const Ton::Transaction &data);
+
+	std::deque<TimeId> _time;
+	std::deque<int64> _change;
+	std::deque<int64> _sum;
+	int64 _current = Ton::kUnknownBalance;
+
+};
+
+} // namespace Wallet
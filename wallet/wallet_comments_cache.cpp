@@ -0,0 +1,637 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_comments_cache.h"
+
+#include "wallet/wallet_common.h"
+#include "wallet/wallet_log.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <crl/crl_async.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+namespace Wallet {
+namespace {
+
+constexpr auto kMagic = quint32(0x434D5754);
+constexpr auto kVersion = qint32(3);
+constexpr auto kStreamVersion = QDataStream::Qt_5_1;
+constexpr auto kSaltSize = 16;
+constexpr auto kKeySize = 32;
+constexpr auto kNonceSize = 12;
+constexpr auto kTagSize = 16;
+constexpr auto kWrappedKeySize = kNonceSize + kKeySize + kTagSize;
+constexpr auto kHeaderSize = qint64(8 + kSaltSize + 2 * kWrappedKeySize);
+constexpr auto kRecordHeaderSize = qint64(4);
+constexpr auto kKeyIterations = 100'000;
+constexpr auto kCopyChunk = qint64(64 * 1024);
+
+using CipherContext = std::unique_ptr<
+	EVP_CIPHER_CTX,
+	decltype(&EVP_CIPHER_CTX_free)>;
+
+[[nodiscard]] CipherContext MakeCipherContext() {
+	return CipherContext(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+}
+
+[[nodiscard]] unsigned char *Bytes(QByteArray &data) {
+	return reinterpret_cast<unsigned char*>(data.data());
+}
+
+[[nodiscard]] const unsigned char *Bytes(const QByteArray &data) {
+	return reinterpret_cast<const unsigned char*>(data.constData());
+}
+
+[[nodiscard]] QByteArray RandomBytes(int size) {
+	auto result = QByteArray(size, Qt::Uninitialized);
+	return (RAND_bytes(Bytes(result), size) == 1) ? result : QByteArray();
+}
+
+[[nodiscard]] QByteArray DeriveKey(
+		const QByteArray &passcode,
+		const QByteArray &salt) {
+	auto result = QByteArray(kKeySize, Qt::Uninitialized);
+	const auto success = PKCS5_PBKDF2_HMAC(
+		passcode.constData(),
+		passcode.size(),
+		Bytes(salt),
+		salt.size(),
+		kKeyIterations,
+		EVP_sha256(),
+		kKeySize,
+		Bytes(result));
+	return (success == 1) ? result : QByteArray();
+}
+
+[[nodiscard]] QByteArray Encrypt(
+		const QByteArray &key,
+		const QByteArray &data) {
+	Expects(key.size() == kKeySize);
+
+	auto result = QByteArray(
+		kNonceSize + data.size() + kTagSize,
+		Qt::Uninitialized);
+	const auto nonce = Bytes(result);
+	const auto encrypted = nonce + kNonceSize;
+	const auto tag = encrypted + data.size();
+	const auto context = MakeCipherContext();
+	auto length = 0;
+	if (!context
+		|| RAND_bytes(nonce, kNonceSize) != 1
+		|| EVP_EncryptInit_ex(
+			context.get(),
+			EVP_aes_256_gcm(),
+			nullptr,
+			Bytes(key),
+			nonce) != 1
+		|| EVP_EncryptUpdate(
+			context.get(),
+			encrypted,
+			&length,
+			Bytes(data),
+			data.size()) != 1
+		|| EVP_EncryptFinal_ex(
+			context.get(),
+			encrypted + length,
+			&length) != 1
+		|| EVP_CIPHER_CTX_ctrl(
+			context.get(),
+			EVP_CTRL_GCM_GET_TAG,
+			kTagSize,
+			tag) != 1) {
+		return QByteArray();
+	}
+	return result;
+}
+
+[[nodiscard]] std::optional<QByteArray> Decrypt(
+		const QByteArray &key,
+		const QByteArray &sealed) {
+	Expects(key.size() == kKeySize);
+
+	const auto size = sealed.size() - kNonceSize - kTagSize;
+	if (size < 0) {
+		return std::nullopt;
+	}
+	auto result = QByteArray(size, Qt::Uninitialized);
+	const auto nonce = Bytes(sealed);
+	const auto encrypted = nonce + kNonceSize;
+	auto tag = QByteArray::fromRawData(
+		sealed.constData() + kNonceSize + size,
+		kTagSize);
+	const auto context = MakeCipherContext();
+	auto length = 0;
+	if (!context
+		|| EVP_DecryptInit_ex(
+			context.get(),
+			EVP_aes_256_gcm(),
+			nullptr,
+			Bytes(key),
+			nonce) != 1
+		|| EVP_DecryptUpdate(
+			context.get(),
+			Bytes(result),
+			&length,
+			encrypted,
+			size) != 1
+		|| EVP_CIPHER_CTX_ctrl(
+			context.get(),
+			EVP_CTRL_GCM_SET_TAG,
+			kTagSize,
+			const_cast<char*>(tag.constData())) != 1
+		|| EVP_DecryptFinal_ex(
+			context.get(),
+			Bytes(result) + length,
+			&length) != 1) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+[[nodiscard]] QString LocalSecretPath(const QString &folder) {
+	return folder + "/comments_secret";
+}
+
+[[nodiscard]] QByteArray EmptySlot() {
+	return QByteArray(kWrappedKeySize, char(0));
+}
+
+[[nodiscard]] QByteArray WrapKey(
+		const QByteArray &wrapping,
+		const QByteArray &key) {
+	const auto result = (wrapping.size() == kKeySize)
+		? Encrypt(wrapping, key)
+		: QByteArray();
+	return (result.size() == kWrappedKeySize) ? result : QByteArray();
+}
+
+[[nodiscard]] QByteArray UnwrapKey(
+		const QByteArray &wrapping,
+		const QByteArray &slot) {
+	if (wrapping.size() != kKeySize || slot == EmptySlot()) {
+		return QByteArray();
+	}
+	const auto key = Decrypt(wrapping, slot);
+	return (key && key->size() == kKeySize) ? *key : QByteArray();
+}
+
+// The key of the file encrypted with the local secret, empty slot on error.
+[[nodiscard]] QByteArray LocalSlot(
+		const QByteArray &secret,
+		const QByteArray &key) {
+	const auto result = WrapKey(secret, key);
+	return result.isEmpty() ? EmptySlot() : result;
+}
+
+// The key of the file encrypted with the passcode, empty slot on error.
+[[nodiscard]] QByteArray PasscodeSlot(
+		const QByteArray &passcode,
+		const QByteArray &salt,
+		const QByteArray &key) {
+	const auto result = passcode.isEmpty()
+		? QByteArray()
+		: WrapKey(DeriveKey(passcode, salt), key);
+	return result.isEmpty() ? EmptySlot() : result;
+}
+
+[[nodiscard]] bool CopyTail(QFile &from, QIODevice &to) {
+	while (!from.atEnd()) {
+		const auto chunk = from.read(kCopyChunk);
+		if (chunk.isEmpty() || to.write(chunk) != chunk.size()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+struct CommentsCache::Loaded {
+	QByteArray key;
+	Header header;
+	std::unordered_map<int64, Entry> entries;
+	qint64 validSize = 0;
+	bool locked = false;
+	bool rewriteHeader = false;
+};
+
+CommentsCache::CommentsCache(
+	const QString &folder,
+	const QString &address,
+	bool useTestNetwork,
+	const QByteArray &localSecret)
+: _path(folder
+	+ '/'
+	+ (useTestNetwork ? "comments_test_" : "comments_")
+	+ QString::fromLatin1(QCryptographicHash::hash(
+		address.toUtf8(),
+		QCryptographicHash::Sha256).toHex().left(32)))
+, _localSecret(localSecret) {
+}
+
+CommentsCache::~CommentsCache() = default;
+
+QByteArray CommentsCache::LocalSecret(const QString &folder) {
+	const auto path = LocalSecretPath(folder);
+	auto file = QFile(path);
+	if (file.open(QIODevice::ReadOnly)) {
+		auto result = file.read(kKeySize + 1);
+		if (result.size() == kKeySize) {
+			return result;
+		}
+		file.close();
+	}
+	const auto result = RandomBytes(kKeySize);
+	QDir().mkpath(folder);
+	auto saving = QSaveFile(path);
+	if (result.isEmpty()
+		|| !saving.open(QIODevice::WriteOnly)
+		|| saving.write(result) != result.size()
+		|| !saving.commit()) {
+		WALLET_LOG(("Comments cache: could not write '%1'.").arg(path));
+		return QByteArray();
+	}
+	return result;
+}
+
+void CommentsCache::RemoveLocalSecret(const QString &folder) {
+	QFile::remove(LocalSecretPath(folder));
+}
+
+void CommentsCache::open(Fn<void()> loaded) {
+	if (_loading || _ready) {
+		return;
+	}
+	_loadedCallback = std::move(loaded);
+	load(QByteArray());
+}
+
+void CommentsCache::unlock(const QByteArray &passcode) {
+	if (passcode.isEmpty()) {
+		return;
+	} else if (_loading) {
+		_unlockWhileLoading = passcode;
+	} else if (!_ready) {
+		// Written with another local secret, the passcode opens it.
+		load(passcode);
+	} else if (_header.passcodeSlot == EmptySlot()) {
+		changePasscode(passcode);
+	}
+}
+
+void CommentsCache::changePasscode(const QByteArray &passcode) {
+	if (_loading) {
+		_passcodeWhileLoading = passcode;
+		return;
+	} else if (!_ready) {
+		return;
+	}
+	const auto ready = crl::guard(this, [=](QByteArray slot) {
+		auto header = _header;
+		header.passcodeSlot = std::move(slot);
+		writeHeader(header);
+	});
+	crl::async([=, key = _key, salt = _header.salt] {
+		auto slot = PasscodeSlot(passcode, salt, key);
+		crl::on_main([=, slot = std::move(slot)]() mutable {
+			ready(std::move(slot));
+		});
+	});
+}
+
+void CommentsCache::load(const QByteArray &passcode) {
+	Expects(!_loading && !_ready);
+
+	_loading = true;
+
+	// A new key is used if there is no valid file yet, it is generated
+	// here so that no random data is created from the background threads.
+	const auto freshKey = RandomBytes(kKeySize);
+	const auto freshSalt = RandomBytes(kSaltSize);
+	const auto ready = crl::guard(this, [=](Loaded result) {
+		loaded(std::move(result));
+	});
+	crl::async([=, path = _path, secret = _localSecret] {
+		auto result = ReadFile(
+			path,
+			secret,
+			passcode,
+			freshKey,
+			freshSalt);
+		crl::on_main([=, result = std::move(result)]() mutable {
+			ready(std::move(result));
+		});
+	});
+}
+
+auto CommentsCache::ReadFile(
+		const QString &path,
+		const QByteArray &localSecret,
+		const QByteArray &passcode,
+		const QByteArray &freshKey,
+		const QByteArray &freshSalt) -> Loaded {
+	auto result = Loaded();
+	auto file = QFile(path);
+	auto header = std::optional<Header>();
+	if (file.open(QIODevice::ReadOnly)) {
+		header = ParseHeader(file.read(kHeaderSize));
+	}
+	if (header) {
+		result.header = *header;
+		result.key = UnwrapKey(localSecret, header->localSlot);
+		if (result.key.isEmpty() && !passcode.isEmpty()) {
+			result.key = UnwrapKey(
+				DeriveKey(passcode, header->salt),
+				header->passcodeSlot);
+			result.header.localSlot = LocalSlot(localSecret, result.key);
+			result.rewriteHeader = !result.key.isEmpty();
+		} else if (result.key.isEmpty()
+			&& header->passcodeSlot != EmptySlot()) {
+			// Waits for the passcode instead of dropping the comments.
+			result.locked = true;
+			return result;
+		} else if (!result.key.isEmpty()
+			&& !passcode.isEmpty()
+			&& header->passcodeSlot == EmptySlot()) {
+			result.header.passcodeSlot = PasscodeSlot(
+				passcode,
+				header->salt,
+				result.key);
+			result.rewriteHeader = true;
+		}
+	}
+	if (result.key.isEmpty()) {
+		// No file, a broken one or one that no secret opens anymore.
+		result.key = freshKey;
+		result.header.salt = freshSalt;
+		result.header.passcodeSlot = PasscodeSlot(
+			passcode,
+			freshSalt,
+			result.key);
+		result.header.localSlot = LocalSlot(localSecret, result.key);
+		if (freshSalt.size() != kSaltSize) {
+			result.key = QByteArray();
+		}
+		return result;
+	}
+	auto stream = QDataStream(&file);
+	stream.setVersion(kStreamVersion);
+
+	const auto size = file.size();
+	auto offset = kHeaderSize;
+	while (offset + kRecordHeaderSize <= size) {
+		auto length = quint32();
+		stream >> length;
+		const auto till = offset + kRecordHeaderSize + length;
+		if (stream.status() != QDataStream::Ok || till > size) {
+			break;
+		}
+		const auto decrypted = Decrypt(result.key, file.read(length));
+		if (!decrypted) {
+			break;
+		}
+		auto record = QDataStream(*decrypted);
+		record.setVersion(kStreamVersion);
+		auto count = qint32();
+		record >> count;
+		auto entries = std::vector<std::pair<int64, Entry>>();
+		for (auto i = 0; i < count && record.status() == QDataStream::Ok; ++i) {
+			auto lt = qint64();
+			auto entry = Entry();
+			record >> lt >> entry.hash >> entry.text;
+			entries.emplace_back(lt, std::move(entry));
+		}
+		if (record.status() != QDataStream::Ok) {
+			break;
+		}
+		for (auto &[lt, entry] : entries) {
+			result.entries[lt] = std::move(entry);
+		}
+		offset = till;
+	}
+	result.validSize = offset;
+	return result;
+}
+
+auto CommentsCache::ParseHeader(const QByteArray &bytes)
+-> std::optional<Header> {
+	if (bytes.size() != kHeaderSize) {
+		return std::nullopt;
+	}
+	auto stream = QDataStream(bytes);
+	stream.setVersion(kStreamVersion);
+	auto magic = quint32();
+	auto version = qint32();
+	stream >> magic >> version;
+	if (stream.status() != QDataStream::Ok
+		|| magic != kMagic
+		|| version != kVersion) {
+		return std::nullopt;
+	}
+	auto result = Header();
+	result.salt = bytes.mid(8, kSaltSize);
+	result.passcodeSlot = bytes.mid(8 + kSaltSize, kWrappedKeySize);
+	result.localSlot = bytes.mid(
+		8 + kSaltSize + kWrappedKeySize,
+		kWrappedKeySize);
+	return result;
+}
+
+QByteArray CommentsCache::SerializeHeader(const Header &header) {
+	if (header.salt.size() != kSaltSize
+		|| header.passcodeSlot.size() != kWrappedKeySize
+		|| header.localSlot.size() != kWrappedKeySize) {
+		return QByteArray();
+	}
+	auto result = QByteArray();
+	{
+		auto stream = QDataStream(&result, QIODevice::WriteOnly);
+		stream.setVersion(kStreamVersion);
+		stream << kMagic << kVersion;
+	}
+	return result + header.salt + header.passcodeSlot + header.localSlot;
+}
+
+void CommentsCache::loaded(Loaded &&result) {
+	_loading = false;
+	_key = std::move(result.key);
+	_header = std::move(result.header);
+	_entries = std::move(result.entries);
+
+	if (result.locked) {
+		WALLET_LOG(("Comments cache: waiting for the passcode."));
+	} else if (_key.isEmpty()) {
+		WALLET_LOG(("Comments cache: could not prepare the key."));
+	} else {
+		QDir().mkpath(QFileInfo(_path).absolutePath());
+		_file.setFileName(_path);
+		if (_file.open(QIODevice::ReadWrite)) {
+			if (result.validSize < kHeaderSize) {
+				if (_file.size() > 0) {
+					WALLET_LOG(("Comments cache: recreating '%1', "
+						"%2 bytes could not be read."
+						).arg(_path
+						).arg(_file.size()));
+				}
+				_entries.clear();
+				_file.resize(0);
+				_file.write(SerializeHeader(_header));
+			} else if (_file.size() != result.validSize) {
+				WALLET_LOG(("Comments cache: truncating a broken tail, "
+					"%1 bytes of %2 are valid."
+					).arg(result.validSize
+					).arg(_file.size()));
+				_file.resize(result.validSize);
+			}
+			_file.seek(_file.size());
+			_ready = true;
+		} else {
+			WALLET_LOG(("Comments cache: could not open '%1'."
+				).arg(_path));
+		}
+	}
+	if (_ready && result.rewriteHeader) {
+		writeHeader(_header);
+	}
+
+	if (_ready && _loadedCallback) {
+		_loadedCallback();
+	}
+	for (const auto &list : base::take(_savesWhileLoading)) {
+		save(list);
+	}
+	if (const auto passcode = base::take(_unlockWhileLoading)) {
+		unlock(*passcode);
+	}
+	if (const auto passcode = base::take(_passcodeWhileLoading)) {
+		changePasscode(*passcode);
+	}
+}
+
+bool CommentsCache::restore(not_null<Ton::Transaction*> data) const {
+	if (!IsEncryptedMessage(*data)) {
+		return false;
+	}
+	const auto i = _entries.find(data->id.lt);
+	if (i == end(_entries) || i->second.hash != data->id.hash) {
+		return false;
+	}
+	auto &comment = data->outgoing.empty()
+		? data->incoming.message
+		: data->outgoing.front().message;
+	comment.text = i->second.text;
+	comment.decrypted = true;
+	return true;
+}
+
+void CommentsCache::save(const std::vector<Ton::Transaction> &list) {
+	if (_loading) {
+		_savesWhileLoading.push_back(list);
+		return;
+	} else if (!_ready) {
+		return;
+	}
+	auto added = std::vector<std::pair<int64, Entry>>();
+	for (const auto &data : list) {
+		const auto &comment = data.outgoing.empty()
+			? data.incoming.message
+			: data.outgoing.front().message;
+		if (!comment.decrypted
+			|| comment.encrypted.isEmpty()
+			|| _entries.find(data.id.lt) != end(_entries)) {
+			continue;
+		}
+		added.emplace_back(data.id.lt, Entry{ data.id.hash, comment.text });
+	}
+	if (added.empty()) {
+		return;
+	}
+	write(added);
+	for (auto &[lt, entry] : added) {
+		_entries.emplace(lt, std::move(entry));
+	}
+}
+
+void CommentsCache::write(const std::vector<std::pair<int64, Entry>> &list) {
+	auto plain = QByteArray();
+	{
+		auto stream = QDataStream(&plain, QIODevice::WriteOnly);
+		stream.setVersion(kStreamVersion);
+		stream << qint32(list.size());
+		for (const auto &[lt, entry] : list) {
+			stream << qint64(lt) << entry.hash << entry.text;
+		}
+	}
+	const auto sealed = Encrypt(_key, plain);
+	if (sealed.isEmpty()) {
+		WALLET_LOG(("Comments cache: could not encrypt a record."));
+		return;
+	}
+	auto header = QByteArray();
+	{
+		auto stream = QDataStream(&header, QIODevice::WriteOnly);
+		stream.setVersion(kStreamVersion);
+		stream << quint32(sealed.size());
+	}
+	if (_file.write(header) != header.size()
+		|| _file.write(sealed) != sealed.size()
+		|| !_file.flush()) {
+		WALLET_LOG(("Comments cache: could not write to '%1'.").arg(_path));
+		_file.close();
+		_ready = false;
+	}
+}
+
+void CommentsCache::writeHeader(const Header &header) {
+	if (!_ready) {
+		return;
+	}
+	const auto bytes = SerializeHeader(header);
+	if (bytes.isEmpty()) {
+		WALLET_LOG(("Comments cache: could not encrypt the key."));
+		return;
+	}
+
+	// The file is written again with the new header and replaces the old
+	// one only when complete, so an interrupted write keeps the old one.
+	_file.close();
+	auto saving = QSaveFile(_path);
+	auto source = QFile(_path);
+	if (!source.open(QIODevice::ReadOnly)
+		|| !source.seek(kHeaderSize)
+		|| !saving.open(QIODevice::WriteOnly)
+		|| saving.write(bytes) != bytes.size()
+		|| !CopyTail(source, saving)
+		|| !saving.commit()) {
+		WALLET_LOG(("Comments cache: could not rewrite the header "
+			"of '%1'.").arg(_path));
+	} else {
+		_header = header;
+	}
+	source.close();
+	if (!_file.open(QIODevice::ReadWrite) || !_file.seek(_file.size())) {
+		WALLET_LOG(("Comments cache: could not open '%1'.").arg(_path));
+		_file.close();
+		_ready = false;
+	}
+}
+
+void CommentsCache::remove() {
+	_file.close();
+	QFile::remove(_path);
+	_entries.clear();
+	_savesWhileLoading.clear();
+	_unlockWhileLoading = std::nullopt;
+	_passcodeWhileLoading = std::nullopt;
+	_ready = false;
+}
+
+} // namespace Wallet
@@ -0,0 +1,96 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+#include "base/weak_ptr.h"
+
+#include <QtCore/QFile>
+#include <unordered_map>
+
+namespace Wallet {
+
+// Decrypted comments of one account kept on disk between sessions, so that
+// they are shown without decrypting them again.
+//
+// The file is append-only, each record holds a batch of comments encrypted
+// with AES-256-GCM. The random key of the file is stored in its header
+// twice: encrypted with the local secret of the wallet folder, so that the
+// cache is read at startup without asking for the passcode, and encrypted
+// with a key derived from the passcode, so that a cache which the local
+// secret doesn't open anymore is read once the passcode is entered.
+class CommentsCache final : public base::has_weak_ptr {
+public:
+	CommentsCache(
+		const QString &folder,
+		const QString &address,
+		bool useTestNetwork,
+		const QByteArray &localSecret);
+	~CommentsCache();
+
+	// Reads the secret of the folder or creates it, on the main thread.
+	[[nodiscard]] static QByteArray LocalSecret(const QString &folder);
+	static void RemoveLocalSecret(const QString &folder);
+
+	// Reads the cache with the local secret, 'loaded' is called each time
+	// the comments are read, now or after unlock().
+	void open(Fn<void()> loaded);
+
+	// Called with a passcode checked by the wallet. Reads a cache that the
+	// local secret didn't open, or stores the key encrypted with it.
+	void unlock(const QByteArray &passcode);
+
+	// Encrypts the key of the file with the new passcode.
+	void changePasscode(const QByteArray &passcode);
+
+	// Puts the cached text to an encrypted comment, returns false on a miss.
+	bool restore(not_null<Ton::Transaction*> data) const;
+	void save(const std::vector<Ton::Transaction> &list);
+	void remove();
+
+private:
+	struct Entry {
+		QByteArray hash;
+		QString text;
+	};
+	struct Header {
+		QByteArray salt;
+		QByteArray passcodeSlot;
+		QByteArray localSlot;
+	};
+	struct Loaded;
+
+	[[nodiscard]] static Loaded ReadFile(
+		const QString &path,
+		const QByteArray &localSecret,
+		const QByteArray &passcode,
+		const QByteArray &freshKey,
+		const QByteArray &freshSalt);
+	[[nodiscard]] static std::optional<Header> ParseHeader(
+		const QByteArray &bytes);
+	[[nodiscard]] static QByteArray SerializeHeader(const Header &header);
+	void load(const QByteArray &passcode);
+	void loaded(Loaded &&result);
+	void write(const std::vector<std::pair<int64, Entry>> &list);
+	void writeHeader(const Header &header);
+
+	const QString _path;
+	const QByteArray _localSecret;
+	QByteArray _key;
+	Header _header;
+	QFile _file;
+	std::unordered_map<int64, Entry> _entries;
+	std::vector<std::vector<Ton::Transaction>> _savesWhileLoading;
+	std::optional<QByteArray> _unlockWhileLoading;
+	std::optional<QByteArray> _passcodeWhileLoading;
+	Fn<void()> _loadedCallback;
+	bool _loading = false;
+	bool _ready = false;
+
+};
+
+} // namespace Wallet
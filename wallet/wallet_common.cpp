@@ -15,6 +15,7 @@
 #include "styles/style_wallet.h"
 
 #include <QtCore/QLocale>
+#include <QtCore/QRegularExpression>
 
 namespace Wallet {
 namespace {
@@ -284,6 +285,14 @@ QString TransferLink(
 		: (base + '?' + params.join('&'));
 }
 
+bool ValidateTransferLink(const QString &link) {
+	return QRegularExpression(
+		QString("^((ton://)?transfer/)?[a-z0-9_\\-]{%1}/?($|\\?)"
+		).arg(kAddressLength),
+		QRegularExpression::CaseInsensitiveOption
+	).match(link.trimmed()).hasMatch();
+}
+
 not_null<Ui::FlatLabel*> AddBoxSubtitle(
 		not_null<Ui::VerticalLayout*> container,
 		rpl::producer<QString> text) {
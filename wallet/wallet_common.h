@@ -46,6 +46,8 @@ struct PreparedInvoice {
 enum class Action {
 	Refresh,
 	Export,
+	ExportHistory,
+	Payout,
 	Send,
 	Receive,
 	ChangePassword,
@@ -76,6 +78,7 @@ using FormatFlags = base::flags<FormatFlag>;
 	const QString &address,
 	int64 amount = 0,
 	const QString &comment = QString());
+[[nodiscard]] bool ValidateTransferLink(const QString &link);
 
 not_null<Ui::FlatLabel*> AddBoxSubtitle(
 	not_null<Ui::VerticalLayout*> box,
@@ -0,0 +1,88 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_config_stamp.h"
+
+#include "wallet/wallet_log.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+namespace Wallet {
+namespace {
+
+constexpr auto kMagic = quint32(0x43465754);
+constexpr auto kVersion = qint32(1);
+constexpr auto kStreamVersion = QDataStream::Qt_5_1;
+
+} // namespace
+
+QByteArray ConfigHash(const QByteArray &config) {
+	const auto document = QJsonDocument::fromJson(config);
+	if (!document.isObject()) {
+		return QByteArray();
+	}
+
+	// QJsonObject keeps the keys sorted, so the compact form is canonical.
+	return QCryptographicHash::hash(
+		document.toJson(QJsonDocument::Compact),
+		QCryptographicHash::Sha256);
+}
+
+QString ConfigStampPath(const QString &folder, bool useTestNetwork) {
+	return folder + (useTestNetwork ? "/config_test_stamp" : "/config_stamp");
+}
+
+ConfigStamp ReadConfigStamp(const QString &path) {
+	auto file = QFile(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return ConfigStamp();
+	}
+	auto stream = QDataStream(&file);
+	stream.setVersion(kStreamVersion);
+
+	auto magic = quint32();
+	auto version = qint32();
+	auto result = ConfigStamp();
+	auto fetched = qint32();
+	stream
+		>> magic
+		>> version
+		>> result.url
+		>> result.hash
+		>> fetched;
+	if (stream.status() != QDataStream::Ok
+		|| magic != kMagic
+		|| version != kVersion) {
+		return ConfigStamp();
+	}
+	result.fetched = fetched;
+	return result;
+}
+
+void WriteConfigStamp(const QString &path, const ConfigStamp &stamp) {
+	QDir().mkpath(QFileInfo(path).absolutePath());
+	auto file = QFile(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		WALLET_LOG(("Config: could not write stamp to '%1'.").arg(path));
+		return;
+	}
+	auto stream = QDataStream(&file);
+	stream.setVersion(kStreamVersion);
+	stream
+		<< kMagic
+		<< kVersion
+		<< stamp.url
+		<< stamp.hash
+		<< qint32(stamp.fetched);
+}
+
+} // namespace Wallet
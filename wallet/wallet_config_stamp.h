@@ -0,0 +1,30 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+namespace Wallet {
+
+// The config itself is kept in the wallet settings, the stamp next to it
+// remembers its hash and when it was fetched, so that a fresh download
+// is compared to it without parsing the stored config again.
+struct ConfigStamp {
+	QString url;
+	QByteArray hash;
+	TimeId fetched = 0;
+};
+
+// Hash of the config contents not depending on the formatting and on the
+// order of the keys, empty if the config is not a valid JSON object.
+[[nodiscard]] QByteArray ConfigHash(const QByteArray &config);
+
+[[nodiscard]] QString ConfigStampPath(
+	const QString &folder,
+	bool useTestNetwork);
+[[nodiscard]] ConfigStamp ReadConfigStamp(const QString &path);
+void WriteConfigStamp(const QString &path, const ConfigStamp &stamp);
+
+} // namespace Wallet
@@ -17,9 +17,14 @@
 #include "styles/style_wallet.h"
 #include "styles/palette.h"
 
+#include <QtGui/QPainterPath>
+
 namespace Wallet {
 namespace {
 
+constexpr auto kChartPoints = 256;
+constexpr auto kChartOpacity = 0.35;
+
 not_null<Ui::RoundButton*> CreateCoverButton(
 		not_null<QWidget*> parent,
 		rpl::producer<QString> text,
@@ -63,6 +68,51 @@ int Cover::height() const {
 	return _widget.height();
 }
 
+void Cover::setBalanceChart(
+		rpl::producer<not_null<const BalanceSeries*>> changes) {
+	std::move(
+		changes
+	) | rpl::start_with_next([=](not_null<const BalanceSeries*> series) {
+		_chart = series->sample(kChartPoints);
+		_widget.update();
+	}, lifetime());
+}
+
+void Cover::paintChart(QPainter &p) const {
+	if (_chart.size() < 2) {
+		return;
+	}
+	const auto [minTime, maxTime] = ranges::minmax(
+		_chart | ranges::view::transform(&BalanceSeries::Point::time));
+	const auto [minBalance, maxBalance] = ranges::minmax(
+		_chart | ranges::view::transform(&BalanceSeries::Point::balance));
+	if (minTime == maxTime) {
+		return;
+	}
+	const auto width = _widget.width();
+	const auto height = st::walletCoverChartHeight;
+	const auto bottom = _widget.height() - st::walletCoverChartBottom;
+	const auto x = [&](TimeId time) {
+		return width * double(time - minTime) / (maxTime - minTime);
+	};
+	const auto y = [&](int64 balance) {
+		return bottom - ((maxBalance > minBalance)
+			? (height * double(balance - minBalance)
+				/ (maxBalance - minBalance))
+			: (height / 2.));
+	};
+	auto path = QPainterPath();
+	path.moveTo(x(_chart.front().time), y(_chart.front().balance));
+	for (const auto &point : _chart | ranges::view::drop(1)) {
+		path.lineTo(x(point.time), y(point.balance));
+	}
+	p.setRenderHint(QPainter::Antialiasing);
+	p.setOpacity(kChartOpacity);
+	p.setPen(QPen(st::walletSubBalanceFg->c, st::walletCoverChartStroke));
+	p.setBrush(Qt::NoBrush);
+	p.drawPath(path);
+}
+
 rpl::producer<> Cover::sendRequests() const {
 	return _sendRequests.events();
 }
@@ -265,7 +315,9 @@ void Cover::setupControls() {
 
 	_widget.paintRequest(
 	) | rpl::start_with_next([=](QRect clip) {
-		QPainter(&_widget).fillRect(clip, st::walletTopBg);
+		auto p = QPainter(&_widget);
+		p.fillRect(clip, st::walletTopBg);
+		paintChart(p);
 	}, lifetime());
 }
 
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "ui/rp_widget.h"
+#include "wallet/wallet_balance_series.h"
 
 namespace Ton {
 struct WalletViewerState;
@@ -28,6 +29,10 @@ public:
 	void setGeometry(QRect geometry);
 	[[nodiscard]] int height() const;
 
+	// Balance history drawn under the balance, updated on each change.
+	void setBalanceChart(
+		rpl::producer<not_null<const BalanceSeries*>> changes);
+
 	[[nodiscard]] rpl::producer<> sendRequests() const;
 	[[nodiscard]] rpl::producer<> receiveRequests() const;
 
@@ -36,8 +41,10 @@ public:
 private:
 	void setupControls();
 	void setupBalance();
+	void paintChart(QPainter &p) const;
 
 	Ui::RpWidget _widget;
+	std::vector<BalanceSeries::Point> _chart;
 
 	rpl::variable<CoverState> _state;
 	rpl::event_stream<> _sendRequests;
@@ -0,0 +1,64 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_decrypt_queue.h"
+
+#include "wallet/wallet_log.h"
+
+namespace Wallet {
+namespace {
+
+constexpr auto kChunkSize = 16;
+
+} // namespace
+
+DecryptQueue::DecryptQueue(Methods &&methods)
+: _methods(std::move(methods)) {
+	Expects(_methods.collect != nullptr);
+	Expects(_methods.decrypt != nullptr);
+	Expects(_methods.decrypted != nullptr);
+	Expects(_methods.failed != nullptr);
+}
+
+void DecryptQueue::start() {
+	// Try the ones that failed once more, but not the ones being sent.
+	_sent = _sending;
+	if (_sending.empty()) {
+		next();
+	}
+}
+
+void DecryptQueue::next() {
+	Expects(_sending.empty());
+
+	auto chunk = DecryptChunk{ kChunkSize, _sent };
+	_methods.collect(&chunk);
+	if (chunk.list.empty()) {
+		return;
+	}
+	for (const auto &transaction : chunk.list) {
+		_sending.emplace(transaction.id.lt);
+		_sent.emplace(transaction.id.lt);
+	}
+	_methods.decrypt(std::move(chunk.list), crl::guard(this, [=](
+			Result result) {
+		done(std::move(result));
+	}));
+}
+
+void DecryptQueue::done(Result result) {
+	_sending.clear();
+	if (!result) {
+		WALLET_LOG(("Decrypt: chunk failed, stopping."));
+		_sent.clear();
+		_methods.failed(result.error());
+		return;
+	}
+	_methods.decrypted(&result.value());
+	next();
+}
+
+} // namespace Wallet
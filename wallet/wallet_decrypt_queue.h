@@ -0,0 +1,53 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+#include "ton/ton_result.h"
+#include "base/weak_ptr.h"
+#include "base/flat_set.h"
+
+namespace Wallet {
+
+// Encrypted transactions to decrypt next, the most wanted ones first.
+struct DecryptChunk {
+	int limit = 0;
+	base::flat_set<int64> skip;
+	std::vector<Ton::Transaction> list;
+};
+
+// Decrypts the encrypted comments in small chunks, one chunk at a time.
+//
+// Each chunk is collected anew when the previous one is done, so the rows
+// closest to the visible ones and the transactions loaded meanwhile come
+// first. Transactions that could not be decrypted are skipped until the
+// queue is started again.
+class DecryptQueue final : public base::has_weak_ptr {
+public:
+	using Result = Ton::Result<std::vector<Ton::Transaction>>;
+	struct Methods {
+		Fn<void(not_null<DecryptChunk*>)> collect;
+		Fn<void(std::vector<Ton::Transaction>&&, Fn<void(Result)>)> decrypt;
+		Fn<void(not_null<const std::vector<Ton::Transaction>*>)> decrypted;
+		Fn<void(const Ton::Error&)> failed;
+	};
+
+	explicit DecryptQueue(Methods &&methods);
+
+	void start();
+
+private:
+	void next();
+	void done(Result result);
+
+	Methods _methods;
+	base::flat_set<int64> _sent;
+	base::flat_set<int64> _sending;
+
+};
+
+} // namespace Wallet
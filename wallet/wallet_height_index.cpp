@@ -0,0 +1,270 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_height_index.h"
+
+namespace Wallet {
+namespace {
+
+constexpr auto kMinimalSlack = 16;
+
+[[nodiscard]] int ComputeCapacity(int size) {
+	auto result = kMinimalSlack;
+	while (result < size) {
+		result *= 2;
+	}
+	return result;
+}
+
+// The allowed share of used slots goes from all of them in the smallest
+// windows to 3/4 in the whole array, so that a window spread again has
+// enough free slots left for the insertions that follow.
+[[nodiscard]] bool Fits(int used, int window, int level, int levels) {
+	return levels
+		? (int64(used) * 4 * levels <= int64(window) * (4 * levels - level))
+		: (used * 4 <= window * 3);
+}
+
+} // namespace
+
+int HeightIndex::size() const {
+	return _size;
+}
+
+bool HeightIndex::empty() const {
+	return !_size;
+}
+
+int HeightIndex::height(int index) const {
+	Expects(index >= 0 && index < _size);
+
+	return _heights[slot(index)];
+}
+
+int HeightIndex::top(int index) const {
+	Expects(index >= 0 && index <= _size);
+
+	return (index < _size) ? prefix(slot(index)) : _total;
+}
+
+int HeightIndex::bottom(int index) const {
+	Expects(index >= 0 && index < _size);
+
+	return prefix(slot(index) + 1);
+}
+
+int HeightIndex::total() const {
+	return _total;
+}
+
+int HeightIndex::findByY(int y) const {
+	if (!_size) {
+		return 0;
+	}
+	const auto capacity = int(_heights.size());
+	auto position = 0;
+	auto left = y;
+	for (auto step = capacity; step != 0; step /= 2) {
+		const auto next = position + step;
+		if (next <= capacity && _tree[next] <= left) {
+			position = next;
+			left -= _tree[next];
+		}
+	}
+
+	// The slot at 'position' is the first one with a non-zero height
+	// that ends below y, so it is a used one.
+	return (position < capacity) ? usedBefore(position) : _size;
+}
+
+void HeightIndex::set(int index, int height) {
+	Expects(index >= 0 && index < _size);
+
+	const auto at = slot(index);
+	const auto delta = height - _heights[at];
+	if (delta) {
+		_heights[at] = height;
+		add(at, delta, 0);
+	}
+}
+
+void HeightIndex::prepend(const std::vector<int> &heights) {
+	insert(0, heights);
+}
+
+void HeightIndex::append(const std::vector<int> &heights) {
+	insert(_size, heights);
+}
+
+void HeightIndex::insert(int index, const std::vector<int> &heights) {
+	Expects(index >= 0 && index <= _size);
+
+	const auto count = int(heights.size());
+	if (!count) {
+		return;
+	} else if (_heights.empty()) {
+		assign(heights);
+		return;
+	}
+	const auto capacity = int(_heights.size());
+	const auto from = index ? (slot(index - 1) + 1) : 0;
+	const auto till = (index < _size) ? slot(index) : capacity;
+	if (till - from >= count) {
+		// Leave the free slots on both sides for the next insertions.
+		const auto first = from + (till - from - count) / 2;
+		for (auto i = 0; i != count; ++i) {
+			place(first + i, heights[i]);
+		}
+		_size += count;
+		return;
+	}
+	const auto position = std::min(from, capacity - 1);
+	auto levels = 0;
+	while ((kMinimalSlack << levels) < capacity) {
+		++levels;
+	}
+	for (auto level = 0; level <= levels; ++level) {
+		const auto window = (kMinimalSlack << level);
+		const auto windowFrom = (position / window) * window;
+		const auto windowTill = windowFrom + window;
+		const auto before = usedBefore(windowFrom);
+		const auto inside = usedBefore(windowTill) - before;
+		if (!Fits(inside + count, window, level, levels)) {
+			continue;
+		}
+		auto all = collect(windowFrom, windowTill);
+		all.insert(
+			begin(all) + (index - before),
+			begin(heights),
+			end(heights));
+		spread(windowFrom, windowTill, std::move(all));
+		_size += count;
+		return;
+	}
+	auto all = collect(0, capacity);
+	all.insert(begin(all) + index, begin(heights), end(heights));
+	assign(all);
+}
+
+void HeightIndex::assign(const std::vector<int> &heights) {
+	const auto size = int(heights.size());
+	rebuild(
+		ComputeCapacity(2 * size + kMinimalSlack),
+		std::vector<int>(heights));
+}
+
+void HeightIndex::clear() {
+	_heights.clear();
+	_used.clear();
+	_tree.clear();
+	_usedTree.clear();
+	_size = _total = 0;
+}
+
+int HeightIndex::slot(int index) const {
+	Expects(index >= 0 && index < _size);
+
+	const auto capacity = int(_heights.size());
+	auto position = 0;
+	auto left = index;
+	for (auto step = capacity; step != 0; step /= 2) {
+		const auto next = position + step;
+		if (next <= capacity && _usedTree[next] <= left) {
+			position = next;
+			left -= _usedTree[next];
+		}
+	}
+	return position;
+}
+
+int HeightIndex::prefix(int slots) const {
+	auto result = 0;
+	for (auto i = slots; i > 0; i -= (i & -i)) {
+		result += _tree[i];
+	}
+	return result;
+}
+
+int HeightIndex::usedBefore(int slots) const {
+	auto result = 0;
+	for (auto i = slots; i > 0; i -= (i & -i)) {
+		result += _usedTree[i];
+	}
+	return result;
+}
+
+std::vector<int> HeightIndex::collect(int from, int till) const {
+	auto result = std::vector<int>();
+	result.reserve(usedBefore(till) - usedBefore(from));
+	for (auto i = from; i != till; ++i) {
+		if (_used[i]) {
+			result.push_back(_heights[i]);
+		}
+	}
+	return result;
+}
+
+void HeightIndex::add(int slot, int delta, int used) {
+	const auto capacity = int(_heights.size());
+	for (auto i = slot + 1; i <= capacity; i += (i & -i)) {
+		_tree[i] += delta;
+		_usedTree[i] += used;
+	}
+	_total += delta;
+}
+
+void HeightIndex::place(int slot, int height) {
+	Expects(!_used[slot]);
+
+	_heights[slot] = height;
+	_used[slot] = 1;
+	add(slot, height, 1);
+}
+
+void HeightIndex::spread(int from, int till, std::vector<int> &&heights) {
+	const auto window = till - from;
+	const auto count = int(heights.size());
+	Expects(count <= window);
+
+	for (auto i = from; i != till; ++i) {
+		if (_used[i]) {
+			add(i, -_heights[i], -1);
+			_heights[i] = 0;
+			_used[i] = 0;
+		}
+	}
+	for (auto i = 0; i != count; ++i) {
+		place(from + int(int64(i) * window / count), heights[i]);
+	}
+}
+
+void HeightIndex::rebuild(int capacity, std::vector<int> &&heights) {
+	_size = int(heights.size());
+	Expects(_size <= capacity);
+
+	_total = 0;
+	_heights.assign(capacity, 0);
+	_used.assign(capacity, 0);
+	_tree.assign(capacity + 1, 0);
+	_usedTree.assign(capacity + 1, 0);
+	for (auto i = 0; i != _size; ++i) {
+		const auto at = int(int64(i) * capacity / _size);
+		_heights[at] = heights[i];
+		_used[at] = 1;
+		_total += heights[i];
+	}
+	for (auto i = 1; i <= capacity; ++i) {
+		_tree[i] += _heights[i - 1];
+		_usedTree[i] += _used[i - 1];
+		const auto parent = i + (i & -i);
+		if (parent <= capacity) {
+			_tree[parent] += _tree[i];
+			_usedTree[parent] += _usedTree[i];
+		}
+	}
+}
+
+} // namespace Wallet
@@ -0,0 +1,58 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+namespace Wallet {
+
+// Heights of a list of rows with O(log n) updates and position lookups.
+//
+// The rows are kept in a slot array with free slots spread between them,
+// with one Fenwick tree for the heights and one for the used slots.
+// Inserting k rows anywhere fills the free slots at that place and only
+// when there are not enough of them the rows of the smallest surrounding
+// window that is sparse enough are spread again, so that the insertion
+// costs O(k log n) plus amortized O(log^2 n) moved rows.
+class HeightIndex final {
+public:
+	[[nodiscard]] int size() const;
+	[[nodiscard]] bool empty() const;
+
+	[[nodiscard]] int height(int index) const;
+	[[nodiscard]] int top(int index) const;
+	[[nodiscard]] int bottom(int index) const;
+	[[nodiscard]] int total() const;
+
+	// Index of the first row with bottom() > y, size() if there is none.
+	[[nodiscard]] int findByY(int y) const;
+
+	void set(int index, int height);
+	void prepend(const std::vector<int> &heights);
+	void append(const std::vector<int> &heights);
+	void insert(int index, const std::vector<int> &heights);
+	void assign(const std::vector<int> &heights);
+	void clear();
+
+private:
+	[[nodiscard]] int slot(int index) const;
+	[[nodiscard]] int prefix(int slots) const;
+	[[nodiscard]] int usedBefore(int slots) const;
+	[[nodiscard]] std::vector<int> collect(int from, int till) const;
+	void add(int slot, int delta, int used);
+	void place(int slot, int height);
+	void spread(int from, int till, std::vector<int> &&heights);
+	void rebuild(int capacity, std::vector<int> &&heights);
+
+	std::vector<int> _heights;
+	std::vector<char> _used;
+	std::vector<int> _tree;
+	std::vector<int> _usedTree;
+	int _size = 0;
+	int _total = 0;
+
+};
+
+} // namespace Wallet
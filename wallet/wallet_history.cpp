@@ -7,25 +7,36 @@
 #include "wallet/wallet_history.h"
 
 #include "wallet/wallet_common.h"
+#include "wallet/wallet_decrypt_queue.h"
+#include "wallet/wallet_log.h"
 #include "wallet/wallet_phrases.h"
+#include "wallet/wallet_trace.h"
 #include "base/unixtime.h"
 #include "base/flags.h"
+#include "base/flat_map.h"
 #include "ui/address_label.h"
 #include "ui/inline_diamond.h"
 #include "ui/painter.h"
 #include "ui/text/text.h"
 #include "ui/text/text_utilities.h"
 #include "ui/effects/animations.h"
+#include "ui/ui_utility.h"
 #include "styles/style_wallet.h"
 #include "styles/palette.h"
 
 #include <QtCore/QDateTime>
+#include <crl/crl_async.h>
+#include <list>
 
 namespace Wallet {
 namespace {
 
-constexpr auto kPreloadScreens = 3;
+constexpr auto kLayoutScreens = 1;
+constexpr auto kLayoutDropScreens = 4;
 constexpr auto kCommentLinesMax = 3;
+constexpr auto kCommentHeightsLimit = 8;
+constexpr auto kPrepareChunk = 64;
+constexpr auto kLogMemoryEach = 1000;
 
 enum class Flag : uchar {
 	Incoming = 0x01,
@@ -39,8 +50,7 @@ using Flags = base::flags<Flag>;
 
 struct TransactionLayout {
 	TimeId serverTime = 0;
-	QDateTime dateTime;
-	Ui::Text::String date;
+	int timeKey = -1;
 	Ui::Text::String time;
 	Ui::Text::String amountGrams;
 	Ui::Text::String amountNano;
@@ -52,82 +62,195 @@ struct TransactionLayout {
 	Flags flags = Flags();
 };
 
+struct PreparedLayout {
+	Ton::TransactionId id;
+	TimeId serverTime = 0;
+	Flags flags = Flags();
+	FormattedAmount amount;
+	QString address;
+	int addressWidth = 0;
+	QString comment;
+	QString fees;
+};
+
+struct LayoutContext {
+	QFont addressFont;
+	int addressSpaceWidth = 0;
+	QString feesPhrase;
+};
+
+struct MonthHeader {
+	QString title;
+	QString summary;
+	bool collapsed = false;
+};
+
+struct MonthLayout {
+	Ui::Text::String title;
+	Ui::Text::String summary;
+	bool collapsed = false;
+};
+
+[[nodiscard]] std::pair<int, int> FindRows(
+		const HeightIndex &heights,
+		int top,
+		int bottom) {
+	const auto from = heights.findByY(top);
+	const auto till = (bottom > 0)
+		? std::min(heights.findByY(bottom - 1) + 1, heights.size())
+		: 0;
+	return { from, std::max(from, till) };
+}
+
+[[nodiscard]] int MonthKey(QDate date) {
+	return date.year() * 12 + date.month() - 1;
+}
+
 [[nodiscard]] const style::TextStyle &AddressStyle() {
 	const static auto result = Ui::ComputeAddressStyle(st::defaultTextStyle);
 	return result;
 }
 
-void RefreshTimeTexts(
-		TransactionLayout &layout,
-		bool forceDateText = false) {
-	layout.dateTime = base::unixtime::parse(layout.serverTime);
-	layout.time.setText(
-		st::defaultTextStyle,
-		ph::lng_wallet_short_time(layout.dateTime.time())(ph::now));
-	if (layout.date.isEmpty() && !forceDateText) {
-		return;
+[[nodiscard]] int MinuteOfDay(QTime time) {
+	return time.hour() * 60 + time.minute();
+}
+
+// Rows of the same minute or the same day share the formatted strings,
+// until the phrases of another language are set.
+template <typename Key>
+[[nodiscard]] base::flat_map<Key, QString> &PhrasesCache(
+		base::flat_map<Key, QString> &cache,
+		int &generation) {
+	if (generation != PhrasesGeneration()) {
+		generation = PhrasesGeneration();
+		cache.clear();
 	}
-	if (layout.flags & Flag::Pending) {
-		layout.date.setText(
-			st::semiboldTextStyle,
-			ph::lng_wallet_row_pending_date(ph::now));
-	} else {
-		layout.date.setText(
-			st::semiboldTextStyle,
-			ph::lng_wallet_short_date(layout.dateTime.date())(ph::now));
+	return cache;
+}
+
+[[nodiscard]] QString ShortTimeText(QTime time) {
+	static auto map = base::flat_map<int, QString>();
+	static auto generation = PhrasesGeneration();
+	auto &cache = PhrasesCache(map, generation);
+	const auto key = MinuteOfDay(time);
+	auto i = cache.find(key);
+	if (i == end(cache)) {
+		const auto minute = QTime(time.hour(), time.minute());
+		i = cache.emplace(
+			key,
+			ph::lng_wallet_short_time(minute)(ph::now)).first;
 	}
+	return i->second;
 }
 
-[[nodiscard]] TransactionLayout PrepareLayout(
+[[nodiscard]] QString ShortDateText(QDate date) {
+	static auto map = base::flat_map<qint64, QString>();
+	static auto generation = PhrasesGeneration();
+	auto &cache = PhrasesCache(map, generation);
+	const auto key = date.toJulianDay();
+	auto i = cache.find(key);
+	if (i == end(cache)) {
+		i = cache.emplace(key, ph::lng_wallet_short_date(date)(ph::now)).first;
+	}
+	return i->second;
+}
+
+bool RefreshTimeText(TransactionLayout &layout) {
+	const auto time = base::unixtime::parse(layout.serverTime).time();
+	const auto key = MinuteOfDay(time);
+	if (layout.timeKey == key) {
+		return false;
+	}
+	layout.timeKey = key;
+	layout.time.setText(st::defaultTextStyle, ShortTimeText(time));
+	return true;
+}
+
+[[nodiscard]] Flags ComputeFlags(
 		const Ton::Transaction &data,
-		Fn<void()> decrypt,
+		bool canDecrypt,
 		bool isInitTransaction) {
 	const auto service = IsServiceTransaction(data);
-	const auto encrypted = IsEncryptedMessage(data) && decrypt;
-	const auto amount = FormatAmount(
-		service ? (-data.fee) : CalculateValue(data),
-		FormatFlag::Signed | FormatFlag::Rounded);
+	const auto encrypted = IsEncryptedMessage(data) && canDecrypt;
 	const auto incoming = !data.incoming.source.isEmpty();
 	const auto pending = (data.id.lt == 0);
+	return Flag(0)
+		| (service ? Flag::Service : Flag(0))
+		| (isInitTransaction ? Flag::Initialization : Flag(0))
+		| (encrypted ? Flag::Encrypted : Flag(0))
+		| (incoming ? Flag::Incoming : Flag(0))
+		| (pending ? Flag::Pending : Flag(0));
+}
+
+[[nodiscard]] LayoutContext PrepareLayoutContext() {
+	return LayoutContext{
+		AddressStyle().font->f,
+		AddressStyle().font->spacew,
+		ph::lng_wallet_row_fees(ph::now),
+	};
+}
+
+// Everything except the text shaping, so it can be done off main thread.
+[[nodiscard]] PreparedLayout PrepareLayoutData(
+		const Ton::Transaction &data,
+		bool canDecrypt,
+		bool isInitTransaction,
+		const LayoutContext &context) {
+	const auto flags = ComputeFlags(data, canDecrypt, isInitTransaction);
+	const auto service = (flags & Flag::Service);
+	const auto encrypted = (flags & Flag::Encrypted);
 	const auto address = ExtractAddress(data);
+	const auto metrics = QFontMetrics(context.addressFont);
 	const auto addressPartWidth = [&](int from, int length = -1) {
-		return AddressStyle().font->width(address.mid(from, length));
+		return metrics.horizontalAdvance(address.mid(from, length));
 	};
 
-	auto result = TransactionLayout();
+	auto result = PreparedLayout();
+	result.id = data.id;
 	result.serverTime = data.time;
-	result.amountGrams.setText(st::walletRowGramsStyle, amount.gramsString);
+	result.flags = flags;
+	result.amount = FormatAmount(
+		service ? (-data.fee) : CalculateValue(data),
+		FormatFlag::Signed | FormatFlag::Rounded);
+	result.address = service ? QString() : address;
+	result.addressWidth = (context.addressSpaceWidth / 2) + std::max(
+		addressPartWidth(0, address.size() / 2),
+		addressPartWidth(address.size() / 2));
+	result.comment = encrypted ? QString() : ExtractMessage(data);
+	if (data.fee) {
+		const auto fee = FormatAmount(data.fee).full;
+		result.fees = QString(context.feesPhrase).replace("{amount}", fee);
+	}
+	return result;
+}
+
+[[nodiscard]] TransactionLayout FinishLayout(const PreparedLayout &data) {
+	auto result = TransactionLayout();
+	result.serverTime = data.serverTime;
+	result.amountGrams.setText(
+		st::walletRowGramsStyle,
+		data.amount.gramsString);
 	result.amountNano.setText(
 		st::walletRowNanoStyle,
-		amount.separator + amount.nanoString);
+		data.amount.separator + data.amount.nanoString);
 	result.address = Ui::Text::String(
 		AddressStyle(),
-		service ? QString() : address,
+		data.address,
 		_defaultOptions,
 		st::walletAddressWidthMin);
-	result.addressWidth = (AddressStyle().font->spacew / 2) + std::max(
-		addressPartWidth(0, address.size() / 2),
-		addressPartWidth(address.size() / 2));
+	result.addressWidth = data.addressWidth;
 	result.addressHeight = AddressStyle().font->height * 2;
 	result.comment = Ui::Text::String(st::walletAddressWidthMin);
 	result.comment.setText(
 		st::defaultTextStyle,
-		(encrypted ? QString() : ExtractMessage(data)),
+		data.comment,
 		_textPlainOptions);
-	if (data.fee) {
-		const auto fee = FormatAmount(data.fee).full;
-		result.fees.setText(
-			st::defaultTextStyle,
-			ph::lng_wallet_row_fees(ph::now).replace("{amount}", fee));
+	if (!data.fees.isEmpty()) {
+		result.fees.setText(st::defaultTextStyle, data.fees);
 	}
-	result.flags = Flag(0)
-		| (service ? Flag::Service : Flag(0))
-		| (isInitTransaction ? Flag::Initialization : Flag(0))
-		| (encrypted ? Flag::Encrypted : Flag(0))
-		| (incoming ? Flag::Incoming : Flag(0))
-		| (pending ? Flag::Pending : Flag(0));
+	result.flags = data.flags;
 
-	RefreshTimeTexts(result);
+	RefreshTimeText(result);
 	return result;
 }
 
@@ -144,36 +267,69 @@ public:
 
 	[[nodiscard]] Ton::TransactionId id() const;
 
-	void refreshDate();
-	[[nodiscard]] QDateTime date() const;
+	[[nodiscard]] bool hasLayout() const;
+	[[nodiscard]] bool hasPrepared() const;
+	void setPrepared(PreparedLayout &&prepared);
+	void prepareLayout(const Ton::Transaction &transaction);
+	void clearLayout();
+	void clearPrepared();
+
+	// Returns true if the shown time or day of the transaction has changed.
+	bool refreshDate(int generation);
+	[[nodiscard]] QDate date() const;
 	void setShowDate(bool show, Fn<void()> repaintDate);
 	void setDecryptionFailed();
 	bool showDate() const;
 
-	[[nodiscard]] int top() const;
-	void setTop(int top);
+	// The first row of a month shows its header above the date,
+	// in a collapsed month the header is all that it shows.
+	void setMonth(const MonthHeader *header);
+	[[nodiscard]] bool showMonth() const;
+	[[nodiscard]] bool collapsed() const;
+	[[nodiscard]] int monthSkip() const;
+	[[nodiscard]] bool isMonthUnderCursor(QPoint point) const;
 
 	void resizeToWidth(int width);
 	[[nodiscard]] int height() const;
-	[[nodiscard]] int bottom() const;
 
 	void paint(Painter &p, int x, int y);
-	void paintDate(Painter &p, int x, int y);
+	void paintDate(Painter &p, int x, int y, int top);
+	[[nodiscard]] int dateTop() const;
 	[[nodiscard]] bool isUnderCursor(QPoint point) const;
 	[[nodiscard]] ClickHandlerPtr handlerUnderCursor(QPoint point) const;
 
 private:
 	[[nodiscard]] QRect computeInnerRect() const;
+	[[nodiscard]] int countContentHeight(int avail);
+	void paintPlaceholder(Painter &p, int x, int y, int avail);
+	void paintMonth(Painter &p, int x, int y, int avail);
+	[[nodiscard]] std::optional<int> lookupCommentHeight(int key) const;
+	[[nodiscard]] int countCommentHeight(int avail);
+	void refreshDateText();
 
 	Ton::TransactionId _id;
-	TransactionLayout _layout;
-	int _top = 0;
+	TimeId _serverTime = 0;
+	QDate _date;
+	Flags _flags = Flags();
+	Fn<void()> _decrypt;
+	std::unique_ptr<PreparedLayout> _prepared;
+	std::unique_ptr<TransactionLayout> _layout;
+	std::unique_ptr<MonthLayout> _month;
+	Ui::Text::String _dateText;
+	int _dateTop = 0;
+	int _dateGeneration = 0;
 	int _width = 0;
 	int _height = 0;
 	int _commentHeight = 0;
+	int _commentWidthMax = 0;
+	base::flat_map<int, int> _commentHeights;
 
 	Ui::Animations::Simple _dateShadowShown;
 	Fn<void()> _repaintDate;
+	bool _hasComment = false;
+	bool _hasFees = false;
+	bool _showDate = false;
+	bool _contentEstimated = false;
 	bool _dateHasShadow = false;
 	bool _decryptionFailed = false;
 
@@ -184,50 +340,167 @@ HistoryRow::HistoryRow(
 	Fn<void()> decrypt,
 	bool isInitTransaction)
 : _id(transaction.id)
-, _layout(PrepareLayout(transaction, decrypt, isInitTransaction)) {
+, _serverTime(transaction.time)
+, _date(base::unixtime::parse(_serverTime).date())
+, _flags(ComputeFlags(transaction, (decrypt != nullptr), isInitTransaction))
+, _decrypt(std::move(decrypt))
+, _hasComment(!(_flags & Flag::Encrypted)
+	&& !ExtractMessage(transaction).isEmpty())
+, _hasFees(transaction.fee != 0) {
 }
 
 Ton::TransactionId HistoryRow::id() const {
 	return _id;
 }
 
-void HistoryRow::refreshDate() {
-	RefreshTimeTexts(_layout);
+bool HistoryRow::hasLayout() const {
+	return (_layout != nullptr);
+}
+
+bool HistoryRow::hasPrepared() const {
+	return (_prepared != nullptr);
+}
+
+void HistoryRow::setPrepared(PreparedLayout &&prepared) {
+	if (prepared.id != _id || prepared.flags != _flags) {
+		return;
+	}
+	_prepared = std::make_unique<PreparedLayout>(std::move(prepared));
+}
+
+void HistoryRow::prepareLayout(const Ton::Transaction &transaction) {
+	Expects(transaction.id == _id);
+
+	if (!_prepared) {
+		setPrepared(PrepareLayoutData(
+			transaction,
+			(_decrypt != nullptr),
+			(_flags & Flag::Initialization),
+			PrepareLayoutContext()));
+	}
+	_layout = std::make_unique<TransactionLayout>(FinishLayout(*_prepared));
+	if (_decryptionFailed) {
+		_layout->comment.setText(
+			st::defaultTextStyle,
+			ph::lng_wallet_decrypt_failed(ph::now),
+			_textPlainOptions);
+	}
+	_commentWidthMax = _layout->comment.maxWidth();
+	if (_contentEstimated) {
+		_width = 0;
+	}
+}
+
+void HistoryRow::clearLayout() {
+	_layout = nullptr;
+}
+
+void HistoryRow::clearPrepared() {
+	_prepared = nullptr;
+}
+
+bool HistoryRow::refreshDate(int generation) {
+	if (_dateGeneration == generation) {
+		return false;
+	}
+	_dateGeneration = generation;
+	const auto timeChanged = _layout && RefreshTimeText(*_layout);
+	const auto date = base::unixtime::parse(_serverTime).date();
+	if (_date == date) {
+		return timeChanged;
+	}
+	_date = date;
+	if (_showDate) {
+		refreshDateText();
+	}
+	return true;
+}
+
+void HistoryRow::refreshDateText() {
+	if (_flags & Flag::Pending) {
+		_dateText.setText(
+			st::semiboldTextStyle,
+			ph::lng_wallet_row_pending_date(ph::now));
+	} else {
+		_dateText.setText(st::semiboldTextStyle, ShortDateText(_date));
+	}
 }
 
-QDateTime HistoryRow::date() const {
-	return _layout.dateTime;
+QDate HistoryRow::date() const {
+	return _date;
 }
 
 void HistoryRow::setShowDate(bool show, Fn<void()> repaintDate) {
-	_width = 0;
+	if (_showDate != show) {
+		_width = 0;
+		_showDate = show;
+	}
 	if (!show) {
-		_layout.date.clear();
+		_dateText.clear();
 	} else {
 		_repaintDate = std::move(repaintDate);
-		RefreshTimeTexts(_layout, true);
+		if (_dateText.isEmpty()) {
+			refreshDateText();
+		}
 	}
 }
 
 void HistoryRow::setDecryptionFailed() {
 	_width = 0;
 	_decryptionFailed = true;
-	_layout.comment.setText(
-		st::defaultTextStyle,
-		ph::lng_wallet_decrypt_failed(ph::now),
-		_textPlainOptions);
+	_hasComment = true;
+	_commentHeights.clear();
+	if (_layout) {
+		_layout->comment.setText(
+			st::defaultTextStyle,
+			ph::lng_wallet_decrypt_failed(ph::now),
+			_textPlainOptions);
+		_commentWidthMax = _layout->comment.maxWidth();
+	}
 }
 
 bool HistoryRow::showDate() const {
-	return !_layout.date.isEmpty();
+	return _showDate;
+}
+
+void HistoryRow::setMonth(const MonthHeader *header) {
+	if (!header) {
+		if (_month) {
+			_month = nullptr;
+			_width = 0;
+		}
+		return;
+	}
+	if (!_month) {
+		_month = std::make_unique<MonthLayout>();
+		_width = 0;
+	}
+	if (_month->collapsed != header->collapsed) {
+		_month->collapsed = header->collapsed;
+		_width = 0;
+	}
+	_month->title.setText(st::semiboldTextStyle, header->title);
+	_month->summary.setText(st::defaultTextStyle, header->summary);
 }
 
-int HistoryRow::top() const {
-	return _top;
+bool HistoryRow::showMonth() const {
+	return (_month != nullptr);
 }
 
-void HistoryRow::setTop(int top) {
-	_top = top;
+bool HistoryRow::collapsed() const {
+	return _month && _month->collapsed;
+}
+
+int HistoryRow::monthSkip() const {
+	return _month ? st::walletRowMonthHeight : 0;
+}
+
+bool HistoryRow::isMonthUnderCursor(QPoint point) const {
+	return _month
+		&& point.x() >= 0
+		&& point.x() < _width
+		&& point.y() >= 0
+		&& point.y() < st::walletRowMonthHeight;
 }
 
 void HistoryRow::resizeToWidth(int width) {
@@ -235,35 +508,92 @@ void HistoryRow::resizeToWidth(int width) {
 		return;
 	}
 	_width = width;
+
 	const auto padding = st::walletRowPadding;
 	const auto use = std::min(_width, st::walletRowWidthMax);
 	const auto avail = use - padding.left() - padding.right();
-	_height = 0;
-	if (!_layout.date.isEmpty()) {
+	_height = monthSkip();
+	if (collapsed()) {
+		return;
+	}
+	_height += countContentHeight(avail);
+	if (_showDate) {
 		_height += st::walletRowDateSkip;
 	}
-	_height += padding.top() + _layout.amountGrams.minHeight();
-	if (!_layout.address.isEmpty()) {
-		_height += st::walletRowAddressTop + _layout.addressHeight;
+}
+
+int HistoryRow::countContentHeight(int avail) {
+	// Without a layout we estimate the height from the transaction kind,
+	// it is recounted exactly as soon as the row gets its layout.
+	const auto padding = st::walletRowPadding;
+	const auto &font = st::defaultTextStyle.font;
+	_contentEstimated = false;
+	auto result = padding.top() + st::walletRowGramsStyle.font->height;
+	if (!(_flags & Flag::Service)) {
+		result += st::walletRowAddressTop + AddressStyle().font->height * 2;
 	}
-	if (!_layout.comment.isEmpty()) {
-		_commentHeight = std::min(
-			_layout.comment.countHeight(avail),
-			st::defaultTextStyle.font->height * kCommentLinesMax);
-		_height += st::walletRowCommentTop + _commentHeight;
+	if (_layout && !_layout->comment.isEmpty()) {
+		_commentHeight = countCommentHeight(avail);
+		result += st::walletRowCommentTop + _commentHeight;
+	} else if (!_layout && _hasComment) {
+		const auto known = _commentWidthMax
+			? lookupCommentHeight(std::min(avail, _commentWidthMax))
+			: std::nullopt;
+		_contentEstimated = !known;
+		_commentHeight = known.value_or(font->height);
+		result += st::walletRowCommentTop + _commentHeight;
+	} else if (!_layout) {
+		_contentEstimated = true;
 	}
-	if (!_layout.fees.isEmpty()) {
-		_height += st::walletRowFeesTop + _layout.fees.minHeight();
+	if (_hasFees) {
+		result += st::walletRowFeesTop + font->height;
 	}
-	_height += padding.bottom();
+	return result + padding.bottom();
 }
 
-int HistoryRow::height() const {
-	return _height;
+std::optional<int> HistoryRow::lookupCommentHeight(int key) const {
+	const auto after = _commentHeights.lower_bound(key);
+	if (after == end(_commentHeights)) {
+		return std::nullopt;
+	} else if (after->first == key) {
+		return after->second;
+	} else if (after == begin(_commentHeights)) {
+		return std::nullopt;
+	}
+
+	// Wrapped text height never grows with the width, so if both known
+	// neighbours have the same height, it is the height for the key too.
+	const auto before = after - 1;
+	if (before->second == after->second) {
+		return after->second;
+	}
+	return std::nullopt;
 }
 
-int HistoryRow::bottom() const {
-	return _top + _height;
+int HistoryRow::countCommentHeight(int avail) {
+	Expects(_layout != nullptr);
+
+	// Any width not less than maxWidth() lays the comment out the same,
+	// and avail itself stops growing at st::walletRowWidthMax.
+	const auto key = std::min(avail, _commentWidthMax);
+	if (const auto known = lookupCommentHeight(key)) {
+		return *known;
+	}
+	const auto result = std::min(
+		_layout->comment.countHeight(key),
+		st::defaultTextStyle.font->height * kCommentLinesMax);
+	if (_commentHeights.size() >= kCommentHeightsLimit) {
+		const auto front = begin(_commentHeights);
+		const auto back = end(_commentHeights) - 1;
+		_commentHeights.erase(
+			(key - front->first > back->first - key) ? front : back);
+	}
+	_commentHeights.emplace(key, result);
+	return result;
+}
+
+int HistoryRow::height() const {
+	return _height;
 }
 
 void HistoryRow::paint(Painter &p, int x, int y) {
@@ -272,7 +602,14 @@ void HistoryRow::paint(Painter &p, int x, int y) {
 	const auto avail = use - padding.left() - padding.right();
 	x += (_width - use) / 2 + padding.left();
 
-	if (!_layout.date.isEmpty()) {
+	if (_month) {
+		paintMonth(p, x, y, avail);
+		if (_month->collapsed) {
+			return;
+		}
+		y += st::walletRowMonthHeight;
+	}
+	if (_showDate) {
 		y += st::walletRowDateSkip;
 	} else {
 		const auto shadowLeft = (use < _width)
@@ -283,9 +620,14 @@ void HistoryRow::paint(Painter &p, int x, int y) {
 			: _width - padding.left();
 		p.fillRect(shadowLeft, y, shadowWidth, st::lineWidth, st::shadowFg);
 	}
+	if (!_layout) {
+		paintPlaceholder(p, x, y + padding.top(), avail);
+		return;
+	}
+	const auto &layout = *_layout;
 	y += padding.top();
 
-	if (_layout.flags & Flag::Service) {
+	if (layout.flags & Flag::Service) {
 		const auto labelLeft = x;
 		const auto labelTop = y
 			+ st::walletRowGramsStyle.font->ascent
@@ -295,25 +637,25 @@ void HistoryRow::paint(Painter &p, int x, int y) {
 		p.drawText(
 			labelLeft,
 			labelTop + st::normalFont->ascent,
-			((_layout.flags & Flag::Initialization)
+			((layout.flags & Flag::Initialization)
 				? ph::lng_wallet_row_init(ph::now)
 				: ph::lng_wallet_row_service(ph::now)));
 	} else {
-		const auto incoming = (_layout.flags & Flag::Incoming);
+		const auto incoming = (layout.flags & Flag::Incoming);
 		p.setPen(incoming ? st::boxTextFgGood : st::boxTextFgError);
-		_layout.amountGrams.draw(p, x, y, avail);
+		layout.amountGrams.draw(p, x, y, avail);
 
 		const auto nanoTop = y
 			+ st::walletRowGramsStyle.font->ascent
 			- st::walletRowNanoStyle.font->ascent;
-		const auto nanoLeft = x + _layout.amountGrams.maxWidth();
-		_layout.amountNano.draw(p, nanoLeft, nanoTop, avail);
+		const auto nanoLeft = x + layout.amountGrams.maxWidth();
+		layout.amountNano.draw(p, nanoLeft, nanoTop, avail);
 
 		const auto diamondTop = y
 			+ st::walletRowGramsStyle.font->ascent
 			- st::normalFont->ascent;
 		const auto diamondLeft = nanoLeft
-			+ _layout.amountNano.maxWidth()
+			+ layout.amountNano.maxWidth()
 			+ st::normalFont->spacew;
 		Ui::PaintInlineDiamond(p, diamondLeft, diamondTop, st::normalFont);
 
@@ -331,10 +673,10 @@ void HistoryRow::paint(Painter &p, int x, int y) {
 				: ph::lng_wallet_row_to(ph::now)));
 
 		const auto timeTop = labelTop;
-		const auto timeLeft = x + avail - _layout.time.maxWidth();
+		const auto timeLeft = x + avail - layout.time.maxWidth();
 		p.setPen(st::windowSubTextFg);
-		_layout.time.draw(p, timeLeft, timeTop, avail);
-		if (_layout.flags & Flag::Encrypted) {
+		layout.time.draw(p, timeLeft, timeTop, avail);
+		if (layout.flags & Flag::Encrypted) {
 			const auto iconLeft = x
 				+ avail
 				- st::walletCommentIconLeft
@@ -342,7 +684,7 @@ void HistoryRow::paint(Painter &p, int x, int y) {
 			const auto iconTop = labelTop + st::walletCommentIconTop;
 			st::walletCommentIcon.paint(p, iconLeft, iconTop, avail);
 		}
-		if (_layout.flags & Flag::Pending) {
+		if (layout.flags & Flag::Pending) {
 			st::walletRowPending.paint(
 				p,
 				(timeLeft
@@ -352,44 +694,94 @@ void HistoryRow::paint(Painter &p, int x, int y) {
 				avail);
 		}
 	}
-	y += _layout.amountGrams.minHeight();
+	y += layout.amountGrams.minHeight();
 
-	if (!_layout.address.isEmpty()) {
+	if (!layout.address.isEmpty()) {
 		p.setPen(st::windowFg);
 		y += st::walletRowAddressTop;
-		_layout.address.drawElided(
+		layout.address.drawElided(
 			p,
 			x,
 			y,
-			_layout.addressWidth,
+			layout.addressWidth,
 			2,
 			style::al_topleft,
 			0,
 			-1,
 			0,
 			true);
-		y += _layout.addressHeight;
+		y += layout.addressHeight;
 	}
-	if (!_layout.comment.isEmpty()) {
+	if (!layout.comment.isEmpty()) {
 		y += st::walletRowCommentTop;
 		if (_decryptionFailed) {
 			p.setPen(st::boxTextFgError);
 		}
-		_layout.comment.drawElided(p, x, y, avail, kCommentLinesMax);
+		layout.comment.drawElided(p, x, y, avail, kCommentLinesMax);
 		y += _commentHeight;
 	}
-	if (!_layout.fees.isEmpty()) {
+	if (!layout.fees.isEmpty()) {
 		p.setPen(st::windowSubTextFg);
 		y += st::walletRowFeesTop;
-		_layout.fees.draw(p, x, y, avail);
+		layout.fees.draw(p, x, y, avail);
 	}
 }
 
-void HistoryRow::paintDate(Painter &p, int x, int y) {
-	Expects(!_layout.date.isEmpty());
+void HistoryRow::paintPlaceholder(Painter &p, int x, int y, int avail) {
+	// Stands in for the row while its layout is prepared in background.
+	const auto line = [&](int height, int width) {
+		p.fillRect(x, y + height / 4, width, height / 2, st::windowBgOver);
+		y += height;
+	};
+	line(st::walletRowGramsStyle.font->height, avail / 3);
+	if (!(_flags & Flag::Service)) {
+		const auto height = AddressStyle().font->height;
+		y += st::walletRowAddressTop;
+		line(height, avail / 2);
+		line(height, avail / 2);
+	}
+	if (_hasComment) {
+		y += st::walletRowCommentTop;
+		line(_commentHeight, (avail * 3) / 4);
+	}
+	if (_hasFees) {
+		y += st::walletRowFeesTop;
+		line(st::defaultTextStyle.font->height, avail / 3);
+	}
+}
+
+void HistoryRow::paintMonth(Painter &p, int x, int y, int avail) {
+	const auto toggle = _month->collapsed
+		? ph::lng_wallet_row_month_show(ph::now)
+		: ph::lng_wallet_row_month_hide(ph::now);
+	const auto toggleWidth = st::normalFont->width(toggle);
+	const auto titleTop = y + st::walletRowMonthTitleTop;
+	p.setPen(st::windowFg);
+	_month->title.drawElided(
+		p,
+		x,
+		titleTop,
+		avail - toggleWidth - st::normalFont->spacew);
+	p.setFont(st::normalFont);
+	p.setPen(st::windowActiveTextFg);
+	p.drawText(
+		x + avail - toggleWidth,
+		titleTop + st::normalFont->ascent,
+		toggle);
+	p.setPen(st::windowSubTextFg);
+	_month->summary.drawElided(
+		p,
+		x,
+		y + st::walletRowMonthSummaryTop,
+		avail);
+}
+
+void HistoryRow::paintDate(Painter &p, int x, int y, int top) {
+	Expects(_showDate);
 	Expects(_repaintDate != nullptr);
 
-	const auto hasShadow = (y != top());
+	_dateTop = y;
+	const auto hasShadow = (y != top);
 	if (_dateHasShadow != hasShadow) {
 		_dateHasShadow = hasShadow;
 		_dateShadowShown.start(
@@ -417,10 +809,17 @@ void HistoryRow::paintDate(Painter &p, int x, int y) {
 	x += padding.left();
 	p.setOpacity(1.);
 	p.setPen(st::windowFg);
-	_layout.date.draw(p, x, y + st::walletRowDateTop, avail);
+	_dateText.draw(p, x, y + st::walletRowDateTop, avail);
+}
+
+int HistoryRow::dateTop() const {
+	return _dateTop;
 }
 
 QRect HistoryRow::computeInnerRect() const {
+	if (collapsed()) {
+		return QRect();
+	}
 	const auto padding = st::walletRowPadding;
 	const auto use = std::min(_width, st::walletRowWidthMax);
 	const auto avail = use - padding.left() - padding.right();
@@ -430,26 +829,98 @@ QRect HistoryRow::computeInnerRect() const {
 	const auto width = (use < _width)
 		? (avail + 2 * st::walletRowShadowAdd)
 		: _width;
-	auto y = top();
-	if (!_layout.date.isEmpty()) {
-		y += st::walletRowDateSkip;
-	}
-	return QRect(left, y, width, bottom() - y);
+	const auto top = monthSkip()
+		+ (_showDate ? st::walletRowDateSkip : 0);
+	return QRect(left, top, width, _height - top);
 }
 
 bool HistoryRow::isUnderCursor(QPoint point) const {
-	return computeInnerRect().contains(point);
+	return isMonthUnderCursor(point) || computeInnerRect().contains(point);
 }
 
 ClickHandlerPtr HistoryRow::handlerUnderCursor(QPoint point) const {
 	return nullptr;
 }
 
+class HistoryRowCache final {
+public:
+	explicit HistoryRowCache(int64 limit);
+
+	[[nodiscard]] const QPixmap *find(int64 key, QSize size);
+	void store(int64 key, QPixmap pixmap);
+	void remove(int64 key);
+	void clear();
+
+private:
+	struct Entry {
+		QPixmap pixmap;
+		std::list<int64>::iterator used;
+	};
+
+	[[nodiscard]] static int64 CountBytes(const QPixmap &pixmap);
+
+	const int64 _limit = 0;
+	std::unordered_map<int64, Entry> _entries;
+	std::list<int64> _used;
+	int64 _bytes = 0;
+
+};
+
+HistoryRowCache::HistoryRowCache(int64 limit) : _limit(limit) {
+}
+
+const QPixmap *HistoryRowCache::find(int64 key, QSize size) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		return nullptr;
+	} else if (i->second.pixmap.size() != size) {
+		remove(key);
+		return nullptr;
+	}
+	_used.splice(end(_used), _used, i->second.used);
+	return &i->second.pixmap;
+}
+
+void HistoryRowCache::store(int64 key, QPixmap pixmap) {
+	remove(key);
+	const auto bytes = CountBytes(pixmap);
+	if (bytes > _limit) {
+		return;
+	}
+	while (_bytes + bytes > _limit) {
+		remove(_used.front());
+	}
+	_bytes += bytes;
+	_entries.emplace(
+		key,
+		Entry{ std::move(pixmap), _used.insert(end(_used), key) });
+}
+
+void HistoryRowCache::remove(int64 key) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		return;
+	}
+	_bytes -= CountBytes(i->second.pixmap);
+	_used.erase(i->second.used);
+	_entries.erase(i);
+}
+
+void HistoryRowCache::clear() {
+	_entries.clear();
+	_used.clear();
+	_bytes = 0;
+}
+
+int64 HistoryRowCache::CountBytes(const QPixmap &pixmap) {
+	return int64(pixmap.width()) * pixmap.height() * 4;
+}
+
 History::History(
 	not_null<Ui::RpWidget*> parent,
 	rpl::producer<HistoryState> state,
 	rpl::producer<Ton::LoadedSlice> loaded,
-	rpl::producer<not_null<std::vector<Ton::Transaction>*>> collectEncrypted,
+	rpl::producer<not_null<DecryptChunk*>> collectEncrypted,
 	rpl::producer<
 		not_null<const std::vector<Ton::Transaction>*>> updateDecrypted)
 : _widget(parent) {
@@ -457,21 +928,18 @@ History::History(
 
 	base::unixtime::updates(
 	) | rpl::start_with_next([=] {
-		for (const auto &row : ranges::view::concat(_pendingRows, _rows)) {
-			row->refreshDate();
-		}
-		refreshShowDates();
-		_widget.update();
+		refreshDates();
+	}, _widget.lifetime());
+
+	style::PaletteChanged(
+	) | rpl::start_with_next([=] {
+		clearRowCache();
 	}, _widget.lifetime());
 
 	std::move(
 		collectEncrypted
-	) | rpl::start_with_next([=](
-			not_null<std::vector<Ton::Transaction>*> list) {
-		auto &&encrypted = ranges::view::all(
-			_listData
-		) | ranges::view::filter(IsEncryptedMessage);
-		list->insert(list->end(), encrypted.begin(), encrypted.end());
+	) | rpl::start_with_next([=](not_null<DecryptChunk*> chunk) {
+		this->collectEncrypted(chunk);
 	}, _widget.lifetime());
 
 	std::move(
@@ -479,15 +947,18 @@ History::History(
 	) | rpl::start_with_next([=](
 			not_null<const std::vector<Ton::Transaction>*> list) {
 		auto changed = false;
-		for (auto i = 0, count = int(_listData.size()); i != count; ++i) {
-			if (IsEncryptedMessage(_listData[i])) {
-				if (takeDecrypted(i, *list)) {
-					changed = true;
-				}
+		for (const auto &transaction : *list) {
+			if (takeDecrypted(transaction)) {
+				changed = true;
 			}
 		}
-		if (changed) {
-			refreshShowDates();
+		if (!changed) {
+			return;
+		} else if (_searchDirty) {
+			refreshSearch();
+		} else {
+			refreshHeight();
+			refreshLayouts();
 			_widget.update();
 		}
 	}, _widget.lifetime());
@@ -498,24 +969,158 @@ History::~History() = default;
 void History::updateGeometry(QPoint position, int width) {
 	_widget.move(position);
 	resizeToWidth(width);
+	refreshLayouts();
 }
 
 void History::resizeToWidth(int width) {
-	if (!width) {
+	if (!width || _width == width) {
+		return;
+	}
+	WALLET_TRACE_SCOPE("History::resizeToWidth", Trace::Sized(width));
+	_width = width;
+	_pendingHeights.assign(countHeights(_pendingRows));
+	_heights.assign(countHeights(_rows));
+	refreshHeight();
+}
+
+void History::refreshHeight() {
+	if (!_width) {
 		return;
 	}
-	auto height = (_pendingRows.empty() && _rows.empty())
+	const auto height = (_pendingRows.empty() && _rows.empty())
 		? 0
-		: st::walletRowsSkip;
-	for (const auto &row : ranges::view::concat(_pendingRows, _rows)) {
-		row->setTop(height);
-		row->resizeToWidth(width);
-		height += row->height();
+		: (_pendingHeights.total()
+			+ _heights.total()
+			+ 2 * st::walletRowsSkip);
+	_widget.resize(_width, height);
+}
+
+int History::countHeight(not_null<HistoryRow*> row) const {
+	if (hiddenBySearch(row) || (collapsedByMonth(row) && !row->showMonth())) {
+		return 0;
+	} else if (_width > 0) {
+		row->resizeToWidth(_width);
+	}
+	return row->height();
+}
+
+std::vector<int> History::countHeights(
+		const std::vector<std::unique_ptr<HistoryRow>> &rows) const {
+	return ranges::view::all(
+		rows
+	) | ranges::view::transform([&](const std::unique_ptr<HistoryRow> &row) {
+		return countHeight(row.get());
+	}) | ranges::to_vector;
+}
+
+bool History::hiddenBySearch(not_null<HistoryRow*> row) const {
+	return !_searchQuery.isEmpty()
+		&& (_searchResults.find(row->id().lt) == end(_searchResults));
+}
+
+bool History::collapsedByMonth(not_null<HistoryRow*> row) const {
+	// Search results are shown without months, pending rows never have.
+	if (!_searchQuery.isEmpty() || !row->id().lt) {
+		return false;
 	}
-	if (height > 0) {
-		height += st::walletRowsSkip;
+	const auto i = _months.find(MonthKey(row->date()));
+	return (i != end(_months)) && i->second.collapsed;
+}
+
+bool History::skipLayout(not_null<HistoryRow*> row) const {
+	return hiddenBySearch(row) || collapsedByMonth(row);
+}
+
+void History::setSearchQuery(const QString &query) {
+	const auto trimmed = query.trimmed();
+	if (_searchQuery == trimmed) {
+		return;
+	}
+	_searchQuery = trimmed;
+	refreshSearch();
+	_scrollToRequests.fire(_widget.y());
+}
+
+void History::refreshSearch() {
+	// Rows that are not found just get zero height, so that the
+	// positions, painting and preloading work the same way.
+	_searchDirty = false;
+	const auto searching = !_searchQuery.isEmpty();
+	const auto found = _searchIndex.find(_searchQuery);
+	auto results = std::unordered_set<int64>(begin(found), end(found));
+	if (std::exchange(_searchApplied, searching) != searching) {
+		// Pending rows and months are shown or hidden all at once.
+		_searchResults = std::move(results);
+		_pendingHeights.assign(countHeights(_pendingRows));
+		_heights.assign(countHeights(_rows));
+		refreshShowDates();
+	} else {
+		// Only the rows found or lost by the new query are updated.
+		auto changed = std::vector<int>();
+		const auto collect = [&](
+				const std::unordered_set<int64> &from,
+				const std::unordered_set<int64> &without) {
+			for (const auto lt : from) {
+				if (without.find(lt) != end(without)) {
+					continue;
+				}
+				const auto i = _positions.find(lt);
+				const auto index = (i != end(_positions))
+					? (i->second - _positionsOrigin)
+					: -1;
+				if (index >= 0 && index < int(_rows.size())) {
+					changed.push_back(index);
+				}
+			}
+		};
+		collect(_searchResults, results);
+		collect(results, _searchResults);
+		_searchResults = std::move(results);
+		ranges::sort(changed);
+		for (const auto index : changed) {
+			refreshRowHeight(index);
+		}
+		for (auto i = begin(changed); i != end(changed);) {
+			const auto from = *i;
+			auto till = from + 1;
+			while (++i != end(changed) && *i == till) {
+				++till;
+			}
+			refreshShowDates(from, till);
+		}
 	}
-	_widget.resize(width, height);
+	refreshLayouts();
+	_widget.update();
+}
+
+void History::refreshRowHeight(int index) {
+	Expects(index >= 0 && index < _rows.size());
+
+	_heights.set(index, countHeight(_rows[index].get()));
+}
+
+int History::rowsTop() const {
+	return st::walletRowsSkip + _pendingHeights.total();
+}
+
+int History::rowTop(int index) const {
+	return rowsTop() + _heights.top(index);
+}
+
+void History::setRowCacheLimit(int64 bytes) {
+	_rowCache = (bytes > 0)
+		? std::make_unique<HistoryRowCache>(bytes)
+		: nullptr;
+}
+
+void History::setRestoreDecrypted(
+		Fn<bool(not_null<Ton::Transaction*>)> restore) {
+	_restoreDecrypted = std::move(restore);
+}
+
+auto History::balanceChanges() const
+-> rpl::producer<not_null<const BalanceSeries*>> {
+	return _balanceChanges.events();
 }
 
 rpl::producer<int> History::heightValue() const {
@@ -525,13 +1130,42 @@ rpl::producer<int> History::heightValue() const {
 void History::setVisibleTopBottom(int top, int bottom) {
 	_visibleTop = top - _widget.y();
 	_visibleBottom = bottom - _widget.y();
-	if (_visibleBottom <= _visibleTop || !_previousId.lt || _rows.empty()) {
+	_preload.scrolled(_visibleTop, _visibleBottom - _visibleTop);
+	refreshLayouts();
+	preloadAround();
+}
+
+void History::preloadAround() {
+	if (_visibleBottom <= _visibleTop || _rows.empty()) {
 		return;
 	}
-	const auto visibleHeight = (_visibleBottom - _visibleTop);
-	const auto preloadHeight = kPreloadScreens * visibleHeight;
+	const auto preloadHeight = _preload.preloadHeight();
+	for (const auto &gap : _gaps) {
+		const auto gapTop = rowTop(gap.index);
+		if (gapTop + preloadHeight >= _visibleTop
+			&& gapTop <= _visibleBottom + preloadHeight) {
+			requestSlice(gap.previousId);
+		}
+	}
+	if (!_previousId.lt) {
+		return;
+	} else if (_searchQuery.isEmpty()
+		&& !_months.empty()
+		&& begin(_months)->second.collapsed) {
+		// Older transactions would only add to the collapsed oldest month,
+		// the rest of the history is loaded after it is expanded.
+		return;
+	} else if (_visibleBottom >= _widget.height()) {
+		_preload.stalled(_previousId);
+	}
 	if (_visibleBottom + preloadHeight >= _widget.height()) {
-		_preloadRequests.fire_copy(_previousId);
+		requestSlice(_previousId);
+	}
+}
+
+void History::requestSlice(const Ton::TransactionId &id) {
+	if (_preload.request(id)) {
+		_preloadRequests.fire_copy(id);
 	}
 }
 
@@ -547,6 +1181,10 @@ rpl::producer<Ton::Transaction> History::decryptRequests() const {
 	return _decryptRequests.events();
 }
 
+rpl::producer<int> History::scrollToRequests() const {
+	return _scrollToRequests.events();
+}
+
 rpl::lifetime &History::lifetime() {
 	return _widget.lifetime();
 }
@@ -563,19 +1201,24 @@ void History::setupContent(
 	std::move(
 		loaded
 	) | rpl::filter([=](const Ton::LoadedSlice &slice) {
-		return (slice.after == _previousId);
+		// Slices loaded by somebody else, like the exporter, are skipped.
+		return _preload.finish(slice.after);
+	}) | rpl::filter([=](const Ton::LoadedSlice &slice) {
+		return (slice.after == _previousId)
+			|| (ranges::find(_gaps, slice.after, &Gap::previousId)
+				!= end(_gaps));
 	}) | rpl::start_with_next([=](Ton::LoadedSlice &&slice) {
-		const auto loadedLast = (_previousId.lt != 0)
-			&& (slice.data.previousId.lt == 0);
-		_previousId = slice.data.previousId;
-		_listData.insert(
-			end(_listData),
-			slice.data.list.begin(),
-			slice.data.list.end());
-		if (loadedLast) {
-			computeInitTransactionId();
+		const auto scroll = computeScrollState();
+		if (slice.after != _previousId) {
+			fillGap(std::move(slice));
+		} else {
+			appendData(std::move(slice.data));
+			refreshRows();
 		}
-		refreshRows();
+		restoreScrollState(scroll);
+
+		// While flinging the next slice may be needed already.
+		preloadAround();
 	}, lifetime());
 
 	_widget.paintRequest(
@@ -600,40 +1243,32 @@ void History::setupContent(
 void History::selectRow(int selected, ClickHandlerPtr handler) {
 	Expects(selected >= 0 || !handler);
 
+	const auto repaintSelected = [&] {
+		if (_selected >= 0 && _selected < int(_rows.size())) {
+			repaintRow(_selected);
+		}
+	};
 	if (_selected != selected) {
-		const auto was = (_selected >= 0 && _selected < int(_rows.size()))
-			? _rows[_selected].get()
-			: nullptr;
-		if (was) repaintRow(was);
+		repaintSelected();
 		_selected = selected;
 		_widget.setCursor((_selected >= 0)
 			? style::cur_pointer
 			: style::cur_default);
 	}
 	if (ClickHandler::getActive() != handler) {
-		const auto now = (_selected >= 0 && _selected < int(_rows.size()))
-			? _rows[_selected].get()
-			: nullptr;
-		if (now) repaintRow(now);
+		repaintSelected();
 		ClickHandler::setActive(handler);
 	}
 }
 
 void History::selectRowByMouse() {
 	const auto point = _widget.mapFromGlobal(QCursor::pos());
-	const auto from = ranges::upper_bound(
-		_rows,
-		point.y(),
-		ranges::less(),
-		&HistoryRow::bottom);
-	const auto till = ranges::lower_bound(
-		_rows,
-		point.y(),
-		ranges::less(),
-		&HistoryRow::top);
-
-	if (from != till && (*from)->isUnderCursor(point)) {
-		selectRow(from - begin(_rows), (*from)->handlerUnderCursor(point));
+	const auto [from, till] = findRows(point.y(), point.y() + 1);
+	const auto local = (from != till)
+		? (point - QPoint(0, rowTop(from)))
+		: QPoint();
+	if (from != till && _rows[from]->isUnderCursor(local)) {
+		selectRow(from, _rows[from]->handlerUnderCursor(local));
 	} else {
 		selectRow(-1, nullptr);
 	}
@@ -652,22 +1287,24 @@ void History::releaseRow() {
 		if (handler) handler->onClick(ClickContext());
 		return;
 	}
+	const auto &row = _rows[_selected];
+	const auto local = _widget.mapFromGlobal(QCursor::pos())
+		- QPoint(0, rowTop(_selected));
 	if (handler) {
 		handler->onClick(ClickContext());
+	} else if (row->isMonthUnderCursor(local)) {
+		toggleMonth(MonthKey(row->date()));
 	} else {
-		const auto i = ranges::find(
-			_listData,
-			_rows[_selected]->id(),
-			&Ton::Transaction::id);
-		Assert(i != end(_listData));
-		_viewRequests.fire_copy(*i);
+		const auto index = findDataIndex(row->id());
+		Assert(index >= 0);
+		_viewRequests.fire(_listData.get(index));
 	}
 }
 
 void History::decryptById(const Ton::TransactionId &id) {
-	const auto i = ranges::find(_listData, id, &Ton::Transaction::id);
-	Assert(i != end(_listData));
-	_decryptRequests.fire_copy(*i);
+	const auto index = findDataIndex(id);
+	Assert(index >= 0);
+	_decryptRequests.fire(_listData.get(index));
 }
 
 void History::paint(Painter &p, QRect clip) {
@@ -675,96 +1312,341 @@ void History::paint(Painter &p, QRect clip) {
 		return;
 	}
 	const auto paintRows = [&](
-			const std::vector<std::unique_ptr<HistoryRow>> &rows) {
-		const auto from = ranges::upper_bound(
-			rows,
-			clip.top(),
-			ranges::less(),
-			&HistoryRow::bottom);
-		const auto till = ranges::lower_bound(
-			rows,
-			clip.top() + clip.height(),
-			ranges::less(),
-			&HistoryRow::top);
+			const std::vector<std::unique_ptr<HistoryRow>> &rows,
+			const HeightIndex &heights,
+			int top) {
+		const auto [from, till] = FindRows(
+			heights,
+			clip.top() - top,
+			clip.top() + clip.height() - top);
 		if (from == till) {
 			return;
 		}
-		for (const auto &row : ranges::make_subrange(from, till)) {
-			row->paint(p, 0, row->top());
+		for (auto i = from; i != till; ++i) {
+			if (heights.height(i) > 0) {
+				paintRow(p, rows[i].get(), top + heights.top(i));
+			}
 		}
-		auto lastDateTop = rows.back()->bottom();
-		const auto dates = ranges::make_subrange(begin(rows), till);
-		for (const auto &row : dates | ranges::view::reverse) {
-			if (!row->showDate()) {
+		auto lastDateTop = top + heights.total();
+		for (auto i = till; i != 0;) {
+			const auto &row = rows[--i];
+			if (!heights.height(i)) {
 				continue;
 			}
-			const auto top = std::max(
+			const auto monthTop = top + heights.top(i);
+			if (row->collapsed()) {
+				// Dates of the newer rows don't overlap the month header.
+				if (monthTop <= _visibleTop) {
+					break;
+				}
+				lastDateTop = monthTop;
+				continue;
+			} else if (!row->showDate()) {
+				continue;
+			}
+			const auto rowTop = monthTop + row->monthSkip();
+			const auto dateTop = std::max(
 				std::min(_visibleTop, lastDateTop - st::walletRowDateHeight),
-				row->top());
-			row->paintDate(p, 0, top);
-			if (row->top() <= _visibleTop) {
+				rowTop);
+			row->paintDate(p, 0, dateTop, rowTop);
+			if (rowTop <= _visibleTop) {
 				break;
 			}
-			lastDateTop = top;
+			lastDateTop = row->showMonth() ? monthTop : dateTop;
 		}
 	};
-	paintRows(_pendingRows);
-	paintRows(_rows);
+	paintRows(_pendingRows, _pendingHeights, st::walletRowsSkip);
+	paintRows(_rows, _heights, rowsTop());
+}
+
+void History::paintRow(Painter &p, not_null<HistoryRow*> row, int top) {
+	const auto key = row->id().lt;
+	if (!_rowCache || !key || !row->hasLayout()) {
+		row->paint(p, 0, top);
+		return;
+	}
+	const auto ratio = style::DevicePixelRatio();
+	const auto size = QSize(_width, row->height()) * ratio;
+	if (const auto cached = _rowCache->find(key, size)) {
+		p.drawPixmap(0, top, *cached);
+		return;
+	}
+	auto image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+	image.setDevicePixelRatio(ratio);
+	image.fill(st::windowBg->c);
+	{
+		auto q = Painter(&image);
+		row->paint(q, 0, 0);
+	}
+	auto pixmap = Ui::PixmapFromImage(std::move(image));
+	p.drawPixmap(0, top, pixmap);
+	_rowCache->store(key, std::move(pixmap));
+}
+
+void History::clearRowCache() {
+	if (_rowCache) {
+		_rowCache->clear();
+	}
+}
+
+void History::invalidateRowCache(not_null<HistoryRow*> row) {
+	if (_rowCache) {
+		_rowCache->remove(row->id().lt);
+	}
 }
 
 History::ScrollState History::computeScrollState() const {
-	const auto item = ranges::upper_bound(
-		_rows,
-		_visibleTop,
-		ranges::less(),
-		&HistoryRow::bottom);
-	if (item == _rows.end()
-		|| (item == _rows.begin()
-			&& _rows.front()->id() == _listData.front().id)) {
+	const auto index = _heights.findByY(_visibleTop - rowsTop());
+	if (index == _heights.size()
+		|| (index == 0 && _rows.front()->id() == _listData.id(0))) {
 		return ScrollState();
 	}
 	auto result = ScrollState();
-	result.top = (*item)->id();
-	result.offset = _visibleTop - (*item)->top();
+	result.top = _rows[index]->id();
+	result.offset = _visibleTop - rowTop(index);
 	return result;
 }
 
-void History::mergeState(HistoryState &&state) {
-	if (mergePendingChanged(std::move(state.pendingTransactions))) {
-		refreshPending();
+void History::restoreScrollState(const ScrollState &state) {
+	if (!state.top.lt) {
+		return;
 	}
-	if (mergeListChanged(std::move(state.lastTransactions))) {
-		refreshRows();
+	const auto index = findRowIndex(state.top);
+	if (index < 0) {
+		return;
+	}
+	const auto top = rowTop(index) + state.offset;
+	if (top != _visibleTop) {
+		_scrollToRequests.fire(_widget.y() + top);
 	}
 }
 
-bool History::mergePendingChanged(
-		std::vector<Ton::PendingTransaction> &&list) {
-	if (_pendingData == list) {
-		return false;
+void History::mergeState(HistoryState &&state) {
+	WALLET_TRACE_SCOPE("History::mergeState");
+	const auto scroll = computeScrollState();
+	_balance.setCurrent(state.balance);
+	if (_pendingData != state.pendingTransactions) {
+		refreshPending(std::exchange(
+			_pendingData,
+			std::move(state.pendingTransactions)));
 	}
-	_pendingData = std::move(list);
-	return true;
+	if (mergeListChanged(std::move(state.lastTransactions))) {
+		refreshRows();
+	}
+	restoreScrollState(scroll);
 }
 
 bool History::mergeListChanged(Ton::TransactionsSlice &&data) {
 	const auto i = _listData.empty()
 		? data.list.cend()
-		: ranges::find(std::as_const(data.list), _listData.front());
+		: ranges::find(
+			std::as_const(data.list),
+			_listData.id(0),
+			&Ton::Transaction::id);
 	if (i == data.list.cend()) {
-		_listData = data.list | ranges::to_vector;
+		if (canSpliceWithGap(data)) {
+			// More transactions arrived than the slice holds, put them
+			// above the loaded ones and load the rest between them later.
+			const auto added = int(data.list.size());
+			prependData(data.list.cbegin(), data.list.cend());
+			_gaps.insert(begin(_gaps), Gap{ data.previousId, added });
+			return true;
+		}
+		_listData.clear();
+		_listData.insert(0, data.list.cbegin(), data.list.cend());
+		_balance.clear();
+		_balance.insert(0, data.list.cbegin(), data.list.cend());
+		_positions.clear();
+		_encrypted.clear();
+		_searchIndex.clear();
+		_gaps.clear();
+		_months.clear();
+		_monthsChanged.clear();
+		_positionsOrigin = 0;
+		_memoryLogged = 0;
+		clearRowCache();
+		indexData(0, _listData.size());
 		_previousId = std::move(data.previousId);
 		if (!_previousId.lt) {
 			computeInitTransactionId();
 		}
+		refreshBalance(0, _listData.size());
 		return true;
 	} else if (i != data.list.cbegin()) {
-		_listData.insert(begin(_listData), data.list.cbegin(), i);
+		prependData(data.list.cbegin(), i);
 		return true;
 	}
 	return false;
 }
 
+bool History::canSpliceWithGap(const Ton::TransactionsSlice &data) const {
+	return !_listData.empty()
+		&& !data.list.empty()
+		&& (data.previousId.lt != 0)
+		&& (data.list.back().id.lt > _listData.id(0).lt);
+}
+
+void History::prependData(
+		std::vector<Ton::Transaction>::const_iterator from,
+		std::vector<Ton::Transaction>::const_iterator till) {
+	const auto added = int(till - from);
+	_listData.insert(0, from, till);
+	_balance.insert(0, from, till);
+	_positionsOrigin -= added;
+	indexData(0, added);
+	for (auto &gap : _gaps) {
+		gap.index += added;
+	}
+	refreshBalance(0, added);
+}
+
+void History::appendData(Ton::TransactionsSlice &&data) {
+	const auto loadedLast = (_previousId.lt != 0)
+		&& (data.previousId.lt == 0);
+	_previousId = data.previousId;
+	const auto from = _listData.size();
+	_listData.insert(from, data.list.cbegin(), data.list.cend());
+	_balance.insert(from, data.list.cbegin(), data.list.cend());
+	indexData(from, _listData.size());
+	if (loadedLast) {
+		computeInitTransactionId();
+	}
+	refreshBalance(from, _listData.size());
+}
+
+void History::mergeStored(Ton::TransactionsSlice &&data) {
+	if (data.list.empty()) {
+		return;
+	} else if (_listData.empty()) {
+		_listData.insert(0, data.list.cbegin(), data.list.cend());
+		_balance.insert(0, data.list.cbegin(), data.list.cend());
+		_previousId = data.previousId;
+		indexData(0, _listData.size());
+		if (!_previousId.lt) {
+			computeInitTransactionId();
+		}
+		refreshBalance(0, _listData.size());
+		refreshRows();
+		return;
+	} else if (!_previousId.lt) {
+		return;
+	}
+	const auto scroll = computeScrollState();
+	const auto from = ranges::find(
+		data.list,
+		_previousId,
+		&Ton::Transaction::id);
+	if (from != end(data.list)) {
+		data.list.erase(begin(data.list), from);
+	} else if (data.list.front().id.lt < _previousId.lt) {
+		// Stored transactions are older than the loaded ones,
+		// load the ones between them later.
+		_gaps.push_back(Gap{ _previousId, _listData.size() });
+	} else {
+		return;
+	}
+	appendData(std::move(data));
+	refreshRows();
+	restoreScrollState(scroll);
+}
+
+void History::collectChunk(not_null<HistoryChunk*> chunk) const {
+	Expects(chunk->limit > 0);
+
+	const auto size = _listData.size();
+	const auto from = chunk->from.lt
+		? findDataIndex(chunk->from)
+		: (size > 0 ? 0 : -1);
+	if (from < 0) {
+		return;
+	}
+	auto till = std::min(from + chunk->limit, size);
+	auto previousId = (till < size) ? _listData.id(till) : _previousId;
+	for (const auto &gap : _gaps) {
+		if (gap.index > from && gap.index <= till) {
+			till = gap.index;
+			previousId = gap.previousId;
+		}
+	}
+	chunk->list.reserve(chunk->list.size() + till - from);
+	for (auto i = from; i != till; ++i) {
+		chunk->list.push_back(_listData.get(i));
+	}
+	chunk->previousId = previousId;
+}
+
+void History::fillGap(Ton::LoadedSlice &&slice) {
+	const auto gap = ranges::find(_gaps, slice.after, &Gap::previousId);
+	Assert(gap != end(_gaps));
+
+	const auto index = gap->index;
+	const auto &list = slice.data.list;
+	const auto nextLt = (index < _listData.size())
+		? _listData.id(index).lt
+		: int64(0);
+	const auto known = ranges::find_if(list, [&](
+			const Ton::Transaction &data) {
+		return (data.id.lt <= nextLt);
+	});
+	const auto added = int(known - begin(list));
+	for (auto &other : _gaps) {
+		if (other.index > index) {
+			other.index += added;
+		}
+	}
+	if (known != end(list) || !slice.data.previousId.lt) {
+		_gaps.erase(gap);
+	} else {
+		gap->previousId = slice.data.previousId;
+		gap->index += added;
+	}
+	if (!added) {
+		return;
+	}
+	_listData.insert(index, begin(list), known);
+	_balance.insert(index, begin(list), known);
+
+	// Gaps are usually close to the top, so we shift the head positions.
+	_positionsOrigin -= added;
+	indexPositions(0, index);
+	indexData(index, index + added);
+	refreshBalance(index, index + added);
+
+	insertRows(index, added);
+}
+
+void History::insertRows(int index, int count) {
+	Expects(index >= 0 && index <= _rows.size());
+	Expects(index + count <= _listData.size());
+
+	auto rows = ranges::view::ints(
+		index,
+		index + count
+	) | ranges::view::transform([=](int i) {
+		return makeRow(_listData.get(i));
+	}) | ranges::to_vector;
+	_heights.insert(index, countHeights(rows));
+	_rows.insert(
+		begin(_rows) + index,
+		std::make_move_iterator(begin(rows)),
+		std::make_move_iterator(end(rows)));
+	if (index <= _layoutFrom) {
+		_layoutFrom += count;
+	}
+	if (index < _layoutTill) {
+		_layoutTill += count;
+	}
+
+	refreshMonths();
+	refreshShowDates(index, index + count);
+	refreshLayouts();
+	schedulePrepare(index, index + count);
+	if (_searchDirty) {
+		refreshSearch();
+	}
+	_widget.update();
+}
+
 void History::setRowShowDate(
 		const std::unique_ptr<HistoryRow> &row,
 		bool show) {
@@ -772,29 +1654,236 @@ void History::setRowShowDate(
 	row->setShowDate(show, [=] { repaintShadow(raw); });
 }
 
-bool History::takeDecrypted(
-		int index,
-		const std::vector<Ton::Transaction> &decrypted) {
-	Expects(index >= 0 && index < _listData.size());
-	Expects(index >= 0 && index < _rows.size());
-	Expects(_rows[index]->id() == _listData[index].id);
+void History::setRowShowMonth(
+		const std::unique_ptr<HistoryRow> &row,
+		bool show) {
+	if (!show) {
+		row->setMonth(nullptr);
+		return;
+	}
+	const auto date = row->date();
+	const auto i = _months.find(MonthKey(date));
+	const auto month = (i != end(_months)) ? i->second : Month();
+	const auto header = MonthHeader{
+		ph::lng_wallet_month(date)(ph::now),
+		ph::lng_wallet_row_month_summary(ph::now).replace(
+			"{count}",
+			QString::number(month.count)
+		).replace(
+			"{received}",
+			FormatAmount(month.received, FormatFlag::Rounded).full
+		).replace(
+			"{sent}",
+			FormatAmount(month.sent, FormatFlag::Rounded).full),
+		month.collapsed,
+	};
+	row->setMonth(&header);
+	invalidateRowCache(row.get());
+}
 
-	const auto i = ranges::find(
-		decrypted,
-		_listData[index].id,
-		&Ton::Transaction::id);
-	if (i == end(decrypted)) {
+void History::addToMonth(const Ton::Transaction &data) {
+	const auto key = MonthKey(base::unixtime::parse(data.time).date());
+	auto i = _months.find(key);
+	if (i == end(_months)) {
+		// Only the two latest months are expanded from the start,
+		// or the newest loaded one if the account was idle for longer.
+		const auto recent = MonthKey(QDate::currentDate()) - 1;
+		const auto newest = _months.empty()
+			? key
+			: (end(_months) - 1)->first;
+		auto month = Month();
+		month.collapsed = (key < std::min(recent, newest));
+		i = _months.emplace(key, month).first;
+	}
+	auto &month = i->second;
+	const auto value = CalculateValue(data);
+	++month.count;
+	if (value > 0) {
+		month.received += value;
+	} else {
+		month.sent -= value;
+	}
+	_monthsChanged.emplace(key);
+}
+
+void History::refreshMonths() {
+	// Headers of the new months get their summaries with the rows,
+	// the ones shown already are updated here.
+	for (const auto key : base::take(_monthsChanged)) {
+		const auto index = findMonthRows(key).first;
+		if (index < int(_rows.size())
+			&& _rows[index]->showMonth()
+			&& MonthKey(_rows[index]->date()) == key) {
+			setRowShowMonth(_rows[index], true);
+			refreshRowHeight(index);
+		}
+	}
+}
+
+void History::toggleMonth(int key) {
+	const auto i = _months.find(key);
+	if (i == end(_months)) {
+		return;
+	}
+	const auto collapsed = i->second.collapsed = !i->second.collapsed;
+	const auto [from, till] = findMonthRows(key);
+	for (auto index = from; index != till; ++index) {
+		const auto &row = _rows[index];
+		if (collapsed) {
+			// Collapsed months don't keep anything laid out.
+			row->clearLayout();
+			row->clearPrepared();
+		}
+		if (row->showMonth()) {
+			setRowShowMonth(row, true);
+		}
+		invalidateRowCache(row.get());
+		refreshRowHeight(index);
+	}
+	refreshHeight();
+	refreshLayouts();
+	selectRowByMouse();
+	_widget.update();
+	preloadAround();
+}
+
+std::pair<int, int> History::findMonthRows(int key) const {
+	// List rows are sorted from the newest to the oldest transaction.
+	const auto month = [](const std::unique_ptr<HistoryRow> &row) {
+		return MonthKey(row->date());
+	};
+	const auto from = ranges::lower_bound(
+		_rows,
+		key,
+		ranges::greater(),
+		month);
+	const auto till = ranges::upper_bound(
+		from,
+		end(_rows),
+		key,
+		ranges::greater(),
+		month);
+	return { int(from - begin(_rows)), int(till - begin(_rows)) };
+}
+
+void History::refreshBalance(int from, int till) {
+	if (!_balance.known()) {
+		return;
+	}
+	const auto negative = _balance.findNegative(from, till);
+	if (negative >= 0) {
+		WALLET_LOG(("History balance: negative after %1, "
+			"some transactions are missing."
+			).arg(_listData.id(negative).lt));
+	} else if (!_previousId.lt && _gaps.empty()) {
+		const auto start = _balance.startBalance();
+		if (start && start != std::exchange(_balanceMismatch, start)) {
+			WALLET_LOG(("History balance: starts from %1 instead of zero, "
+				"some transactions are missing."
+				).arg(start));
+		}
+	}
+	_balanceChanges.fire(&_balance);
+}
+
+void History::indexPositions(int from, int till) {
+	Expects(from >= 0 && from <= till && till <= _listData.size());
+
+	for (auto i = from; i != till; ++i) {
+		_positions[_listData.id(i).lt] = _positionsOrigin + i;
+	}
+}
+
+void History::indexData(int from, int till) {
+	Expects(from >= 0 && from <= till && till <= _listData.size());
+
+	for (auto i = from; i != till; ++i) {
+		auto data = _listData.get(i);
+		_positions[data.id.lt] = _positionsOrigin + i;
+		addToMonth(data);
+		if (IsEncryptedMessage(data)) {
+			if (_restoreDecrypted && _restoreDecrypted(&data)) {
+				_listData.replace(i, data);
+			} else {
+				_encrypted.emplace(data.id.lt);
+			}
+		}
+		_searchIndex.add(data);
+	}
+	if (from != till && !_searchQuery.isEmpty()) {
+		_searchDirty = true;
+	}
+	logMemoryUsage();
+}
+
+void History::logMemoryUsage() {
+	const auto logged = _listData.size() / kLogMemoryEach;
+	if (logged <= _memoryLogged) {
+		return;
+	}
+	_memoryLogged = logged;
+	const auto count = _listData.size();
+	WALLET_LOG(("History memory: %1 transactions, "
+		"%2 bytes per row stored, %3 bytes per row unpacked."
+		).arg(count
+		).arg(_listData.bytes() / count
+		).arg(_listData.plainBytes() / count));
+}
+
+int History::findDataIndex(const Ton::TransactionId &id) const {
+	const auto i = _positions.find(id.lt);
+	if (i == end(_positions)) {
+		return -1;
+	}
+	const auto index = i->second - _positionsOrigin;
+	Assert(index >= 0 && index < _listData.size());
+	return (_listData.id(index) == id) ? index : -1;
+}
+
+bool History::takeDecrypted(const Ton::Transaction &decrypted) {
+	const auto encrypted = _encrypted.find(decrypted.id.lt);
+	if (encrypted == end(_encrypted)) {
 		return false;
 	}
-	if (IsEncryptedMessage(*i)) {
+	const auto index = findDataIndex(decrypted.id);
+	if (index < 0) {
+		return false;
+	}
+	Assert(index < _rows.size());
+	Assert(_rows[index]->id() == decrypted.id);
+
+	if (IsEncryptedMessage(decrypted)) {
 		_rows[index]->setDecryptionFailed();
+		invalidateRowCache(_rows[index].get());
+		refreshRowHeight(index);
 	} else {
-		_listData[index] = *i;
-		_rows[index] = makeRow(*i);
+		_encrypted.erase(encrypted);
+		_listData.replace(index, decrypted);
+		_searchIndex.add(decrypted);
+		_searchDirty = !_searchQuery.isEmpty();
+		replaceRow(index, decrypted);
 	}
 	return true;
 }
 
+void History::replaceRow(int index, const Ton::Transaction &data) {
+	Expects(index >= 0 && index < _rows.size());
+	Expects(_rows[index]->id() == data.id);
+
+	const auto showDate = _rows[index]->showDate();
+	const auto showMonth = _rows[index]->showMonth();
+	invalidateRowCache(_rows[index].get());
+	_rows[index] = makeRow(data);
+	if (index >= _layoutFrom
+		&& index < _layoutTill
+		&& !collapsedByMonth(_rows[index].get())) {
+		_rows[index]->prepareLayout(data);
+	}
+	setRowShowDate(_rows[index], showDate);
+	setRowShowMonth(_rows[index], showMonth);
+	refreshRowHeight(index);
+}
+
 std::unique_ptr<HistoryRow> History::makeRow(const Ton::Transaction &data) {
 	const auto id = data.id;
 	if (const auto pending = (id.lt == 0)) {
@@ -807,113 +1896,401 @@ std::unique_ptr<HistoryRow> History::makeRow(const Ton::Transaction &data) {
 		isInitTransaction);
 }
 
+void History::collectEncrypted(not_null<DecryptChunk*> chunk) const {
+	Expects(chunk->limit > 0);
+
+	if (_encrypted.empty()) {
+		return;
+	}
+	// Rows follow _listData, so the closest ones to the middle
+	// of the visible area are the closest ones by index as well.
+	const auto middle = std::clamp(
+		_heights.findByY((_visibleTop + _visibleBottom) / 2 - rowsTop()),
+		0,
+		std::max(_listData.size() - 1, 0));
+	auto candidates = std::vector<std::pair<int, int>>();
+	candidates.reserve(_encrypted.size());
+	for (const auto lt : _encrypted) {
+		if (chunk->skip.contains(lt)) {
+			continue;
+		}
+		const auto i = _positions.find(lt);
+		Assert(i != end(_positions));
+		const auto index = i->second - _positionsOrigin;
+		candidates.emplace_back(std::abs(index - middle), index);
+	}
+	const auto count = std::min(int(candidates.size()), chunk->limit);
+	ranges::partial_sort(candidates, begin(candidates) + count);
+	chunk->list.reserve(chunk->list.size() + count);
+	for (auto i = 0; i != count; ++i) {
+		chunk->list.push_back(_listData.get(candidates[i].second));
+	}
+}
+
 void History::computeInitTransactionId() {
 	const auto was = _initTransactionId;
-	auto found = static_cast<Ton::Transaction*>(nullptr);
-	for (auto &row : ranges::view::reverse(_listData)) {
-		if (IsServiceTransaction(row)) {
-			found = &row;
+	auto found = -1;
+	for (auto i = _listData.size(); i != 0;) {
+		const auto data = _listData.get(--i);
+		if (IsServiceTransaction(data)) {
+			found = i;
 			break;
-		} else if (row.incoming.source.isEmpty()) {
+		} else if (data.incoming.source.isEmpty()) {
 			break;
 		}
 	}
-	const auto now = found ? found->id : Ton::TransactionId();
+	const auto now = (found >= 0)
+		? _listData.id(found)
+		: Ton::TransactionId();
 	if (was == now) {
 		return;
 	}
 
 	_initTransactionId = now;
-	const auto wasItem = ranges::find(_listData, was, &Ton::Transaction::id);
-	if (wasItem != end(_listData)) {
-		wasItem->initializing = false;
-		const auto wasRow = ranges::find(_rows, was, &HistoryRow::id);
-		if (wasRow != end(_rows)) {
-			*wasRow = makeRow(*wasItem);
+	if (const auto wasIndex = findDataIndex(was); wasIndex >= 0) {
+		auto wasItem = _listData.get(wasIndex);
+		wasItem.initializing = false;
+		_listData.replace(wasIndex, wasItem);
+		if (const auto wasRow = findRowIndex(was); wasRow >= 0) {
+			replaceRow(wasRow, wasItem);
 		}
 	}
-	if (found) {
-		found->initializing = true;
-		const auto nowRow = ranges::find(_rows, now, &HistoryRow::id);
-		if (nowRow != end(_rows)) {
-			*nowRow = makeRow(*found);
+	if (found >= 0) {
+		auto item = _listData.get(found);
+		item.initializing = true;
+		_listData.replace(found, item);
+		if (const auto nowRow = findRowIndex(now); nowRow >= 0) {
+			replaceRow(nowRow, item);
 		}
 	}
 }
 
+void History::refreshDates() {
+	// Only the rows with layouts are updated now, the rest of them
+	// will be updated when they get their layouts.
+	++_dateGeneration;
+	for (const auto &row : _pendingRows) {
+		row->refreshDate(_dateGeneration);
+	}
+	auto changedFrom = _layoutTill;
+	auto changedTill = _layoutFrom;
+	for (auto i = _layoutFrom; i != _layoutTill; ++i) {
+		if (_rows[i]->refreshDate(_dateGeneration)) {
+			invalidateRowCache(_rows[i].get());
+			changedFrom = std::min(changedFrom, i);
+			changedTill = i + 1;
+		}
+	}
+	if (changedFrom < changedTill) {
+		refreshShowDates(changedFrom, changedTill);
+	}
+	_widget.update();
+}
+
 void History::refreshShowDates() {
+	refreshShowDates(0, int(_rows.size()));
+}
+
+void History::refreshShowDates(int from, int till) {
+	Expects(from >= 0 && from <= till && till <= _rows.size());
+
+	const auto count = int(_rows.size());
+	if (!_searchQuery.isEmpty() && !_width && (from > 0 || till < count)) {
+		// Without the heights the shown neighbours are not known.
+		refreshShowDates();
+		return;
+	}
 	auto previous = QDate();
-	for (const auto &row : _rows) {
-		const auto current = row->date().date();
-		setRowShowDate(row, current != previous);
+	if (const auto shown = shownRowBefore(from); shown >= 0) {
+		previous = _rows[shown]->date();
+	}
+	const auto refresh = [&](int index) {
+		const auto &row = _rows[index];
+		const auto current = row->date();
+		const auto showDate = (current != previous);
+		const auto showMonth = _searchQuery.isEmpty()
+			&& (MonthKey(current) != MonthKey(previous));
+		if (row->showDate() != showDate || row->showMonth() != showMonth) {
+			setRowShowDate(row, showDate);
+			setRowShowMonth(row, showMonth);
+			refreshRowHeight(index);
+		}
 		previous = current;
+	};
+	for (auto i = from; i != till; ++i) {
+		if (!hiddenBySearch(_rows[i].get())) {
+			refresh(i);
+		}
+	}
+
+	// A change in [from, till) may add or remove the next row header.
+	if (const auto next = shownRowAfter(till - 1); next < count) {
+		refresh(next);
+	}
+	refreshHeight();
+}
+
+int History::shownRowBefore(int index) const {
+	if (index <= 0) {
+		return -1;
+	} else if (_searchQuery.isEmpty()) {
+		return index - 1;
+	}
+	// Rows hidden by the search have zero height, skip them by the heights.
+	const auto top = _heights.top(index);
+	return (top > 0) ? _heights.findByY(top - 1) : -1;
+}
+
+int History::shownRowAfter(int index) const {
+	const auto count = int(_rows.size());
+	if (_searchQuery.isEmpty() || index + 1 >= count) {
+		return std::min(index + 1, count);
 	}
-	resizeToWidth(_widget.width());
+	return _heights.findByY((index >= 0) ? _heights.bottom(index) : 0);
 }
 
-void History::refreshPending() {
+void History::refreshPending(
+		std::vector<Ton::PendingTransaction> &&wasData) {
+	// Pending transactions have no ids yet, keep rows of the same ones.
+	auto wasRows = std::move(_pendingRows);
 	_pendingRows = ranges::view::all(
 		_pendingData
 	) | ranges::view::transform([&](const Ton::PendingTransaction &data) {
-		return makeRow(data.fake);
+		const auto i = ranges::find(wasData, data);
+		if (i != end(wasData)) {
+			const auto index = int(i - begin(wasData));
+			if (auto &row = wasRows[index]) {
+				return std::move(row);
+			}
+		}
+		auto result = makeRow(data.fake);
+		result->prepareLayout(data.fake);
+		return result;
 	}) | ranges::to_vector;
 
-	if (!_pendingRows.empty()) {
-		setRowShowDate(_pendingRows.front());
+	for (const auto &row : _pendingRows) {
+		setRowShowDate(row, (row == _pendingRows.front()));
 	}
-	resizeToWidth(_widget.width());
+	_pendingHeights.assign(countHeights(_pendingRows));
+	refreshHeight();
 }
 
 void History::refreshRows() {
+	WALLET_TRACE_SCOPE("History::refreshRows", Trace::Sized(_listData.size()));
 	auto addedFront = std::vector<std::unique_ptr<HistoryRow>>();
 	auto addedBack = std::vector<std::unique_ptr<HistoryRow>>();
-	for (const auto &element : _listData) {
-		if (!_rows.empty() && element.id == _rows.front()->id()) {
+	for (auto i = 0, count = _listData.size(); i != count; ++i) {
+		if (!_rows.empty() && _listData.id(i) == _rows.front()->id()) {
 			break;
 		}
-		addedFront.push_back(makeRow(element));
+		addedFront.push_back(makeRow(_listData.get(i)));
 	}
-	if (!_rows.empty()) {
-		const auto from = ranges::find(
-			_listData,
-			_rows.back()->id(),
-			&Ton::Transaction::id);
-		if (from != end(_listData)) {
-			addedBack = ranges::make_subrange(
+	// The old rows are kept only if the newest of them is still there,
+	// otherwise the list is replaced and nothing is added after them.
+	const auto incremental = (int(addedFront.size()) < _listData.size());
+	if (!_rows.empty() && incremental) {
+		const auto from = findDataIndex(_rows.back()->id());
+		if (from >= 0) {
+			addedBack = ranges::view::ints(
 				from + 1,
-				end(_listData)
-			) | ranges::view::transform([=](const Ton::Transaction &data) {
-				return makeRow(data);
+				_listData.size()
+			) | ranges::view::transform([=](int i) {
+				return makeRow(_listData.get(i));
 			}) | ranges::to_vector;
 		}
 	}
+	const auto addedFrontCount = int(addedFront.size());
 	if (addedFront.empty() && addedBack.empty()) {
 		return;
 	} else if (!addedFront.empty()) {
-		if (addedFront.size() < _listData.size()) {
+		if (incremental) {
+			const auto added = int(addedFront.size());
+			_layoutFrom += added;
+			_layoutTill += added;
+			_heights.prepend(countHeights(addedFront));
 			addedFront.insert(
 				end(addedFront),
 				std::make_move_iterator(begin(_rows)),
 				std::make_move_iterator(end(_rows)));
+		} else {
+			_layoutFrom = _layoutTill = 0;
+			_heights.assign(countHeights(addedFront));
 		}
 		_rows = std::move(addedFront);
 	}
+	const auto addedFrom = int(_rows.size());
+	_heights.append(countHeights(addedBack));
 	_rows.insert(
 		end(_rows),
 		std::make_move_iterator(begin(addedBack)),
 		std::make_move_iterator(end(addedBack)));
 
-	refreshShowDates();
+	refreshMonths();
+	refreshShowDates(0, addedFrontCount);
+	refreshShowDates(addedFrom, int(_rows.size()));
+	refreshLayouts();
+	schedulePrepare(0, addedFrontCount);
+	schedulePrepare(addedFrom, int(_rows.size()));
+	if (_searchDirty) {
+		refreshSearch();
+	}
+}
+
+std::pair<int, int> History::findRows(int top, int bottom) const {
+	const auto shift = rowsTop();
+	return FindRows(_heights, top - shift, bottom - shift);
+}
+
+void History::refreshLayouts() {
+	if (_visibleBottom <= _visibleTop) {
+		return;
+	}
+	// Only rows around the visible part own their text layouts,
+	// so that loading a long history doesn't shape every row.
+	const auto visibleHeight = (_visibleBottom - _visibleTop);
+	const auto layoutSkip = kLayoutScreens * visibleHeight;
+	const auto dropSkip = kLayoutDropScreens * visibleHeight;
+	auto [from, till] = findRows(
+		_visibleTop - layoutSkip,
+		_visibleBottom + layoutSkip);
+	const auto [keepFrom, keepTill] = findRows(
+		_visibleTop - dropSkip,
+		_visibleBottom + dropSkip);
+	const auto keptFrom = std::max(_layoutFrom, keepFrom);
+	const auto keptTill = std::min(_layoutTill, keepTill);
+	if (keptFrom < keptTill) {
+		from = std::min(from, keptFrom);
+		till = std::max(till, keptTill);
+	}
+	for (auto i = _layoutFrom; i != _layoutTill; ++i) {
+		if (i < from || i >= till) {
+			_rows[i]->clearLayout();
+		}
+	}
+	auto changed = false;
+	auto datesFrom = till;
+	auto datesTill = from;
+	for (auto i = from; i != till; ++i) {
+		const auto &row = _rows[i];
+		if (row->refreshDate(_dateGeneration)) {
+			datesFrom = std::min(datesFrom, i);
+			datesTill = std::max(datesTill, i + 1);
+		}
+		if (!row->hasLayout()
+			&& row->hasPrepared()
+			&& !skipLayout(row.get())) {
+			row->prepareLayout(_listData.get(i));
+			refreshRowHeight(i);
+			changed = true;
+		}
+	}
+	_layoutFrom = from;
+	_layoutTill = till;
+	schedulePrepare(from, till);
+	if (datesFrom < datesTill) {
+		refreshShowDates(datesFrom, datesTill);
+	} else if (changed) {
+		refreshHeight();
+	}
+}
+
+void History::schedulePrepare(int from, int till) {
+	Expects(from >= 0 && from <= till && till <= _rows.size());
+
+	// Rows get their strings formatted and measured in background and
+	// show placeholders until then, only the text shaping is left here.
+	auto chunk = std::vector<Ton::Transaction>();
+	const auto context = PrepareLayoutContext();
+	const auto send = [&] {
+		if (chunk.empty()) {
+			return;
+		}
+		const auto initTransactionId = _initTransactionId;
+		const auto apply = crl::guard(this, [=](
+				std::vector<PreparedLayout> list) {
+			auto changed = false;
+			for (auto &prepared : list) {
+				_preparing.remove(prepared.id.lt);
+				const auto index = findRowIndex(prepared.id);
+				if (index < 0) {
+					continue;
+				}
+				const auto &row = _rows[index];
+				if (collapsedByMonth(row.get())) {
+					continue;
+				}
+				row->setPrepared(std::move(prepared));
+				if (row->refreshDate(_dateGeneration)) {
+					refreshShowDates(index, index + 1);
+				}
+				if (index >= _layoutFrom
+					&& index < _layoutTill
+					&& !row->hasLayout()
+					&& row->hasPrepared()
+					&& !skipLayout(row.get())) {
+					row->prepareLayout(_listData.get(index));
+					refreshRowHeight(index);
+					changed = true;
+				}
+			}
+			if (changed) {
+				refreshHeight();
+				_widget.update();
+			}
+		});
+		crl::async([=, list = std::move(chunk)] {
+			auto result = ranges::view::all(
+				list
+			) | ranges::view::transform([&](const Ton::Transaction &data) {
+				return PrepareLayoutData(
+					data,
+					true,
+					(data.id == initTransactionId),
+					context);
+			}) | ranges::to_vector;
+			crl::on_main([=, result = std::move(result)]() mutable {
+				apply(std::move(result));
+			});
+		});
+		chunk = std::vector<Ton::Transaction>();
+	};
+	for (auto i = from; i != till; ++i) {
+		const auto &row = _rows[i];
+		if (row->hasPrepared()
+			|| skipLayout(row.get())
+			|| !_preparing.emplace(row->id().lt).second) {
+			continue;
+		}
+		chunk.push_back(_listData.get(i));
+		if (int(chunk.size()) == kPrepareChunk) {
+			send();
+		}
+	}
+	send();
+}
+
+int History::findRowIndex(const Ton::TransactionId &id) const {
+	// List rows are sorted from the newest to the oldest transaction.
+	const auto i = ranges::lower_bound(
+		_rows,
+		id.lt,
+		ranges::greater(),
+		[](const std::unique_ptr<HistoryRow> &row) { return row->id().lt; });
+	return (i != end(_rows) && (*i)->id() == id)
+		? int(i - begin(_rows))
+		: -1;
 }
 
-void History::repaintRow(not_null<HistoryRow*> row) {
-	_widget.update(0, row->top(), _widget.width(), row->height());
+void History::repaintRow(int index) {
+	Expects(index >= 0 && index < _rows.size());
+
+	invalidateRowCache(_rows[index].get());
+	_widget.update(0, rowTop(index), _widget.width(), _heights.height(index));
 }
 
 void History::repaintShadow(not_null<HistoryRow*> row) {
-	const auto min = std::min(row->top(), _visibleTop);
-	const auto delta = std::max(row->top(), _visibleTop) - min;
-	_widget.update(0, min, _widget.width(), delta + st::walletRowDateHeight);
+	const auto top = row->dateTop();
+	_widget.update(0, top, _widget.width(), st::walletRowDateHeight);
 }
 
 rpl::producer<HistoryState> MakeHistoryState(
@@ -923,9 +2300,19 @@ rpl::producer<HistoryState> MakeHistoryState(
 	) | rpl::map([](Ton::WalletViewerState &&state) {
 		return HistoryState{
 			std::move(state.wallet.lastTransactions),
-			std::move(state.wallet.pendingTransactions)
+			std::move(state.wallet.pendingTransactions),
+			state.wallet.account.fullBalance
 		};
 	});
 }
 
+void PrepareRowLayout(const Ton::Transaction &data, bool canDecrypt) {
+	const auto prepared = PrepareLayoutData(
+		data,
+		canDecrypt,
+		false,
+		PrepareLayoutContext());
+	[[maybe_unused]] const auto layout = FinishLayout(prepared);
+}
+
 } // namespace Wallet
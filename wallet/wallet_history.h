@@ -9,6 +9,17 @@
 #include "ui/rp_widget.h"
 #include "ton/ton_state.h"
 #include "ui/click_handler.h"
+#include "base/weak_ptr.h"
+#include "base/flat_map.h"
+#include "wallet/wallet_balance_series.h"
+#include "wallet/wallet_height_index.h"
+#include "wallet/wallet_preload_controller.h"
+#include "wallet/wallet_search_index.h"
+#include "wallet/wallet_transaction_store.h"
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 class Painter;
 
@@ -17,29 +28,57 @@ namespace Wallet {
 struct HistoryState {
 	Ton::TransactionsSlice lastTransactions;
 	std::vector<Ton::PendingTransaction> pendingTransactions;
+	int64 balance = Ton::kUnknownBalance;
+};
+
+// A contiguous part of the loaded history, starting from the 'from'
+// transaction or from the newest one if 'from' is empty. The 'list' stays
+// empty if 'from' is not loaded, otherwise 'previousId' is the next one.
+struct HistoryChunk {
+	Ton::TransactionId from;
+	int limit = 0;
+	std::vector<Ton::Transaction> list;
+	Ton::TransactionId previousId;
 };
 
 class HistoryRow;
+class HistoryRowCache;
+struct DecryptChunk;
 
-class History final {
+class History final : public base::has_weak_ptr {
 public:
 	History(
 		not_null<Ui::RpWidget*> parent,
 		rpl::producer<HistoryState> state,
 		rpl::producer<Ton::LoadedSlice> loaded,
-		rpl::producer<
-			not_null<std::vector<Ton::Transaction>*>> collectEncrypted,
+		rpl::producer<not_null<DecryptChunk*>> collectEncrypted,
 		rpl::producer<
 			not_null<const std::vector<Ton::Transaction>*>> updateDecrypted);
 	~History();
 
+	// Opt-in cache of rendered rows, limited by the pixmaps size in bytes.
+	void setRowCacheLimit(int64 bytes);
+
+	// Restores encrypted comments decrypted in the previous sessions.
+	void setRestoreDecrypted(Fn<bool(not_null<Ton::Transaction*>)> restore);
+
 	void updateGeometry(QPoint position, int width);
 	[[nodiscard]] rpl::producer<int> heightValue() const;
+	[[nodiscard]] auto balanceChanges() const
+		-> rpl::producer<not_null<const BalanceSeries*>>;
 	void setVisibleTopBottom(int top, int bottom);
 
+	// Shows only the transactions found by the query, empty shows all.
+	void setSearchQuery(const QString &query);
+
 	[[nodiscard]] rpl::producer<Ton::TransactionId> preloadRequests() const;
 	[[nodiscard]] rpl::producer<Ton::Transaction> viewRequests() const;
 	[[nodiscard]] rpl::producer<Ton::Transaction> decryptRequests() const;
+	[[nodiscard]] rpl::producer<int> scrollToRequests() const;
+
+	// Transactions from the local storage, newest first.
+	void mergeStored(Ton::TransactionsSlice &&data);
+	void collectChunk(not_null<HistoryChunk*> chunk) const;
 
 	[[nodiscard]] rpl::lifetime &lifetime();
 
@@ -48,20 +87,58 @@ private:
 		Ton::TransactionId top;
 		int offset = 0;
 	};
+	struct Gap {
+		Ton::TransactionId previousId;
+		int index = 0;
+	};
+	struct Month {
+		int count = 0;
+		int64 received = 0;
+		int64 sent = 0;
+		bool collapsed = false;
+	};
 
 	void setupContent(
 		rpl::producer<HistoryState> &&state,
 		rpl::producer<Ton::LoadedSlice> &&loaded);
 	void resizeToWidth(int width);
+	void refreshHeight();
+	[[nodiscard]] int countHeight(not_null<HistoryRow*> row) const;
+	[[nodiscard]] bool hiddenBySearch(not_null<HistoryRow*> row) const;
+	[[nodiscard]] bool collapsedByMonth(not_null<HistoryRow*> row) const;
+	[[nodiscard]] bool skipLayout(not_null<HistoryRow*> row) const;
+	void refreshSearch();
+	[[nodiscard]] std::vector<int> countHeights(
+		const std::vector<std::unique_ptr<HistoryRow>> &rows) const;
+	void refreshRowHeight(int index);
+	[[nodiscard]] int rowsTop() const;
+	[[nodiscard]] int rowTop(int index) const;
 	void mergeState(HistoryState &&state);
-	bool mergePendingChanged(std::vector<Ton::PendingTransaction> &&list);
 	bool mergeListChanged(Ton::TransactionsSlice &&data);
+	[[nodiscard]] bool canSpliceWithGap(
+		const Ton::TransactionsSlice &data) const;
+	void prependData(
+		std::vector<Ton::Transaction>::const_iterator from,
+		std::vector<Ton::Transaction>::const_iterator till);
+	void appendData(Ton::TransactionsSlice &&data);
+	void fillGap(Ton::LoadedSlice &&slice);
+	void insertRows(int index, int count);
 	void refreshRows();
-	void refreshPending();
+	void refreshPending(std::vector<Ton::PendingTransaction> &&wasData);
+	void refreshLayouts();
+	void preloadAround();
+	void requestSlice(const Ton::TransactionId &id);
+	void schedulePrepare(int from, int till);
+	[[nodiscard]] int findRowIndex(const Ton::TransactionId &id) const;
+	[[nodiscard]] std::pair<int, int> findRows(int top, int bottom) const;
 	void paint(Painter &p, QRect clip);
-	void repaintRow(not_null<HistoryRow*> row);
+	void paintRow(Painter &p, not_null<HistoryRow*> row, int top);
+	void clearRowCache();
+	void invalidateRowCache(not_null<HistoryRow*> row);
+	void repaintRow(int index);
 	void repaintShadow(not_null<HistoryRow*> row);
 	[[nodiscard]] ScrollState computeScrollState() const;
+	void restoreScrollState(const ScrollState &state);
 
 	void selectRow(int selected, ClickHandlerPtr handler);
 	void selectRowByMouse();
@@ -69,38 +146,89 @@ private:
 	void releaseRow();
 	void decryptById(const Ton::TransactionId &id);
 
+	void collectEncrypted(not_null<DecryptChunk*> chunk) const;
 	void computeInitTransactionId();
+	void refreshDates();
 	void refreshShowDates();
+	void refreshShowDates(int from, int till);
+	[[nodiscard]] int shownRowBefore(int index) const;
+	[[nodiscard]] int shownRowAfter(int index) const;
 	void setRowShowDate(
 		const std::unique_ptr<HistoryRow> &row,
 		bool show = true);
-	bool takeDecrypted(
-		int index,
-		const std::vector<Ton::Transaction> &decrypted);
+	void setRowShowMonth(const std::unique_ptr<HistoryRow> &row, bool show);
+	void addToMonth(const Ton::Transaction &data);
+	void refreshMonths();
+	void toggleMonth(int key);
+	[[nodiscard]] std::pair<int, int> findMonthRows(int key) const;
+	void refreshBalance(int from, int till);
+	void indexPositions(int from, int till);
+	void indexData(int from, int till);
+	void logMemoryUsage();
+	[[nodiscard]] int findDataIndex(const Ton::TransactionId &id) const;
+	bool takeDecrypted(const Ton::Transaction &decrypted);
+	void replaceRow(int index, const Ton::Transaction &data);
 	[[nodiscard]] std::unique_ptr<HistoryRow> makeRow(
 		const Ton::Transaction &data);
 
 	Ui::RpWidget _widget;
 
 	std::vector<Ton::PendingTransaction> _pendingData;
-	std::vector<Ton::Transaction> _listData;
+	TransactionStore _listData;
+	BalanceSeries _balance;
+	int64 _balanceMismatch = 0;
 	Ton::TransactionId _previousId;
 	Ton::TransactionId _initTransactionId;
+	std::vector<Gap> _gaps;
+
+	// Loaded transactions summed up by month, the oldest month first.
+	base::flat_map<int, Month> _months;
+	base::flat_set<int> _monthsChanged;
+
+	// Positions in _listData by Ton::TransactionId::lt,
+	// stored as (index + _positionsOrigin) so that prepending is cheap.
+	std::unordered_map<int64, int> _positions;
+	std::set<int64, std::greater<>> _encrypted;
+	int _positionsOrigin = 0;
+
+	Fn<bool(not_null<Ton::Transaction*>)> _restoreDecrypted;
+
+	SearchIndex _searchIndex;
+	QString _searchQuery;
+	std::unordered_set<int64> _searchResults;
+	bool _searchApplied = false;
+	bool _searchDirty = false;
 
 	std::vector<std::unique_ptr<HistoryRow>> _pendingRows;
 	std::vector<std::unique_ptr<HistoryRow>> _rows;
+	HeightIndex _pendingHeights;
+	HeightIndex _heights;
+	std::unique_ptr<HistoryRowCache> _rowCache;
+	int _width = 0;
 	int _visibleTop = 0;
 	int _visibleBottom = 0;
+	int _layoutFrom = 0;
+	int _layoutTill = 0;
+	int _dateGeneration = 0;
+	int _memoryLogged = 0;
 	int _selected = -1;
 	int _pressed = -1;
+	base::flat_set<int64> _preparing;
+	PreloadController _preload;
 
 	rpl::event_stream<Ton::TransactionId> _preloadRequests;
 	rpl::event_stream<Ton::Transaction> _viewRequests;
 	rpl::event_stream<Ton::Transaction> _decryptRequests;
+	rpl::event_stream<int> _scrollToRequests;
+	rpl::event_stream<not_null<const BalanceSeries*>> _balanceChanges;
 
 };
 
 [[nodiscard]] rpl::producer<HistoryState> MakeHistoryState(
 	rpl::producer<Ton::WalletViewerState> state);
 
+// Prepares and shapes the layout of a row the same way the history does for
+// every transaction shown, used by the benchmark.
+void PrepareRowLayout(const Ton::Transaction &data, bool canDecrypt);
+
 } // namespace Wallet
@@ -0,0 +1,300 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_history_export.h"
+
+#include "wallet/wallet_common.h"
+#include "wallet/wallet_history.h"
+#include "wallet/wallet_phrases.h"
+#include "wallet/wallet_log.h"
+#include "base/call_delayed.h"
+#include "ui/layers/generic_box.h"
+#include "ui/widgets/labels.h"
+#include "styles/style_layers.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+namespace Wallet {
+namespace {
+
+constexpr auto kChunkSize = 256;
+constexpr auto kBufferSize = 64 * 1024;
+constexpr auto kMaxFailures = 5;
+constexpr auto kRetryDelay = crl::time(1000);
+
+[[nodiscard]] QString FormatExportAmount(int64 amount) {
+	// Always with a dot and without digit groups, whatever the locale is.
+	const auto formatted = FormatAmount(amount, FormatFlag::Simple);
+	return formatted.nanoString.isEmpty()
+		? formatted.gramsString
+		: (formatted.gramsString + '.' + formatted.nanoString);
+}
+
+[[nodiscard]] QString FormatExportTime(TimeId time) {
+	return QDateTime::fromSecsSinceEpoch(
+		time,
+		Qt::UTC
+	).toString(Qt::ISODate);
+}
+
+[[nodiscard]] QString TransactionType(const Ton::Transaction &data) {
+	return IsServiceTransaction(data)
+		? "service"
+		: data.outgoing.empty()
+		? "in"
+		: "out";
+}
+
+[[nodiscard]] QByteArray EscapeCsv(const QString &value) {
+	auto result = value.toUtf8();
+
+	// Spreadsheets evaluate fields starting with a formula sign, so such
+	// text fields are marked as text. Amounts are not passed here, their
+	// leading minus is just a sign.
+	if (!result.isEmpty() && QByteArray("=+-@\t\r").contains(result[0])) {
+		result.prepend('\'');
+	}
+	const auto special = ranges::any_of(result, [](char ch) {
+		return (ch == '"') || (ch == ',') || (ch == '\n') || (ch == '\r');
+	});
+	if (special) {
+		result.replace('"', "\"\"");
+		result = '"' + result + '"';
+	}
+	return result;
+}
+
+[[nodiscard]] QByteArray SerializeCsv(const Ton::Transaction &data) {
+	const auto fields = QByteArrayList{
+		QByteArray::number(data.id.lt),
+		EscapeCsv(QString::fromLatin1(data.id.hash.toBase64())),
+		EscapeCsv(FormatExportTime(data.time)),
+		EscapeCsv(TransactionType(data)),
+		EscapeCsv(ExtractAddress(data)),
+		FormatExportAmount(CalculateValue(data)).toUtf8(),
+		FormatExportAmount(data.fee).toUtf8(),
+		FormatExportAmount(data.storageFee).toUtf8(),
+		FormatExportAmount(data.otherFee).toUtf8(),
+		EscapeCsv(ExtractMessage(data)),
+		QByteArray(IsEncryptedMessage(data) ? "1" : "0"),
+	};
+	return fields.join(',') + '\n';
+}
+
+[[nodiscard]] QByteArray SerializeJson(const Ton::Transaction &data) {
+	auto object = QJsonObject();
+	object.insert("lt", QString::number(data.id.lt));
+	object.insert("hash", QString::fromLatin1(data.id.hash.toBase64()));
+	object.insert("time", FormatExportTime(data.time));
+	object.insert("type", TransactionType(data));
+	object.insert("address", ExtractAddress(data));
+	object.insert("amount", FormatExportAmount(CalculateValue(data)));
+	object.insert("fee", FormatExportAmount(data.fee));
+	object.insert("storage_fee", FormatExportAmount(data.storageFee));
+	object.insert("other_fee", FormatExportAmount(data.otherFee));
+	object.insert("comment", ExtractMessage(data));
+	object.insert("encrypted", IsEncryptedMessage(data));
+	return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+} // namespace
+
+HistoryExporter::HistoryExporter(
+	const QString &path,
+	Format format,
+	Source &&source)
+: _path(path)
+, _format(format)
+, _source(std::move(source))
+, _file(path) {
+	std::move(
+		_source.loaded
+	) | rpl::filter([=](const Ton::Result<Ton::LoadedSlice> &result) {
+		return _waiting && (!result || result->after == _next);
+	}) | rpl::start_with_next([=](Ton::Result<Ton::LoadedSlice> &&result) {
+		if (!result) {
+			// Errors don't tell which page has failed, it may be a preload
+			// of the history itself, so the page is requested again.
+			if (_retrying) {
+				return;
+			}
+			WALLET_LOG(("History export: could not load transactions "
+				"after %1, error: %2."
+				).arg(_next.lt
+				).arg(result.error().details));
+			if (++_failures > kMaxFailures) {
+				_waiting = false;
+				finish(false);
+				return;
+			}
+			_retrying = true;
+			base::call_delayed(kRetryDelay, this, [=] {
+				if (base::take(_retrying)) {
+					_source.requestSlice(_next);
+				}
+			});
+			return;
+		}
+		_waiting = _retrying = false;
+		_failures = 0;
+		const auto &slice = *result;
+		if (!write(slice.data.list)) {
+			finish(false);
+			return;
+		}
+		_next = slice.data.previousId;
+		if (!_next.lt) {
+			finish(true);
+		} else {
+			scheduleNext();
+		}
+	}, _lifetime);
+}
+
+HistoryExporter::~HistoryExporter() {
+	if (!_done && _file.isOpen()) {
+		WALLET_LOG(("History export: cancelled after %1 transactions."
+			).arg(_exported.current()));
+		_file.remove();
+	}
+}
+
+auto HistoryExporter::FormatFromPath(const QString &path) -> Format {
+	return path.endsWith(".json", Qt::CaseInsensitive)
+		? Format::Json
+		: Format::Csv;
+}
+
+void HistoryExporter::start() {
+	Expects(!_file.isOpen() && !_done);
+
+	if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		WALLET_LOG(("History export: could not open '%1'.").arg(_path));
+		finish(false);
+		return;
+	}
+	_buffer.reserve(kBufferSize);
+	_buffer.append((_format == Format::Json)
+		? QByteArray("[\n")
+		: QByteArray("lt,hash,time,type,address,amount,"
+			"fee,storage_fee,other_fee,comment,encrypted\n"));
+	next();
+}
+
+rpl::producer<int> HistoryExporter::exportedValue() const {
+	return _exported.value();
+}
+
+rpl::producer<bool> HistoryExporter::finished() const {
+	return _finished.events();
+}
+
+rpl::lifetime &HistoryExporter::lifetime() {
+	return _lifetime;
+}
+
+void HistoryExporter::scheduleNext() {
+	// One chunk each event loop turn, so that the interface stays alive.
+	crl::on_main(this, [=] {
+		next();
+	});
+}
+
+void HistoryExporter::next() {
+	auto chunk = HistoryChunk{ _next, kChunkSize };
+	_source.collect(&chunk);
+	if (chunk.list.empty()) {
+		if (_next.lt) {
+			_waiting = true;
+			_source.requestSlice(_next);
+		} else {
+			finish(true);
+		}
+		return;
+	} else if (!write(chunk.list)) {
+		finish(false);
+		return;
+	}
+	_next = chunk.previousId;
+	if (!_next.lt) {
+		finish(true);
+	} else {
+		scheduleNext();
+	}
+}
+
+bool HistoryExporter::write(const std::vector<Ton::Transaction> &list) {
+	for (const auto &data : list) {
+		if (_format == Format::Json) {
+			if (_written > 0) {
+				_buffer.append(",\n");
+			}
+			_buffer.append(SerializeJson(data));
+		} else {
+			_buffer.append(SerializeCsv(data));
+		}
+		++_written;
+		if (_buffer.size() >= kBufferSize && !flush()) {
+			return false;
+		}
+	}
+	_exported = _written;
+	return true;
+}
+
+bool HistoryExporter::flush() {
+	const auto size = _buffer.size();
+	const auto written = size ? _file.write(_buffer) : 0;
+	_buffer.resize(0);
+	if (written != size) {
+		WALLET_LOG(("History export: could not write to '%1'.").arg(_path));
+		return false;
+	}
+	return true;
+}
+
+void HistoryExporter::finish(bool success) {
+	Expects(!_done);
+
+	_done = true;
+	if (success && _file.isOpen()) {
+		if (_format == Format::Json) {
+			_buffer.append(_written ? "\n]\n" : "]\n");
+		}
+		success = flush() && _file.flush();
+	}
+	if (success) {
+		_file.close();
+		WALLET_LOG(("History export: %1 transactions written."
+			).arg(_written));
+	} else {
+		_file.remove();
+	}
+	_finished.fire_copy(success);
+}
+
+void ExportHistoryBox(
+		not_null<Ui::GenericBox*> box,
+		rpl::producer<int> exported) {
+	box->setTitle(ph::lng_wallet_export_history_title());
+	box->setCloseByOutsideClick(false);
+
+	box->addRow(object_ptr<Ui::FlatLabel>(
+		box,
+		rpl::combine(
+			ph::lng_wallet_export_history_progress(),
+			std::move(exported)
+		) | rpl::map([](QString &&text, int count) {
+			return text.replace("{count}", QString::number(count));
+		}),
+		st::boxLabel));
+
+	box->addButton(ph::lng_wallet_cancel(), [=] { box->closeBox(); });
+}
+
+} // namespace Wallet
@@ -0,0 +1,83 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+#include "ton/ton_result.h"
+#include "base/weak_ptr.h"
+
+#include <QtCore/QFile>
+
+namespace Ui {
+class GenericBox;
+} // namespace Ui
+
+namespace Wallet {
+
+struct HistoryChunk;
+
+// Writes the whole transactions history of an account to a file.
+//
+// Transactions are taken in chunks from the loaded history and the missing
+// ones are requested page by page, so only one chunk is kept in memory.
+// A page that fails to load is requested again a few times before the
+// export finishes with a failure.
+// Rows are written through a small buffer, one chunk each event loop turn.
+class HistoryExporter final : public base::has_weak_ptr {
+public:
+	enum class Format {
+		Csv,
+		Json,
+	};
+	struct Source {
+		Fn<void(not_null<HistoryChunk*>)> collect;
+		Fn<void(Ton::TransactionId)> requestSlice;
+		rpl::producer<Ton::Result<Ton::LoadedSlice>> loaded;
+	};
+
+	HistoryExporter(const QString &path, Format format, Source &&source);
+	~HistoryExporter();
+
+	[[nodiscard]] static Format FormatFromPath(const QString &path);
+
+	void start();
+
+	[[nodiscard]] rpl::producer<int> exportedValue() const;
+	[[nodiscard]] rpl::producer<bool> finished() const;
+
+	[[nodiscard]] rpl::lifetime &lifetime();
+
+private:
+	void scheduleNext();
+	void next();
+	[[nodiscard]] bool write(const std::vector<Ton::Transaction> &list);
+	[[nodiscard]] bool flush();
+	void finish(bool success);
+
+	const QString _path;
+	const Format _format = Format::Csv;
+	Source _source;
+	QFile _file;
+	QByteArray _buffer;
+	Ton::TransactionId _next;
+	int _written = 0;
+	rpl::variable<int> _exported = 0;
+	rpl::event_stream<bool> _finished;
+	int _failures = 0;
+	bool _waiting = false;
+	bool _retrying = false;
+	bool _done = false;
+
+	rpl::lifetime _lifetime;
+
+};
+
+void ExportHistoryBox(
+	not_null<Ui::GenericBox*> box,
+	rpl::producer<int> exported);
+
+} // namespace Wallet
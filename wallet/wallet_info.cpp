@@ -11,11 +11,13 @@
 #include "wallet/wallet_cover.h"
 #include "wallet/wallet_empty_history.h"
 #include "wallet/wallet_history.h"
+#include "wallet/wallet_phrases.h"
 #include "ui/rp_widget.h"
 #include "ui/lottie_widget.h"
 #include "ui/widgets/labels.h"
 #include "ui/widgets/scroll_area.h"
 #include "ui/widgets/buttons.h"
+#include "ui/widgets/input_fields.h"
 #include "ui/text/text_utilities.h"
 #include "styles/style_wallet.h"
 
@@ -38,10 +40,18 @@ void Info::setGeometry(QRect geometry) {
 	_widget->setGeometry(geometry);
 }
 
+void Info::setVisible(bool visible) {
+	_widget->setVisible(visible);
+}
+
 rpl::producer<Action> Info::actionRequests() const {
 	return _actionRequests.events();
 }
 
+rpl::producer<int> Info::switchRequests() const {
+	return _switchRequests.events();
+}
+
 rpl::producer<Ton::TransactionId> Info::preloadRequests() const {
 	return _preloadRequests.events();
 }
@@ -61,9 +71,12 @@ void Info::setupControls(Data &&data) {
 		MakeTopBarState(
 			rpl::duplicate(state),
 			rpl::duplicate(data.updates),
-			_widget->lifetime()));
+			_widget->lifetime()),
+		std::move(data.accounts));
 	topBar->actionRequests(
 	) | rpl::start_to_stream(_actionRequests, topBar->lifetime());
+	topBar->switchRequests(
+	) | rpl::start_to_stream(_switchRequests, topBar->lifetime());
 
 	const auto cover = _widget->lifetime().make_state<Cover>(
 		_inner.get(),
@@ -89,6 +102,27 @@ void Info::setupControls(Data &&data) {
 		std::move(loaded),
 		std::move(data.collectEncrypted),
 		std::move(data.updateDecrypted));
+	history->setRowCacheLimit(data.historyCacheLimit);
+	cover->setBalanceChart(history->balanceChanges());
+	history->setRestoreDecrypted(std::move(data.restoreDecrypted));
+	std::move(
+		data.stored
+	) | rpl::start_with_next([=](Ton::TransactionsSlice &&slice) {
+		history->mergeStored(std::move(slice));
+	}, history->lifetime());
+	std::move(
+		data.collectHistory
+	) | rpl::start_with_next([=](not_null<HistoryChunk*> chunk) {
+		history->collectChunk(chunk);
+	}, history->lifetime());
+	const auto search = Ui::CreateChild<Ui::InputField>(
+		_inner.get(),
+		st::walletSearchInput,
+		Ui::InputField::Mode::SingleLine,
+		ph::lng_wallet_search_placeholder());
+	Ui::Connect(search, &Ui::InputField::changed, [=] {
+		history->setSearchQuery(search->getLastText());
+	});
 	const auto emptyHistory = _widget->lifetime().make_state<EmptyHistory>(
 		_inner.get(),
 		MakeEmptyHistoryState(rpl::duplicate(state), data.justCreated),
@@ -110,7 +144,17 @@ void Info::setupControls(Data &&data) {
 			st::walletCoverHeight,
 			size.width(),
 			size.height() - st::walletCoverHeight);
-		history->updateGeometry({ 0, st::walletCoverHeight }, size.width());
+		const auto padding = st::walletSearchPadding;
+		const auto searchWidth = std::min(size.width(), st::walletRowWidthMax)
+			- padding.left()
+			- padding.right();
+		search->resize(searchWidth, search->height());
+		search->moveToLeft(
+			(size.width() - searchWidth) / 2,
+			st::walletCoverHeight + padding.top());
+		history->updateGeometry(
+			{ 0, st::walletCoverHeight + st::walletSearchHeight },
+			size.width());
 		emptyHistory->setGeometry(contentGeometry);
 	}, cover->lifetime());
 
@@ -118,10 +162,12 @@ void Info::setupControls(Data &&data) {
 		_scroll->sizeValue(),
 		history->heightValue()
 	) | rpl::start_with_next([=](QSize size, int height) {
+		const auto searchHeight = height ? st::walletSearchHeight : 0;
 		const auto innerHeight = std::max(
 			size.height(),
-			cover->height() + height);
+			cover->height() + searchHeight + height);
 		_inner->setGeometry({ 0, 0, size.width(), innerHeight });
+		search->setVisible(height > 0);
 		emptyHistory->setVisible(height == 0);
 	}, _inner->lifetime());
 
@@ -132,6 +178,11 @@ void Info::setupControls(Data &&data) {
 		history->setVisibleTopBottom(scrollTop, scrollTop + scrollHeight);
 	}, history->lifetime());
 
+	history->scrollToRequests(
+	) | rpl::start_with_next([=](int top) {
+		_scroll->scrollToY(top);
+	}, history->lifetime());
+
 	history->preloadRequests(
 	) | rpl::start_to_stream(_preloadRequests, history->lifetime());
 
@@ -8,6 +8,7 @@
 
 #include "ton/ton_state.h"
 #include "ton/ton_result.h"
+#include "wallet/wallet_top_bar.h"
 
 namespace Ui {
 class RpWidget;
@@ -17,18 +18,24 @@ class ScrollArea;
 namespace Wallet {
 
 enum class Action;
+struct DecryptChunk;
+struct HistoryChunk;
 
 class Info final {
 public:
 	struct Data {
 		rpl::producer<Ton::WalletViewerState> state;
 		rpl::producer<Ton::Result<Ton::LoadedSlice>> loaded;
+		rpl::producer<Ton::TransactionsSlice> stored;
 		rpl::producer<Ton::Update> updates;
-		rpl::producer<
-			not_null<std::vector<Ton::Transaction>*>> collectEncrypted;
+		rpl::producer<not_null<DecryptChunk*>> collectEncrypted;
 		rpl::producer<
 			not_null<const std::vector<Ton::Transaction>*>> updateDecrypted;
+		rpl::producer<not_null<HistoryChunk*>> collectHistory;
+		rpl::producer<TopBarAccounts> accounts;
+		Fn<bool(not_null<Ton::Transaction*>)> restoreDecrypted;
 		Fn<void(QImage, QString)> share;
+		int64 historyCacheLimit = 0;
 		bool justCreated = false;
 		bool useTestNetwork = false;
 	};
@@ -36,8 +43,10 @@ public:
 	~Info();
 
 	void setGeometry(QRect geometry);
+	void setVisible(bool visible);
 
 	[[nodiscard]] rpl::producer<Action> actionRequests() const;
+	[[nodiscard]] rpl::producer<int> switchRequests() const;
 	[[nodiscard]] rpl::producer<Ton::TransactionId> preloadRequests() const;
 	[[nodiscard]] rpl::producer<Ton::Transaction> viewRequests() const;
 	[[nodiscard]] rpl::producer<Ton::Transaction> decryptRequests() const;
@@ -52,6 +61,7 @@ private:
 	const not_null<Ui::RpWidget*> _inner;
 
 	rpl::event_stream<Action> _actionRequests;
+	rpl::event_stream<int> _switchRequests;
 	rpl::event_stream<Ton::TransactionId> _preloadRequests;
 	rpl::event_stream<Ton::Transaction> _viewRequests;
 	rpl::event_stream<Ton::Transaction> _decryptRequests;
@@ -0,0 +1,481 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_local_history.h"
+
+#include "wallet/wallet_log.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <crl/crl_async.h>
+
+namespace Wallet {
+namespace {
+
+constexpr auto kMagic = quint32(0x484C5754);
+constexpr auto kVersion = qint32(2);
+constexpr auto kHeaderSize = qint64(8);
+constexpr auto kRecordHeaderSize = qint64(24);
+constexpr auto kSliceRecord = qint32(1);
+constexpr auto kStreamVersion = QDataStream::Qt_5_1;
+constexpr auto kSliceLimit = 100;
+
+struct Record {
+	std::vector<Ton::Transaction> list;
+	Ton::TransactionId previousId;
+};
+
+void Write(QDataStream &stream, const Ton::TransactionId &id) {
+	stream << qint64(id.lt) << id.hash;
+}
+
+void Write(QDataStream &stream, const Ton::Message &message) {
+	// Decrypted comments never get to the disk, only the encrypted ones.
+	const auto &data = message.message;
+	stream
+		<< message.source
+		<< message.destination
+		<< qint64(message.value)
+		<< qint32(message.created)
+		<< message.bodyHash
+		<< (data.decrypted ? QString() : data.text)
+		<< data.encrypted;
+}
+
+void Write(QDataStream &stream, const Ton::Transaction &transaction) {
+	Write(stream, transaction.id);
+	stream
+		<< qint32(transaction.time)
+		<< qint64(transaction.fee)
+		<< qint64(transaction.storageFee)
+		<< qint64(transaction.otherFee);
+	Write(stream, transaction.incoming);
+	stream << qint32(transaction.outgoing.size());
+	for (const auto &message : transaction.outgoing) {
+		Write(stream, message);
+	}
+}
+
+void Read(QDataStream &stream, Ton::TransactionId &id) {
+	auto lt = qint64();
+	stream >> lt >> id.hash;
+	id.lt = lt;
+}
+
+void Read(QDataStream &stream, Ton::Message &message) {
+	auto value = qint64();
+	auto created = qint32();
+	stream
+		>> message.source
+		>> message.destination
+		>> value
+		>> created
+		>> message.bodyHash
+		>> message.message.text
+		>> message.message.encrypted;
+	message.value = value;
+	message.created = created;
+}
+
+void Read(QDataStream &stream, Ton::Transaction &transaction) {
+	auto time = qint32();
+	auto fee = qint64();
+	auto storageFee = qint64();
+	auto otherFee = qint64();
+	auto outgoing = qint32();
+	Read(stream, transaction.id);
+	stream >> time >> fee >> storageFee >> otherFee;
+	Read(stream, transaction.incoming);
+	stream >> outgoing;
+	if (stream.status() != QDataStream::Ok || outgoing < 0) {
+		stream.setStatus(QDataStream::ReadCorruptData);
+		return;
+	}
+	transaction.time = time;
+	transaction.fee = fee;
+	transaction.storageFee = storageFee;
+	transaction.otherFee = otherFee;
+	transaction.outgoing.resize(outgoing);
+	for (auto &message : transaction.outgoing) {
+		Read(stream, message);
+	}
+}
+
+[[nodiscard]] QByteArray SerializeRecord(
+		const std::vector<Ton::Transaction> &list,
+		const Ton::TransactionId &previousId) {
+	auto result = QByteArray();
+	{
+		auto stream = QDataStream(&result, QIODevice::WriteOnly);
+		stream.setVersion(kStreamVersion);
+		Write(stream, previousId);
+		stream << qint32(list.size());
+		for (const auto &transaction : list) {
+			Write(stream, transaction);
+		}
+	}
+	return result;
+}
+
+[[nodiscard]] std::optional<Record> DeserializeRecord(
+		const QByteArray &bytes) {
+	auto stream = QDataStream(bytes);
+	stream.setVersion(kStreamVersion);
+
+	auto result = Record();
+	auto count = qint32();
+	Read(stream, result.previousId);
+	stream >> count;
+	if (stream.status() != QDataStream::Ok || count <= 0) {
+		return std::nullopt;
+	}
+	result.list.resize(count);
+	for (auto &transaction : result.list) {
+		Read(stream, transaction);
+	}
+	if (stream.status() != QDataStream::Ok) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+// The bytes are mapped when possible, they're valid while the file is open.
+[[nodiscard]] QByteArray MapBytes(QFile &file, qint64 offset, qint64 size) {
+	if (const auto data = file.map(offset, size)) {
+		return QByteArray::fromRawData(
+			reinterpret_cast<const char*>(data),
+			int(size));
+	} else if (!file.seek(offset)) {
+		return QByteArray();
+	}
+	return file.read(size);
+}
+
+[[nodiscard]] std::optional<Record> ReadRecord(
+		const QByteArray &bytes,
+		qint64 offset,
+		qint64 length) {
+	const auto from = offset + kRecordHeaderSize;
+	return (from + length <= bytes.size())
+		? DeserializeRecord(QByteArray::fromRawData(
+			bytes.constData() + from,
+			int(length)))
+		: std::nullopt;
+}
+
+} // namespace
+
+struct LocalHistory::Loaded {
+	std::vector<Ton::TransactionsSlice> slices;
+	Entries entries;
+	qint64 validSize = 0;
+};
+
+LocalHistory::LocalHistory(const QString &path) : _path(path) {
+}
+
+LocalHistory::~LocalHistory() = default;
+
+QString LocalHistory::ComputePath(
+		const QString &folder,
+		const QString &address,
+		bool useTestNetwork) {
+	const auto hash = QCryptographicHash::hash(
+		address.toUtf8(),
+		QCryptographicHash::Sha256).toHex().left(32);
+	return folder
+		+ '/'
+		+ (useTestNetwork ? "history_test_" : "history_")
+		+ QString::fromLatin1(hash);
+}
+
+void LocalHistory::load(
+		Fn<void(std::vector<Ton::TransactionsSlice>)> done) {
+	Expects(!_loading && !_ready);
+
+	_loading = true;
+	_loadedCallback = std::move(done);
+	const auto ready = crl::guard(this, [=](Loaded result) {
+		loaded(std::move(result));
+	});
+	crl::async([=, path = _path] {
+		crl::on_main([=, result = ReadFile(path)]() mutable {
+			ready(std::move(result));
+		});
+	});
+}
+
+void LocalHistory::read(
+		const Ton::TransactionId &after,
+		Fn<void(std::optional<Ton::LoadedSlice>)> done) {
+	const auto entry = _ready ? FindEntry(_entries, after.lt) : nullptr;
+	if (!entry) {
+		done(std::nullopt);
+		return;
+	}
+	const auto ready = crl::guard(this, [=](
+			std::optional<Ton::TransactionsSlice> slice) {
+		if (!slice) {
+			done(std::nullopt);
+			return;
+		}
+		auto result = Ton::LoadedSlice();
+		result.after = after;
+		result.data = std::move(*slice);
+		done(std::move(result));
+	});
+	crl::async([=, path = _path, entry = *entry] {
+		auto file = QFile(path);
+		auto slice = std::optional<Ton::TransactionsSlice>();
+		if (file.open(QIODevice::ReadOnly)) {
+			// Only the pages of the record itself are read from the disk.
+			const auto till = entry.offset + kRecordHeaderSize + entry.length;
+			slice = ReadEntry(
+				MapBytes(file, 0, till),
+				entry,
+				after,
+				kSliceLimit);
+		}
+		crl::on_main([=, slice = std::move(slice)]() mutable {
+			ready(std::move(slice));
+		});
+	});
+}
+
+auto LocalHistory::ReadFile(const QString &path) -> Loaded {
+	auto result = Loaded();
+	auto file = QFile(path);
+	if (!file.open(QIODevice::ReadOnly) || file.size() < kHeaderSize) {
+		return result;
+	}
+	const auto size = file.size();
+	const auto bytes = MapBytes(file, 0, size);
+	if (bytes.size() != size) {
+		return result;
+	}
+	auto stream = QDataStream(bytes);
+	stream.setVersion(kStreamVersion);
+
+	// Only the headers and the previous ids are read here, the records
+	// themselves are read by offset when they're needed.
+	auto magic = quint32();
+	auto version = qint32();
+	stream >> magic >> version;
+	if (magic != kMagic || version != kVersion) {
+		return result;
+	}
+	auto offset = kHeaderSize;
+	while (offset + kRecordHeaderSize <= size) {
+		auto type = qint32();
+		auto headLt = qint64();
+		auto tailLt = qint64();
+		auto length = quint32();
+		stream >> type >> headLt >> tailLt >> length;
+		const auto till = offset + kRecordHeaderSize + qint64(length);
+		if (stream.status() != QDataStream::Ok
+			|| type != kSliceRecord
+			|| tailLt > headLt
+			|| till > size) {
+			break;
+		}
+		auto entry = Entry();
+		Read(stream, entry.previousId);
+		if (stream.status() != QDataStream::Ok
+			|| stream.device()->pos() > till) {
+			break;
+		}
+		entry.tailLt = tailLt;
+		entry.offset = offset;
+		entry.length = length;
+		result.entries.emplace(headLt, std::move(entry));
+		offset = till;
+		if (!stream.device()->seek(offset)) {
+			break;
+		}
+	}
+	result.validSize = offset;
+	if (result.entries.empty()) {
+		return result;
+	}
+
+	// Follow the chain of previous ids from the newest transaction. If it
+	// breaks before the end of the history, continue from the newest stored
+	// record older than the missing transaction.
+	auto from = Ton::TransactionId();
+	from.lt = result.entries.rbegin()->first;
+	auto left = kSliceLimit;
+	while (left > 0) {
+		auto slice = Ton::TransactionsSlice();
+		while (left > 0) {
+			const auto entry = FindEntry(result.entries, from.lt);
+			auto part = entry
+				? ReadEntry(bytes, *entry, from, left)
+				: std::nullopt;
+			if (!part) {
+				break;
+			}
+			left -= int(part->list.size());
+			slice.list.insert(
+				end(slice.list),
+				std::make_move_iterator(begin(part->list)),
+				std::make_move_iterator(end(part->list)));
+			slice.previousId = from = part->previousId;
+			if (!from.lt) {
+				break;
+			}
+		}
+		if (slice.list.empty()) {
+			break;
+		}
+		result.slices.push_back(std::move(slice));
+		if (!left || !from.lt || FindEntry(result.entries, from.lt)) {
+			break;
+		}
+		const auto older = result.entries.lower_bound(from.lt);
+		if (older == begin(result.entries)) {
+			break;
+		}
+		from = Ton::TransactionId();
+		from.lt = std::prev(older)->first;
+	}
+	return result;
+}
+
+auto LocalHistory::FindEntry(const Entries &entries, int64 lt)
+-> const Entry* {
+	const auto i = entries.lower_bound(lt);
+	return (i != end(entries) && i->second.tailLt <= lt)
+		? &i->second
+		: nullptr;
+}
+
+std::optional<Ton::TransactionsSlice> LocalHistory::ReadEntry(
+		const QByteArray &bytes,
+		const Entry &entry,
+		const Ton::TransactionId &after,
+		int limit) {
+	auto record = ReadRecord(bytes, entry.offset, entry.length);
+	if (!record || record->list.back().id.lt != entry.tailLt) {
+		return std::nullopt;
+	}
+
+	// The heads of the records are looked up only by their lt.
+	auto &list = record->list;
+	const auto from = ranges::find_if(list, [&](
+			const Ton::Transaction &transaction) {
+		return (transaction.id.lt == after.lt)
+			&& (after.hash.isEmpty() || transaction.id == after);
+	});
+	if (from == end(list)) {
+		return std::nullopt;
+	}
+	const auto till = from + std::min(int(end(list) - from), limit);
+	auto result = Ton::TransactionsSlice();
+	result.previousId = (till != end(list)) ? till->id : record->previousId;
+	result.list.insert(
+		end(result.list),
+		std::make_move_iterator(from),
+		std::make_move_iterator(till));
+	return result;
+}
+
+void LocalHistory::loaded(Loaded &&result) {
+	_loading = false;
+	_entries = std::move(result.entries);
+
+	QDir().mkpath(QFileInfo(_path).absolutePath());
+	_file.setFileName(_path);
+	if (_file.open(QIODevice::ReadWrite)) {
+		if (result.validSize < kHeaderSize) {
+			_entries.clear();
+			_file.resize(0);
+			auto stream = QDataStream(&_file);
+			stream.setVersion(kStreamVersion);
+			stream << kMagic << kVersion;
+		} else if (_file.size() != result.validSize) {
+			WALLET_LOG(("Local history: truncating a broken tail, "
+				"%1 bytes of %2 are valid."
+				).arg(result.validSize
+				).arg(_file.size()));
+			_file.resize(result.validSize);
+		}
+		_file.seek(_file.size());
+		_ready = true;
+	} else {
+		WALLET_LOG(("Local history: could not open '%1'.").arg(_path));
+	}
+
+	if (const auto callback = base::take(_loadedCallback)) {
+		callback(std::move(result.slices));
+	}
+	for (const auto &slice : base::take(_savesWhileLoading)) {
+		save(slice);
+	}
+}
+
+void LocalHistory::save(const Ton::TransactionsSlice &slice) {
+	if (_loading) {
+		_savesWhileLoading.push_back(slice);
+		return;
+	} else if (!_ready) {
+		return;
+	}
+	const auto known = ranges::find_if(slice.list, [&](
+			const Ton::Transaction &transaction) {
+		return (FindEntry(_entries, transaction.id.lt) != nullptr);
+	});
+	if (known == begin(slice.list)) {
+		return;
+	}
+	write(
+		std::vector<Ton::Transaction>(begin(slice.list), known),
+		(known != end(slice.list)) ? known->id : slice.previousId);
+}
+
+void LocalHistory::write(
+		const std::vector<Ton::Transaction> &list,
+		const Ton::TransactionId &previousId) {
+	Expects(!list.empty());
+
+	const auto payload = SerializeRecord(list, previousId);
+	auto header = QByteArray();
+	{
+		auto stream = QDataStream(&header, QIODevice::WriteOnly);
+		stream.setVersion(kStreamVersion);
+		stream
+			<< kSliceRecord
+			<< qint64(list.front().id.lt)
+			<< qint64(list.back().id.lt)
+			<< quint32(payload.size());
+	}
+	const auto offset = _file.pos();
+	if (_file.write(header) != header.size()
+		|| _file.write(payload) != payload.size()
+		|| !_file.flush()) {
+		WALLET_LOG(("Local history: could not write to '%1'.").arg(_path));
+		_file.close();
+		_ready = false;
+		return;
+	}
+	auto entry = Entry();
+	entry.tailLt = list.back().id.lt;
+	entry.offset = offset;
+	entry.length = payload.size();
+	entry.previousId = previousId;
+	_entries.emplace(list.front().id.lt, std::move(entry));
+}
+
+void LocalHistory::remove() {
+	_file.close();
+	QFile::remove(_path);
+	_entries.clear();
+	_savesWhileLoading.clear();
+	_ready = false;
+}
+
+} // namespace Wallet
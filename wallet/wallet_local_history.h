@@ -0,0 +1,85 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+#include "base/weak_ptr.h"
+
+#include <QtCore/QFile>
+#include <map>
+
+namespace Wallet {
+
+// Append-only file with transactions of one account, stored as they were
+// received from the network, so that the history is shown at once.
+//
+// Each record holds a contiguous run of transactions and the id of the
+// transaction preceding the last of them. Loading maps the file and reads
+// only the record headers and the newest records, the older ones are mapped
+// by offset when the history asks for them.
+//
+// A newer slice that doesn't reach the stored transactions still links to
+// its own previous id, so loading continues from the newest stored record
+// older than that id and the history loads the missing part between them.
+class LocalHistory final : public base::has_weak_ptr {
+public:
+	explicit LocalHistory(const QString &path);
+	~LocalHistory();
+
+	[[nodiscard]] static QString ComputePath(
+		const QString &folder,
+		const QString &address,
+		bool useTestNetwork);
+
+	// The newest stored slices, newest first, with gaps between them.
+	void load(Fn<void(std::vector<Ton::TransactionsSlice>)> done);
+
+	// Calls 'done' with std::nullopt if 'after' is not stored.
+	void read(
+		const Ton::TransactionId &after,
+		Fn<void(std::optional<Ton::LoadedSlice>)> done);
+
+	void save(const Ton::TransactionsSlice &slice);
+	void remove();
+
+private:
+	struct Entry {
+		int64 tailLt = 0;
+		qint64 offset = 0;
+		qint64 length = 0;
+		Ton::TransactionId previousId;
+	};
+
+	// By the lt of the newest transaction in the record.
+	using Entries = std::map<int64, Entry>;
+	struct Loaded;
+
+	[[nodiscard]] static Loaded ReadFile(const QString &path);
+	[[nodiscard]] static const Entry *FindEntry(
+		const Entries &entries,
+		int64 lt);
+	[[nodiscard]] static std::optional<Ton::TransactionsSlice> ReadEntry(
+		const QByteArray &bytes,
+		const Entry &entry,
+		const Ton::TransactionId &after,
+		int limit);
+	void loaded(Loaded &&result);
+	void write(
+		const std::vector<Ton::Transaction> &list,
+		const Ton::TransactionId &previousId);
+
+	const QString _path;
+	QFile _file;
+	Entries _entries;
+	std::vector<Ton::TransactionsSlice> _savesWhileLoading;
+	Fn<void(std::vector<Ton::TransactionsSlice>)> _loadedCallback;
+	bool _loading = false;
+	bool _ready = false;
+
+};
+
+} // namespace Wallet
@@ -0,0 +1,765 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_payout.h"
+
+#include "wallet/wallet_phrases.h"
+#include "wallet/wallet_send_grams.h"
+#include "wallet/wallet_log.h"
+#include "ton/ton_wallet.h"
+#include "ui/layers/generic_box.h"
+#include "ui/widgets/labels.h"
+#include "styles/style_layers.h"
+#include "styles/style_wallet.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+
+namespace Wallet {
+namespace {
+
+constexpr auto kMaxChecksInFlight = 4;
+constexpr auto kShownErrors = 5;
+constexpr auto kMagic = quint32(0x50595754);
+constexpr auto kVersion = qint32(2);
+constexpr auto kLinesVersion = qint32(1);
+constexpr auto kHeaderSize = qint64(8);
+constexpr auto kStreamVersion = QDataStream::Qt_5_1;
+
+using Reason = PayoutError::Reason;
+using Status = Payout::Status;
+
+enum class RecordType : qint32 {
+	Accepted = 1,
+	Confirmed = 2,
+	Expired = 3,
+};
+
+struct Record {
+	int line = 0;
+	QStringList fields;
+};
+
+[[nodiscard]] QChar DetectSeparator(const QString &text) {
+	// Spreadsheets in locales with a decimal comma save with semicolons.
+	const auto firstLine = text.midRef(0, text.indexOf('\n'));
+	return (firstLine.contains(';') && !firstLine.contains(','))
+		? QChar(';')
+		: QChar(',');
+}
+
+[[nodiscard]] std::vector<Record> ReadRecords(const QString &text) {
+	const auto separator = DetectSeparator(text);
+	auto result = std::vector<Record>();
+	auto line = 1;
+	auto record = Record{ line };
+	auto field = QString();
+	auto quoted = false;
+	auto empty = true;
+	const auto finishRecord = [&] {
+		record.fields.push_back(base::take(field));
+		if (!empty) {
+			result.push_back(std::move(record));
+		}
+		record = Record{ line };
+		empty = true;
+	};
+	for (auto i = 0, size = text.size(); i != size; ++i) {
+		const auto ch = text[i];
+		if (quoted) {
+			if (ch != '"') {
+				line += (ch == '\n') ? 1 : 0;
+				field.append(ch);
+			} else if (i + 1 < size && text[i + 1] == '"') {
+				field.append(ch);
+				++i;
+			} else {
+				quoted = false;
+			}
+		} else if (ch == '"') {
+			quoted = empty = false;
+		} else if (ch == separator) {
+			record.fields.push_back(base::take(field));
+			empty = false;
+		} else if (ch == '\n') {
+			++line;
+			finishRecord();
+		} else if (ch != '\r') {
+			field.append(ch);
+			empty = empty && ch.isSpace();
+		}
+	}
+	finishRecord();
+	return result;
+}
+
+[[nodiscard]] bool IsHeader(const Record &record) {
+	// A row with a wrong address but a valid amount is reported instead.
+	const auto &fields = record.fields;
+	return !Ton::Wallet::CheckAddress(fields.front().trimmed())
+		&& (fields.size() < 2 || !ParseAmountString(fields[1]));
+}
+
+[[nodiscard]] std::optional<Reason> ParseRow(
+		const Record &record,
+		not_null<PayoutRow*> row) {
+	const auto &fields = record.fields;
+	if (fields.size() < 2 || fields.size() > 3) {
+		return Reason::Format;
+	}
+	row->line = record.line;
+	row->invoice.address = fields[0].trimmed();
+	row->invoice.comment = (fields.size() > 2) ? fields[2] : QString();
+	const auto amount = ParseAmountString(fields[1]);
+	if (!Ton::Wallet::CheckAddress(row->invoice.address)) {
+		return Reason::Address;
+	} else if (!amount || *amount <= 0) {
+		return Reason::Amount;
+	} else if (row->invoice.comment.toUtf8().size() > kMaxCommentLength) {
+		return Reason::Comment;
+	}
+	row->invoice.amount = *amount;
+	return std::nullopt;
+}
+
+[[nodiscard]] Reason ReasonFromError(const Ton::Error &error) {
+	if (const auto field = ErrorInvoiceField(error)) {
+		switch (*field) {
+		case InvoiceField::Address: return Reason::Address;
+		case InvoiceField::Amount: return Reason::Amount;
+		case InvoiceField::Comment: return Reason::Comment;
+		}
+	}
+	return Reason::Check;
+}
+
+[[nodiscard]] QString ErrorText(const PayoutError &error) {
+	const auto text = [&] {
+		switch (error.reason) {
+		case Reason::Format:
+			return ph::lng_wallet_payout_error_format(ph::now);
+		case Reason::Address:
+			return ph::lng_wallet_payout_error_address(ph::now);
+		case Reason::Amount:
+			return ph::lng_wallet_payout_error_amount(ph::now);
+		case Reason::Comment:
+			return ph::lng_wallet_payout_error_comment(ph::now);
+		case Reason::Check:
+			return ph::lng_wallet_payout_error_check(ph::now);
+		}
+		Unexpected("Reason in Wallet::ErrorText.");
+	}();
+	return QString(text).replace("{line}", QString::number(error.line));
+}
+
+[[nodiscard]] QString GramsText(const QString &phrase, int64 amount) {
+	return QString(phrase).replace(
+		"{grams}",
+		ph::lng_wallet_grams_count(FormatAmount(amount).full)(ph::now));
+}
+
+struct BoxState {
+	Payout::State payout;
+	int64 balance = Ton::kUnknownBalance;
+};
+
+[[nodiscard]] bool Enough(const BoxState &state) {
+	return (state.balance != Ton::kUnknownBalance)
+		&& (state.payout.amount + state.payout.fees <= state.balance);
+}
+
+[[nodiscard]] QString SummaryText(const BoxState &state) {
+	const auto &payout = state.payout;
+	auto lines = QStringList();
+	lines.push_back(ph::lng_wallet_payout_recipients(ph::now).replace(
+		"{count}",
+		QString::number(payout.count)));
+	if (payout.sent > 0) {
+		lines.push_back(ph::lng_wallet_payout_resumed(ph::now).replace(
+			"{count}",
+			QString::number(payout.sent)));
+	}
+	lines.push_back(GramsText(
+		ph::lng_wallet_payout_amount(ph::now),
+		payout.amount));
+	if (payout.status == Status::Estimating) {
+		lines.push_back(ph::lng_wallet_payout_estimating(ph::now).replace(
+			"{ready}",
+			QString::number(payout.estimated)
+		).replace(
+			"{total}",
+			QString::number(payout.count - payout.sent)));
+	} else {
+		lines.push_back(GramsText(
+			ph::lng_wallet_payout_fees(ph::now),
+			payout.fees));
+		lines.push_back(GramsText(
+			ph::lng_wallet_payout_total(ph::now),
+			payout.amount + payout.fees));
+	}
+	if (state.balance != Ton::kUnknownBalance) {
+		lines.push_back(GramsText(
+			ph::lng_wallet_payout_available(ph::now),
+			state.balance));
+	}
+	return lines.join('\n');
+}
+
+[[nodiscard]] QString StatusText(const BoxState &state) {
+	const auto &payout = state.payout;
+	auto lines = QStringList();
+	const auto errors = int(payout.errors.size());
+	const auto shown = std::min(errors, kShownErrors);
+	for (auto i = 0; i != shown; ++i) {
+		lines.push_back(ErrorText(payout.errors[i]));
+	}
+	if (errors > shown) {
+		lines.push_back(ph::lng_wallet_payout_errors_more(ph::now).replace(
+			"{count}",
+			QString::number(errors - shown)));
+	}
+	if (payout.status == Status::Ready && !Enough(state)) {
+		lines.push_back(ph::lng_wallet_payout_not_enough(ph::now));
+	}
+	if (payout.unencrypted > 0) {
+		lines.push_back(ph::lng_wallet_payout_unencrypted(ph::now).replace(
+			"{count}",
+			QString::number(payout.unencrypted)));
+	}
+	if (payout.status == Status::Sending || payout.status == Status::Paused) {
+		lines.push_back(ph::lng_wallet_payout_progress(ph::now).replace(
+			"{sent}",
+			QString::number(payout.sent)
+		).replace(
+			"{total}",
+			QString::number(payout.count)));
+	}
+	const auto line = QString::number(payout.failedLine);
+	if (payout.sendError) {
+		const auto error = IsIncorrectPasswordError(*payout.sendError)
+			? ph::lng_wallet_passcode_incorrect(ph::now)
+			: payout.sendError->details;
+		lines.push_back(ph::lng_wallet_payout_send_failed(ph::now).replace(
+			"{line}",
+			line
+		).replace("{error}", error));
+	} else if (payout.unconfirmed) {
+		lines.push_back(ph::lng_wallet_payout_unconfirmed(ph::now).replace(
+			"{line}",
+			line));
+	}
+	if (payout.status == Status::Finished) {
+		lines.push_back(ph::lng_wallet_payout_finished(ph::now));
+	}
+	return lines.join('\n');
+}
+
+[[nodiscard]] QString ButtonText(const BoxState &state) {
+	switch (state.payout.status) {
+	case Status::Estimating:
+	case Status::Ready: return ph::lng_wallet_payout_send(ph::now);
+	case Status::Sending: return ph::lng_wallet_payout_pause(ph::now);
+	case Status::Paused: return ph::lng_wallet_continue(ph::now);
+	case Status::Finished: return ph::lng_wallet_done(ph::now);
+	}
+	Unexpected("Status in Wallet::ButtonText.");
+}
+
+} // namespace
+
+ParsedPayout ParsePayoutCsv(const QByteArray &data) {
+	auto result = ParsedPayout();
+	auto records = ReadRecords(QString::fromUtf8(data));
+	if (!records.empty() && IsHeader(records.front())) {
+		records.erase(begin(records));
+	}
+	result.rows.reserve(records.size());
+	for (const auto &record : records) {
+		auto row = PayoutRow();
+		if (const auto reason = ParseRow(record, &row)) {
+			result.errors.push_back({ record.line, *reason });
+		} else {
+			result.rows.push_back(std::move(row));
+		}
+	}
+	return result;
+}
+
+PayoutTransfer PayoutTransferFromPending(
+		const Ton::PendingTransaction &pending) {
+	auto result = PayoutTransfer();
+	const auto &outgoing = pending.fake.outgoing;
+	if (!outgoing.empty()) {
+		const auto &message = outgoing.front();
+		result.address = message.destination;
+		result.amount = message.value;
+		result.created = message.created;
+		result.bodyHash = message.bodyHash;
+	}
+	return result;
+}
+
+bool IsPayoutTransfer(
+		const Ton::Transaction &transaction,
+		const PayoutTransfer &transfer) {
+	if (transaction.outgoing.size() != 1) {
+		return false;
+	}
+	// The body hash depends only on the comment, so rows sharing a
+	// comment are told apart by the address and the amount.
+	const auto &message = transaction.outgoing.front();
+	if (message.destination != transfer.address
+		|| message.value != transfer.amount) {
+		return false;
+	}
+	return !transfer.bodyHash.isEmpty()
+		? (message.bodyHash == transfer.bodyHash)
+		: (message.created == transfer.created);
+}
+
+Payout::Payout(
+	ParsedPayout &&parsed,
+	const QString &progressPath,
+	Methods &&methods)
+: _progressPath(progressPath)
+, _methods(std::move(methods))
+, _rows(std::move(parsed.rows)) {
+	Expects(_methods.check != nullptr);
+	Expects(_methods.send != nullptr);
+	Expects(_methods.find != nullptr);
+
+	readProgress();
+	_current.count = int(_rows.size());
+	_current.errors = std::move(parsed.errors);
+	for (const auto &row : _rows) {
+		if (_done.contains(row.line)) {
+			++_current.sent;
+		} else {
+			_current.amount += row.invoice.amount;
+		}
+	}
+}
+
+Payout::~Payout() = default;
+
+QString Payout::ProgressPath(
+		const QString &folder,
+		const QString &address,
+		const QByteArray &data) {
+	return folder
+		+ "/payout_"
+		+ QString::fromLatin1(QCryptographicHash::hash(
+			address.toUtf8() + data,
+			QCryptographicHash::Sha256).toHex().left(32));
+}
+
+void Payout::readProgress() {
+	if (_progressPath.isEmpty()) {
+		return;
+	}
+	auto file = QFile(_progressPath);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+	auto stream = QDataStream(&file);
+	stream.setVersion(kStreamVersion);
+
+	auto magic = quint32();
+	auto version = qint32();
+	stream >> magic >> version;
+	if (stream.status() != QDataStream::Ok
+		|| magic != kMagic
+		|| (version != kVersion && version != kLinesVersion)) {
+		file.close();
+		QFile::remove(_progressPath);
+		return;
+	} else if (version == kLinesVersion) {
+		readLinesProgress(file, stream);
+		return;
+	}
+	auto valid = kHeaderSize;
+	while (!stream.atEnd()) {
+		auto type = qint32();
+		auto line = qint32();
+		stream >> type >> line;
+		if (stream.status() != QDataStream::Ok) {
+			break;
+		}
+		switch (RecordType(type)) {
+		case RecordType::Accepted: {
+			auto transfer = PayoutTransfer();
+			auto amount = qint64();
+			auto created = qint32();
+			stream
+				>> transfer.address
+				>> amount
+				>> created
+				>> transfer.bodyHash;
+			if (stream.status() != QDataStream::Ok) {
+				break;
+			}
+			transfer.amount = amount;
+			transfer.created = created;
+			_accepted[line] = std::move(transfer);
+		} break;
+		case RecordType::Confirmed:
+			_accepted.remove(line);
+			_done.emplace(line);
+			break;
+		case RecordType::Expired:
+			_accepted.remove(line);
+			break;
+		default:
+			stream.setStatus(QDataStream::ReadCorruptData);
+			break;
+		}
+		if (stream.status() != QDataStream::Ok) {
+			break;
+		}
+		valid = file.pos();
+	}
+	const auto size = file.size();
+	file.close();
+	if (size != valid) {
+		// Drop a record cut in the middle, so that the next ones align.
+		QFile::resize(_progressPath, valid);
+	}
+	WALLET_LOG(("Payout: resuming with %1 rows sent and %2 to look up."
+		).arg(_done.size()
+		).arg(_accepted.size()));
+}
+
+void Payout::readLinesProgress(QFile &file, QDataStream &stream) {
+	// The first version kept only the lines accepted by the network,
+	// they are counted as sent the same way they were before.
+	auto lines = std::vector<int>();
+	while (true) {
+		auto line = qint32();
+		stream >> line;
+		if (stream.status() != QDataStream::Ok) {
+			break;
+		}
+		lines.push_back(line);
+	}
+	file.close();
+	QFile::remove(_progressPath);
+	for (const auto line : lines) {
+		writeResolved(line, true);
+	}
+	WALLET_LOG(("Payout: resuming with %1 rows already sent."
+		).arg(_done.size()));
+}
+
+void Payout::writeAccepted(int line, const PayoutTransfer &transfer) {
+	_accepted[line] = transfer;
+	auto record = QByteArray();
+	auto stream = QDataStream(&record, QIODevice::WriteOnly);
+	stream.setVersion(kStreamVersion);
+	stream
+		<< qint32(RecordType::Accepted)
+		<< qint32(line)
+		<< transfer.address
+		<< qint64(transfer.amount)
+		<< qint32(transfer.created)
+		<< transfer.bodyHash;
+	writeRecord(record);
+}
+
+void Payout::writeResolved(int line, bool confirmed) {
+	_accepted.remove(line);
+	if (confirmed) {
+		_done.emplace(line);
+	}
+	auto record = QByteArray();
+	auto stream = QDataStream(&record, QIODevice::WriteOnly);
+	stream.setVersion(kStreamVersion);
+	stream
+		<< qint32(confirmed ? RecordType::Confirmed : RecordType::Expired)
+		<< qint32(line);
+	writeRecord(record);
+}
+
+void Payout::writeRecord(const QByteArray &record) {
+	if (_progressPath.isEmpty()) {
+		return;
+	} else if (!_progress.isOpen()) {
+		QDir().mkpath(QFileInfo(_progressPath).absolutePath());
+		_progress.setFileName(_progressPath);
+		if (!_progress.open(QIODevice::ReadWrite)) {
+			WALLET_LOG(("Payout: could not open '%1'.").arg(_progressPath));
+			return;
+		}
+		if (_progress.size() < kHeaderSize) {
+			_progress.resize(0);
+			auto stream = QDataStream(&_progress);
+			stream.setVersion(kStreamVersion);
+			stream << kMagic << kVersion;
+		}
+		_progress.seek(_progress.size());
+	}
+	if (_progress.write(record) != record.size() || !_progress.flush()) {
+		WALLET_LOG(("Payout: could not write to '%1'.").arg(_progressPath));
+	}
+}
+
+void Payout::estimate() {
+	Expects(_current.status == Status::Estimating);
+
+	checkNext();
+}
+
+void Payout::checkNext() {
+	const auto count = int(_rows.size());
+	while (_checksInFlight < kMaxChecksInFlight && _checkIndex < count) {
+		const auto index = _checkIndex++;
+		if (!_done.contains(_rows[index].line)) {
+			check(index);
+		}
+	}
+	if (!_checksInFlight
+		&& _checkIndex == count
+		&& _current.status == Status::Estimating) {
+		update([](State &state) {
+			state.status = Status::Ready;
+		});
+	}
+}
+
+void Payout::check(int index) {
+	++_checksInFlight;
+	_methods.check(_rows[index].invoice, crl::guard(this, [=](
+			Ton::Result<Ton::TransactionCheckResult> result) {
+		checked(index, std::move(result));
+	}));
+}
+
+void Payout::checked(
+		int index,
+		Ton::Result<Ton::TransactionCheckResult> result) {
+	--_checksInFlight;
+	auto &row = _rows[index];
+	if (!result) {
+		const auto &error = result.error();
+		if (!row.invoice.sendUnencryptedText
+			&& error.details.startsWith("MESSAGE_ENCRYPTION")) {
+			// Same as for a single transfer, the comment is sent as is.
+			row.invoice.sendUnencryptedText = true;
+			update([](State &state) {
+				++state.unencrypted;
+			});
+			check(index);
+			return;
+		}
+		WALLET_LOG(("Payout: check failed for line %1, %2."
+			).arg(row.line
+			).arg(error.details));
+		update([&](State &state) {
+			state.errors.push_back({ row.line, ReasonFromError(error) });
+		});
+	} else {
+		row.fee = result->sourceFees.sum();
+		update([&](State &state) {
+			++state.estimated;
+			state.fees += row.fee;
+		});
+	}
+	checkNext();
+}
+
+void Payout::send() {
+	Expects(_current.status == Status::Ready
+		|| _current.status == Status::Paused);
+	Expects(_current.errors.empty());
+
+	_pausing = false;
+	update([](State &state) {
+		state.status = Status::Sending;
+		state.sendError = std::nullopt;
+		state.unconfirmed = false;
+		state.failedLine = 0;
+	});
+	resolveAccepted();
+}
+
+void Payout::pause() {
+	if (_current.status == Status::Sending) {
+		_pausing = true;
+	}
+}
+
+void Payout::sendNext() {
+	const auto count = int(_rows.size());
+	while (_sendIndex < count && _done.contains(_rows[_sendIndex].line)) {
+		++_sendIndex;
+	}
+	if (_sendIndex == count) {
+		_progress.close();
+		if (!_progressPath.isEmpty()) {
+			QFile::remove(_progressPath);
+		}
+		WALLET_LOG(("Payout: all %1 rows sent.").arg(count));
+		update([](State &state) {
+			state.status = Status::Finished;
+		});
+		return;
+	} else if (std::exchange(_pausing, false)) {
+		update([](State &state) {
+			state.status = Status::Paused;
+		});
+		return;
+	}
+	const auto index = _sendIndex;
+	_methods.send(_rows[index].invoice, crl::guard(this, [=](
+			Ton::Result<Ton::PendingTransaction> result) {
+		sendReady(index, std::move(result));
+	}));
+}
+
+void Payout::sendReady(
+		int index,
+		Ton::Result<Ton::PendingTransaction> result) {
+	const auto &row = _rows[index];
+	if (!result) {
+		WALLET_LOG(("Payout: send failed for line %1, %2."
+			).arg(row.line
+			).arg(result.error().details));
+		stop(row.line, result.error(), false);
+		return;
+	}
+	auto transfer = PayoutTransferFromPending(*result);
+	writeAccepted(row.line, transfer);
+	find(index, transfer);
+}
+
+void Payout::resolveAccepted() {
+	while (!_accepted.empty()) {
+		const auto accepted = _accepted.begin();
+		const auto line = accepted->first;
+		const auto row = ranges::find(_rows, line, &PayoutRow::line);
+		if (row != end(_rows)) {
+			WALLET_LOG(("Payout: looking up line %1 accepted before."
+				).arg(line));
+			find(int(row - begin(_rows)), accepted->second);
+			return;
+		}
+		_accepted.erase(accepted);
+	}
+	sendNext();
+}
+
+void Payout::find(int index, const PayoutTransfer &transfer) {
+	_methods.find(transfer, crl::guard(this, [=](bool found) {
+		resolved(index, found);
+	}));
+}
+
+void Payout::resolved(int index, bool confirmed) {
+	const auto &row = _rows[index];
+	writeResolved(row.line, confirmed);
+	if (!confirmed) {
+		// The row is sent again when the payout is continued.
+		WALLET_LOG(("Payout: line %1 was not confirmed.").arg(row.line));
+		stop(row.line, std::nullopt, true);
+		return;
+	}
+	update([&](State &state) {
+		++state.sent;
+		state.amount -= row.invoice.amount;
+		state.fees -= std::max(row.fee, int64(0));
+	});
+	resolveAccepted();
+}
+
+void Payout::stop(
+		int line,
+		std::optional<Ton::Error> error,
+		bool unconfirmed) {
+	_pausing = false;
+	update([&](State &state) {
+		state.status = Status::Paused;
+		state.sendError = std::move(error);
+		state.unconfirmed = unconfirmed;
+		state.failedLine = line;
+	});
+}
+
+void Payout::update(Fn<void(State&)> modify) {
+	modify(_current);
+	_changes.fire_copy(_current);
+}
+
+auto Payout::current() const -> const State & {
+	return _current;
+}
+
+rpl::producer<Payout::State> Payout::state() const {
+	return _changes.events_starting_with_copy(_current);
+}
+
+rpl::lifetime &Payout::lifetime() {
+	return _lifetime;
+}
+
+void PayoutBox(
+		not_null<Ui::GenericBox*> box,
+		rpl::producer<Payout::State> state,
+		rpl::producer<int64> unlockedBalance,
+		Fn<void()> send,
+		Fn<void()> pause) {
+	box->setTitle(ph::lng_wallet_payout_title());
+	box->setCloseByOutsideClick(false);
+	box->setCloseByEscape(false);
+
+	const auto current = box->lifetime().make_state<BoxState>();
+	const auto updates = box->lifetime().make_state<rpl::event_stream<>>();
+	rpl::combine(
+		std::move(state),
+		std::move(unlockedBalance)
+	) | rpl::start_with_next([=](Payout::State &&state, int64 balance) {
+		current->payout = std::move(state);
+		current->balance = balance;
+		updates->fire({});
+	}, box->lifetime());
+	const auto value = [=](QString(*text)(const BoxState&)) {
+		return updates->events_starting_with({}) | rpl::map([=] {
+			return text(*current);
+		});
+	};
+
+	box->addRow(
+		object_ptr<Ui::FlatLabel>(
+			box,
+			value(SummaryText),
+			st::walletLabel),
+		st::walletConfirmationLabelPadding);
+	box->addRow(object_ptr<Ui::FlatLabel>(
+		box,
+		value(StatusText),
+		st::walletLabel));
+
+	box->addButton(value(ButtonText), [=] {
+		switch (current->payout.status) {
+		case Status::Estimating: return;
+		case Status::Ready:
+		case Status::Paused:
+			if (current->payout.errors.empty() && Enough(*current)) {
+				send();
+			}
+			return;
+		case Status::Sending: pause(); return;
+		case Status::Finished: box->closeBox(); return;
+		}
+	});
+	box->addButton(ph::lng_wallet_cancel(), [=] {
+		if (current->payout.status != Status::Sending) {
+			box->closeBox();
+		}
+	});
+}
+
+} // namespace Wallet
@@ -0,0 +1,181 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "wallet/wallet_common.h"
+#include "ton/ton_state.h"
+#include "ton/ton_result.h"
+#include "base/weak_ptr.h"
+#include "base/flat_set.h"
+#include "base/flat_map.h"
+
+#include <QtCore/QFile>
+
+class QDataStream;
+
+namespace Ui {
+class GenericBox;
+} // namespace Ui
+
+namespace Wallet {
+
+struct PayoutRow {
+	int line = 0;
+	PreparedInvoice invoice;
+	int64 fee = -1;
+};
+
+struct PayoutError {
+	enum class Reason {
+		Format,
+		Address,
+		Amount,
+		Comment,
+		Check,
+	};
+	int line = 0;
+	Reason reason = Reason::Format;
+};
+
+struct ParsedPayout {
+	std::vector<PayoutRow> rows;
+	std::vector<PayoutError> errors;
+};
+
+// What is left of a transfer accepted by the network, enough to find it
+// in the history later, after a restart as well.
+struct PayoutTransfer {
+	QString address;
+	int64 amount = 0;
+	TimeId created = 0;
+	QByteArray bodyHash;
+};
+
+// Rows of "address,amount,comment" with the amount in grams and an optional
+// comment, quoted the usual CSV way. The first line may be a header.
+[[nodiscard]] ParsedPayout ParsePayoutCsv(const QByteArray &data);
+
+[[nodiscard]] PayoutTransfer PayoutTransferFromPending(
+	const Ton::PendingTransaction &pending);
+[[nodiscard]] bool IsPayoutTransfer(
+	const Ton::Transaction &transaction,
+	const PayoutTransfer &transfer);
+
+// Pays to all the rows of a parsed file from one account.
+//
+// The fees are estimated for several rows at once, with a limit of checks
+// in flight. The transfers are sent one by one, each after the previous one
+// has left the pending list, because a wallet has one sequence number.
+// A row is written to the progress file as accepted when the network takes
+// it and as done only when it appears in the history. A row accepted but
+// not resolved before an interruption is looked up in the history again
+// on resume, so a payout is resumed from the same file without paying
+// anyone twice and without skipping an expired transfer.
+class Payout final : public base::has_weak_ptr {
+public:
+	enum class Status {
+		Estimating,
+		Ready,
+		Sending,
+		Paused,
+		Finished,
+	};
+	struct State {
+		Status status = Status::Estimating;
+		int count = 0;
+		int estimated = 0;
+		int sent = 0;
+		int unencrypted = 0;
+		int64 amount = 0;
+		int64 fees = 0;
+		std::vector<PayoutError> errors;
+		std::optional<Ton::Error> sendError;
+		bool unconfirmed = false;
+		int failedLine = 0;
+	};
+	struct Methods {
+		Fn<void(
+			const PreparedInvoice &invoice,
+			Fn<void(Ton::Result<Ton::TransactionCheckResult>)> done)> check;
+
+		Fn<void(
+			const PreparedInvoice &invoice,
+			Fn<void(Ton::Result<Ton::PendingTransaction>)> ready)> send;
+
+		// Waits until the transfer is not pending anymore, 'done' is called
+		// with false if it has expired instead of appearing in the history.
+		Fn<void(
+			const PayoutTransfer &transfer,
+			Fn<void(bool found)> done)> find;
+	};
+
+	Payout(
+		ParsedPayout &&parsed,
+		const QString &progressPath,
+		Methods &&methods);
+	~Payout();
+
+	[[nodiscard]] static QString ProgressPath(
+		const QString &folder,
+		const QString &address,
+		const QByteArray &data);
+
+	void estimate();
+	void send();
+
+	// Stops after the transfer being sent, if there is one.
+	void pause();
+
+	[[nodiscard]] const State &current() const;
+	[[nodiscard]] rpl::producer<State> state() const;
+
+	[[nodiscard]] rpl::lifetime &lifetime();
+
+private:
+	void readProgress();
+	void readLinesProgress(QFile &file, QDataStream &stream);
+	void writeAccepted(int line, const PayoutTransfer &transfer);
+	void writeResolved(int line, bool confirmed);
+	void writeRecord(const QByteArray &record);
+	void checkNext();
+	void check(int index);
+	void checked(
+		int index,
+		Ton::Result<Ton::TransactionCheckResult> result);
+	void sendNext();
+	void sendReady(int index, Ton::Result<Ton::PendingTransaction> result);
+	void resolveAccepted();
+	void find(int index, const PayoutTransfer &transfer);
+	void resolved(int index, bool confirmed);
+	void stop(int line, std::optional<Ton::Error> error, bool unconfirmed);
+	void update(Fn<void(State&)> modify);
+
+	const QString _progressPath;
+	const Methods _methods;
+	std::vector<PayoutRow> _rows;
+	base::flat_set<int> _done;
+	base::flat_map<int, PayoutTransfer> _accepted;
+	QFile _progress;
+	int _checkIndex = 0;
+	int _checksInFlight = 0;
+	int _sendIndex = 0;
+	bool _pausing = false;
+	State _current;
+	rpl::event_stream<State> _changes;
+
+	rpl::lifetime _lifetime;
+
+};
+
+void PayoutBox(
+	not_null<Ui::GenericBox*> box,
+	rpl::producer<Payout::State> state,
+	rpl::producer<int64> unlockedBalance,
+	Fn<void()> send,
+	Fn<void()> pause);
+
+} // namespace Wallet
@@ -0,0 +1,94 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_payout.h"
+
+#include "ton/ton_state.h"
+
+#include <iostream>
+
+namespace {
+
+int Failures = 0;
+
+void Check(bool condition, const char *what) {
+	if (!condition) {
+		std::cerr << "FAILED: " << what << std::endl;
+		++Failures;
+	}
+}
+
+[[nodiscard]] Ton::Transaction Outgoing(
+		const QString &address,
+		int64 amount,
+		TimeId created,
+		const QByteArray &bodyHash) {
+	auto message = Ton::Message();
+	message.destination = address;
+	message.value = amount;
+	message.created = created;
+	message.bodyHash = bodyHash;
+
+	auto result = Ton::Transaction();
+	result.time = created;
+	result.outgoing.push_back(message);
+	return result;
+}
+
+[[nodiscard]] Wallet::PayoutTransfer Transfer(
+		const QString &address,
+		int64 amount,
+		TimeId created,
+		const QByteArray &bodyHash) {
+	auto result = Wallet::PayoutTransfer();
+	result.address = address;
+	result.amount = amount;
+	result.created = created;
+	result.bodyHash = bodyHash;
+	return result;
+}
+
+void TestSharedComment() {
+	using Wallet::IsPayoutTransfer;
+
+	// Two rows of a payout with the same comment have the same body hash,
+	// the transfer sent later may also be created at another moment.
+	const auto hash = QByteArray("same comment hash");
+	const auto first = Outgoing("first", 100, 10, hash);
+	const auto second = Outgoing("second", 200, 20, hash);
+	const auto toFirst = Transfer("first", 100, 12, hash);
+	const auto toSecond = Transfer("second", 200, 22, hash);
+	Check(IsPayoutTransfer(first, toFirst), "shared comment, first row");
+	Check(IsPayoutTransfer(second, toSecond), "shared comment, second row");
+	Check(!IsPayoutTransfer(first, toSecond), "shared comment, other row");
+	Check(!IsPayoutTransfer(second, toFirst), "shared comment, other row");
+
+	const auto sameAddress = Transfer("first", 200, 12, hash);
+	Check(
+		!IsPayoutTransfer(first, sameAddress),
+		"shared comment, same address with another amount");
+}
+
+void TestEmptyComment() {
+	using Wallet::IsPayoutTransfer;
+
+	const auto first = Outgoing("first", 100, 10, QByteArray());
+	const auto second = Outgoing("second", 100, 10, QByteArray());
+	const auto toFirst = Transfer("first", 100, 10, QByteArray());
+	Check(IsPayoutTransfer(first, toFirst), "empty comment, same row");
+	Check(!IsPayoutTransfer(second, toFirst), "empty comment, other row");
+
+	const auto later = Transfer("first", 100, 11, QByteArray());
+	Check(!IsPayoutTransfer(first, later), "empty comment, other moment");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	TestSharedComment();
+	TestEmptyComment();
+	return Failures ? 1 : 0;
+}
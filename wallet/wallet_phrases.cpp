@@ -171,6 +171,10 @@ phrase lng_wallet_row_fees = "комиссия блокчейна: {amount}";
 phrase lng_wallet_row_pending_date = "Ожидание";
 phrase lng_wallet_click_to_decrypt = "Введите пароль чтобы увидеть комментарий";
 phrase lng_wallet_decrypt_failed = "Ошибка дешифрации :(";
+phrase lng_wallet_search_placeholder = "Поиск по адресу или комментарию";
+phrase lng_wallet_row_month_summary = "Транзакций: {count}, получено {received}, отправлено {sent}";
+phrase lng_wallet_row_month_show = "Показать";
+phrase lng_wallet_row_month_hide = "Скрыть";
 
 phrase lng_wallet_view_title = "Транзакция";
 phrase lng_wallet_view_transaction_fee = "{amount} коммиссия хранилища";
@@ -211,12 +215,46 @@ phrase lng_wallet_invoice_copied = "Ссылка на счёт скопиров
 phrase lng_wallet_menu_settings = "Настройки";
 phrase lng_wallet_menu_change_passcode = "Поменять пароль";
 phrase lng_wallet_menu_export = "Экспорт кошелька";
+phrase lng_wallet_menu_export_history = "Экспорт истории";
+phrase lng_wallet_menu_payout = "Массовая выплата";
 phrase lng_wallet_menu_delete = "Отключиться от кошелька";
+phrase lng_wallet_menu_account = "Кошелёк {address}";
+phrase lng_wallet_menu_account_current = "Кошелёк {address} (открыт)";
 
 phrase lng_wallet_delete_title = "Отключиться от кошелька";
 phrase lng_wallet_delete_about = "Это действие отключит кошелёк от приложения. Вы сможете восстановить кошелёк, введя 24 секретных слова  \xe2\x80\x93 – или импортировать другой кошелёк.\n\nКошельки расположены внутри блокчейна TON, который не контролируется Telegram. Если вы хотите удалить кошелёк, просто переведите с него все Gram и оставьте пустым.";
 phrase lng_wallet_delete_disconnect = "Удалить";
 
+phrase lng_wallet_export_history_title = "Экспорт истории";
+phrase lng_wallet_export_history_progress = "Экспортировано транзакций: {count}";
+phrase lng_wallet_export_history_done = "История транзакций сохранена.";
+phrase lng_wallet_export_history_failed = "Не удалось сохранить историю транзакций.";
+
+phrase lng_wallet_payout_title = "Массовая выплата";
+phrase lng_wallet_payout_bad_file = "Не удалось прочитать файл выплат.";
+phrase lng_wallet_payout_empty = "В файле нет ни одной выплаты.";
+phrase lng_wallet_payout_recipients = "Получателей: {count}";
+phrase lng_wallet_payout_resumed = "Уже отправлено ранее: {count}";
+phrase lng_wallet_payout_amount = "Сумма: {grams}";
+phrase lng_wallet_payout_fees = "Комиссии: {grams}";
+phrase lng_wallet_payout_estimating = "Оценка комиссий: {ready} из {total}";
+phrase lng_wallet_payout_total = "Итого с комиссиями: {grams}";
+phrase lng_wallet_payout_available = "Доступно: {grams}";
+phrase lng_wallet_payout_not_enough = "Недостаточно средств для всех выплат.";
+phrase lng_wallet_payout_unencrypted = "Комментарии для получателей ({count}) будут отправлены без шифрования.";
+phrase lng_wallet_payout_error_format = "Строка {line}: неверный формат.";
+phrase lng_wallet_payout_error_address = "Строка {line}: неверный адрес.";
+phrase lng_wallet_payout_error_amount = "Строка {line}: неверная сумма.";
+phrase lng_wallet_payout_error_comment = "Строка {line}: слишком длинный комментарий.";
+phrase lng_wallet_payout_error_check = "Строка {line}: не удалось оценить комиссию.";
+phrase lng_wallet_payout_errors_more = "И ещё ошибок: {count}";
+phrase lng_wallet_payout_progress = "Отправлено {sent} из {total}";
+phrase lng_wallet_payout_send_failed = "Строка {line}: перевод не отправлен. {error}";
+phrase lng_wallet_payout_unconfirmed = "Строка {line}: перевод не появился в истории. Проверьте историю, прежде чем продолжить.";
+phrase lng_wallet_payout_finished = "Все выплаты отправлены.";
+phrase lng_wallet_payout_send = "Отправить";
+phrase lng_wallet_payout_pause = "Пауза";
+
 phrase lng_wallet_send_title = "Отправить грамы";
 phrase lng_wallet_send_recipient = "Адрес кошелька получателя";
 phrase lng_wallet_send_address = "Введите адрес кошелька";
@@ -269,6 +307,12 @@ phrase lng_wallet_settings_config_from_file = "Загрузить из файл
 phrase lng_wallet_settings_mainnet = "Основная сеть";
 phrase lng_wallet_settings_testnet = "Тестовая сеть";
 phrase lng_wallet_settings_blockchain_name = "ID блокчейна";
+phrase lng_wallet_settings_diagnostics = "Диагностика";
+phrase lng_wallet_settings_record_trace = "Записывать трассировку";
+phrase lng_wallet_settings_export_trace = "Сохранить трассировку";
+phrase lng_wallet_export_trace_title = "Сохранить трассировку";
+phrase lng_wallet_export_trace_done = "Трассировка сохранена.";
+phrase lng_wallet_export_trace_failed = "Не удалось сохранить трассировку.";
 
 phrase lng_wallet_warning_reconnect = "Если вы продолжите, вам нужно будет переподключить кошелёк используя 24 секретных слова.";
 phrase lng_wallet_warning_blockchain_name = "Вы точно хотите изменить ID блокчейна? Вам не следует этого делать, если вы не тестируюете свою сеть TON.";
@@ -343,6 +387,30 @@ Fn<phrase(QDate)> lng_wallet_short_date = [](QDate date) {
 	return small;
 };
 
+Fn<phrase(QDate)> lng_wallet_month = [](QDate date) {
+	const auto result = [&]() -> QString {
+		switch (date.month()) {
+		case 1: return "Январь";
+		case 2: return "Февраль";
+		case 3: return "Март";
+		case 4: return "Апрель";
+		case 5: return "Май";
+		case 6: return "Июнь";
+		case 7: return "Июль";
+		case 8: return "Август";
+		case 9: return "Сентябрь";
+		case 10: return "Октябрь";
+		case 11: return "Ноябрь";
+		case 12: return "Декабрь";
+		}
+		return QString();
+	}();
+	if (result.isEmpty() || date.year() == QDate::currentDate().year()) {
+		return result;
+	}
+	return result + ' ' + QString::number(date.year());
+};
+
 Fn<phrase(QTime)> lng_wallet_short_time = [](QTime time) {
 	return time.toString(Qt::SystemLocaleShortDate);
 };
@@ -358,6 +426,11 @@ Fn<phrase(QString)> lng_wallet_grams_count_sent = [](QString text) {
 } // namespace ph
 
 namespace Wallet {
+namespace {
+
+auto PhrasesGenerationValue = 0;
+
+} // namespace
 
 void SetPhrases(
 		ph::details::phrase_value_array<kPhrasesCount> data,
@@ -366,6 +439,7 @@ void SetPhrases(
 		Fn<rpl::producer<QString>(QTime)> wallet_short_time,
 		Fn<rpl::producer<QString>(QString)> wallet_grams_count) {
 	ph::details::set_values(std::move(data));
+	++PhrasesGenerationValue;
 	ph::lng_wallet_refreshed_minutes_ago = [=](int minutes) {
 		return ph::phrase{ wallet_refreshed_minutes_ago(minutes) };
 	};
@@ -380,4 +454,8 @@ void SetPhrases(
 	};
 }
 
+int PhrasesGeneration() {
+	return PhrasesGenerationValue;
+}
+
 } // namespace Wallet
@@ -97,6 +97,10 @@ extern phrase lng_wallet_row_fees;
 extern phrase lng_wallet_row_pending_date;
 extern phrase lng_wallet_click_to_decrypt;
 extern phrase lng_wallet_decrypt_failed;
+extern phrase lng_wallet_search_placeholder;
+extern phrase lng_wallet_row_month_summary;
+extern phrase lng_wallet_row_month_show;
+extern phrase lng_wallet_row_month_hide;
 
 extern phrase lng_wallet_view_title;
 extern phrase lng_wallet_view_transaction_fee;
@@ -137,12 +141,46 @@ extern phrase lng_wallet_invoice_copied;
 extern phrase lng_wallet_menu_settings;
 extern phrase lng_wallet_menu_change_passcode;
 extern phrase lng_wallet_menu_export;
+extern phrase lng_wallet_menu_export_history;
+extern phrase lng_wallet_menu_payout;
 extern phrase lng_wallet_menu_delete;
+extern phrase lng_wallet_menu_account;
+extern phrase lng_wallet_menu_account_current;
 
 extern phrase lng_wallet_delete_title;
 extern phrase lng_wallet_delete_about;
 extern phrase lng_wallet_delete_disconnect;
 
+extern phrase lng_wallet_export_history_title;
+extern phrase lng_wallet_export_history_progress;
+extern phrase lng_wallet_export_history_done;
+extern phrase lng_wallet_export_history_failed;
+
+extern phrase lng_wallet_payout_title;
+extern phrase lng_wallet_payout_bad_file;
+extern phrase lng_wallet_payout_empty;
+extern phrase lng_wallet_payout_recipients;
+extern phrase lng_wallet_payout_resumed;
+extern phrase lng_wallet_payout_amount;
+extern phrase lng_wallet_payout_fees;
+extern phrase lng_wallet_payout_estimating;
+extern phrase lng_wallet_payout_total;
+extern phrase lng_wallet_payout_available;
+extern phrase lng_wallet_payout_not_enough;
+extern phrase lng_wallet_payout_unencrypted;
+extern phrase lng_wallet_payout_error_format;
+extern phrase lng_wallet_payout_error_address;
+extern phrase lng_wallet_payout_error_amount;
+extern phrase lng_wallet_payout_error_comment;
+extern phrase lng_wallet_payout_error_check;
+extern phrase lng_wallet_payout_errors_more;
+extern phrase lng_wallet_payout_progress;
+extern phrase lng_wallet_payout_send_failed;
+extern phrase lng_wallet_payout_unconfirmed;
+extern phrase lng_wallet_payout_finished;
+extern phrase lng_wallet_payout_send;
+extern phrase lng_wallet_payout_pause;
+
 extern phrase lng_wallet_send_title;
 extern phrase lng_wallet_send_recipient;
 extern phrase lng_wallet_send_address;
@@ -195,6 +233,12 @@ extern phrase lng_wallet_settings_config_from_file;
 extern phrase lng_wallet_settings_mainnet;
 extern phrase lng_wallet_settings_testnet;
 extern phrase lng_wallet_settings_blockchain_name;
+extern phrase lng_wallet_settings_diagnostics;
+extern phrase lng_wallet_settings_record_trace;
+extern phrase lng_wallet_settings_export_trace;
+extern phrase lng_wallet_export_trace_title;
+extern phrase lng_wallet_export_trace_done;
+extern phrase lng_wallet_export_trace_failed;
 
 extern phrase lng_wallet_warning_reconnect;
 extern phrase lng_wallet_warning_blockchain_name;
@@ -209,6 +253,7 @@ extern phrase lng_wallet_downloaded;
 
 extern Fn<phrase(int)> lng_wallet_refreshed_minutes_ago;
 extern Fn<phrase(QDate)> lng_wallet_short_date;
+extern Fn<phrase(QDate)> lng_wallet_month;
 extern Fn<phrase(QTime)> lng_wallet_short_time;
 extern Fn<phrase(QString)> lng_wallet_grams_count;
 extern Fn<phrase(QString)> lng_wallet_grams_count_sent;
@@ -217,7 +262,7 @@ extern Fn<phrase(QString)> lng_wallet_grams_count_sent;
 
 namespace Wallet {
 
-inline constexpr auto kPhrasesCount = 163;
+inline constexpr auto kPhrasesCount = 204;
 
 void SetPhrases(
 	ph::details::phrase_value_array<kPhrasesCount> data,
@@ -227,4 +272,7 @@ void SetPhrases(
 	Fn<rpl::producer<QString>(QString)> wallet_grams_count,
 	Fn<rpl::producer<QString>(QString)> wallet_grams_count_sent);
 
+// Changes each time the phrases are set, for caches of formatted texts.
+[[nodiscard]] int PhrasesGeneration();
+
 } // namespace Wallet
@@ -0,0 +1,113 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_preload_controller.h"
+
+#include "wallet/wallet_log.h"
+
+namespace Wallet {
+namespace {
+
+constexpr auto kMinPreloadScreens = 2;
+constexpr auto kMaxPreloadScreens = 16;
+constexpr auto kDefaultLatency = crl::time(1000);
+constexpr auto kLatencyMargin = 2;
+constexpr auto kVelocityTimeout = crl::time(300);
+constexpr auto kVelocitySmoothing = 0.3;
+constexpr auto kRetryTimeout = 10 * crl::time(1000);
+constexpr auto kLogStatsEach = 16;
+
+} // namespace
+
+PreloadController::~PreloadController() {
+	if (_hits || _misses) {
+		logStats();
+	}
+}
+
+void PreloadController::scrolled(int top, int height) {
+	const auto now = crl::now();
+	const auto elapsed = now - _lastTime;
+	if (_lastTime && elapsed > 0 && elapsed < kVelocityTimeout) {
+		// Only scrolling down to the older transactions matters.
+		const auto speed = std::max(top - _lastTop, 0) / double(elapsed);
+		_velocity = _velocity * (1. - kVelocitySmoothing)
+			+ speed * kVelocitySmoothing;
+	} else if (elapsed != 0) {
+		_velocity = 0.;
+	}
+	_lastTime = now;
+	_lastTop = top;
+	_height = height;
+}
+
+int PreloadController::preloadHeight() const {
+	const auto velocity = (crl::now() - _lastTime < kVelocityTimeout)
+		? _velocity
+		: 0.;
+	const auto latency = _latency ? _latency : kDefaultLatency;
+	const auto ahead = int(velocity * latency * kLatencyMargin);
+	return std::clamp(
+		ahead,
+		kMinPreloadScreens * _height,
+		kMaxPreloadScreens * _height);
+}
+
+bool PreloadController::request(const Ton::TransactionId &id) {
+	const auto now = crl::now();
+	const auto i = _requests.find(id.lt);
+	if (i == end(_requests)) {
+		_requests.emplace(id.lt, Request{ now });
+		return true;
+	} else if (now - i->second.sent < kRetryTimeout) {
+		++_duplicates;
+		return false;
+	}
+	// The previous request has probably failed, send it once more.
+	++_retries;
+	i->second.sent = now;
+	return true;
+}
+
+bool PreloadController::finish(const Ton::TransactionId &id) {
+	const auto i = _requests.find(id.lt);
+	if (i == end(_requests)) {
+		return false;
+	}
+	const auto took = crl::now() - i->second.sent;
+	_latency = _latency ? ((3 * _latency + took) / 4) : took;
+	if (i->second.stalled) {
+		++_misses;
+	} else {
+		++_hits;
+	}
+	_requests.erase(i);
+	if (!((_hits + _misses) % kLogStatsEach)) {
+		logStats();
+	}
+	return true;
+}
+
+void PreloadController::stalled(const Ton::TransactionId &id) {
+	const auto i = _requests.find(id.lt);
+	if (i != end(_requests)) {
+		i->second.stalled = true;
+	}
+}
+
+void PreloadController::logStats() const {
+	WALLET_LOG(("History preload: %1 in time, %2 late, "
+		"%3 duplicates skipped, %4 retries, latency %5 ms, "
+		"look-ahead %6 px."
+		).arg(_hits
+		).arg(_misses
+		).arg(_duplicates
+		).arg(_retries
+		).arg(_latency
+		).arg(preloadHeight()));
+}
+
+} // namespace Wallet
@@ -0,0 +1,57 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+#include "base/flat_map.h"
+
+namespace Wallet {
+
+// Decides how far ahead of the scroll position the history is loaded.
+//
+// The distance follows the scroll speed and the measured time it takes
+// a slice to arrive, each continuation id is requested only once at a
+// time and the counts of loads that arrived in time are logged.
+class PreloadController final {
+public:
+	~PreloadController();
+
+	void scrolled(int top, int height);
+	[[nodiscard]] int preloadHeight() const;
+
+	// Returns false if the same slice is being loaded already.
+	[[nodiscard]] bool request(const Ton::TransactionId &id);
+
+	// Returns false if the slice was not requested by us.
+	[[nodiscard]] bool finish(const Ton::TransactionId &id);
+
+	// The user reached the end of the loaded history while waiting.
+	void stalled(const Ton::TransactionId &id);
+
+private:
+	struct Request {
+		crl::time sent = 0;
+		bool stalled = false;
+	};
+
+	void logStats() const;
+
+	base::flat_map<int64, Request> _requests;
+	crl::time _latency = 0;
+	crl::time _lastTime = 0;
+	double _velocity = 0.;
+	int _lastTop = 0;
+	int _height = 0;
+
+	int _hits = 0;
+	int _misses = 0;
+	int _duplicates = 0;
+	int _retries = 0;
+
+};
+
+} // namespace Wallet
@@ -0,0 +1,266 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_refresh_scheduler.h"
+
+#include <QtCore/QRandomGenerator>
+
+namespace Wallet {
+namespace {
+
+constexpr auto kRefreshEachDelay = 10 * crl::time(1000);
+constexpr auto kRefreshInactiveDelay = 60 * crl::time(1000);
+constexpr auto kRefreshWhileSendingDelay = 3 * crl::time(1000);
+constexpr auto kRefreshMaxDelay = 10 * 60 * crl::time(1000);
+
+// The viewer has no way to stop refreshing, a day is long enough.
+constexpr auto kRefreshPausedDelay = 24 * 60 * 60 * crl::time(1000);
+
+constexpr auto kBackoffMax = 6;
+constexpr auto kJitterPercent = 15;
+
+[[nodiscard]] int RandomJitter() {
+	return int(QRandomGenerator::global()->bounded(
+		2 * kJitterPercent + 1)) - kJitterPercent;
+}
+
+[[nodiscard]] crl::time AddJitter(crl::time delay, int percent) {
+	return delay + delay * percent / 100;
+}
+
+[[nodiscard]] Ton::TransactionId LastTransactionId(
+		const Ton::WalletState &state) {
+	const auto &list = state.lastTransactions.list;
+	return list.empty() ? Ton::TransactionId() : list.front().id;
+}
+
+} // namespace
+
+QString RefreshReasonText(RefreshReason reason) {
+	switch (reason) {
+	case RefreshReason::Started: return "started";
+	case RefreshReason::Changed: return "changed";
+	case RefreshReason::Unchanged: return "unchanged";
+	case RefreshReason::UserInput: return "user input";
+	case RefreshReason::Sending: return "sending";
+	case RefreshReason::Switched: return "switched";
+	case RefreshReason::Activated: return "activated";
+	case RefreshReason::Deactivated: return "deactivated";
+	case RefreshReason::Minimized: return "minimized";
+	case RefreshReason::Restored: return "restored";
+	}
+	Unexpected("Reason in RefreshReasonText.");
+}
+
+RefreshScheduler::RefreshScheduler(Methods &&methods)
+: _methods(std::move(methods)) {
+	Expects(_methods.setRefreshEach != nullptr);
+	Expects(_methods.refreshNow != nullptr);
+
+	decide(RefreshReason::Started);
+}
+
+void RefreshScheduler::addAccount(const QString &address) {
+	const auto [i, ok] = _accounts.emplace(address, Account());
+	if (ok) {
+		i->second.jitter = RandomJitter();
+		applyDelay(address, i->second);
+	}
+}
+
+void RefreshScheduler::setCurrent(const QString &address) {
+	Expects(_accounts.contains(address));
+
+	if (_current == address) {
+		return;
+	}
+	_current = address;
+	setBackoff(_accounts[address], 0);
+	decide(RefreshReason::Switched);
+}
+
+void RefreshScheduler::stateChanged(
+		const QString &address,
+		const Ton::WalletViewerState &state) {
+	const auto i = _accounts.find(address);
+	Assert(i != end(_accounts));
+
+	auto &account = i->second;
+	const auto wasSending = sending();
+	account.refreshing = state.refreshing;
+	account.sending = !state.wallet.pendingTransactions.empty();
+	const auto sendingChanged = (sending() != wasSending);
+
+	const auto refreshed = state.lastRefresh
+		&& (state.lastRefresh != account.lastRefresh);
+	if (!refreshed) {
+		if (sendingChanged) {
+			decide(sending()
+				? RefreshReason::Sending
+				: RefreshReason::Changed);
+		}
+		return;
+	}
+	account.lastRefresh = state.lastRefresh;
+
+	const auto balance = state.wallet.account.fullBalance;
+	const auto lastTransactionId = LastTransactionId(state.wallet);
+	const auto changed = (account.balance != balance)
+		|| (account.lastTransactionId != lastTransactionId);
+	account.balance = balance;
+	account.lastTransactionId = lastTransactionId;
+
+	const auto current = (address == _current);
+	if (sending()) {
+		if (sendingChanged) {
+			decide(RefreshReason::Sending);
+		}
+	} else if (changed || sendingChanged) {
+		setBackoff(account, 0);
+		if (current || sendingChanged) {
+			decide(RefreshReason::Changed);
+		}
+	} else {
+		setBackoff(account, std::min(account.backoff + 1, kBackoffMax));
+		if (current) {
+			decide(RefreshReason::Unchanged);
+		}
+	}
+	if (current) {
+		refreshDue(state.lastRefresh);
+	}
+}
+
+void RefreshScheduler::setActive(bool active) {
+	if (_active == active) {
+		return;
+	}
+	_active = active;
+	if (active) {
+		resetBackoff();
+	}
+	decide(active ? RefreshReason::Activated : RefreshReason::Deactivated);
+	if (active) {
+		refreshOverdue();
+	}
+}
+
+void RefreshScheduler::setMinimized(bool minimized) {
+	if (_minimized == minimized) {
+		return;
+	}
+	_minimized = minimized;
+	if (minimized) {
+		decide(RefreshReason::Minimized);
+		return;
+	}
+	resetBackoff();
+	decide(RefreshReason::Restored);
+	for (const auto &[address, account] : _accounts) {
+		if (!account.refreshing) {
+			_methods.refreshNow(address);
+		}
+	}
+}
+
+void RefreshScheduler::userInput() {
+	// Called for each input event, so it does nothing most of the time.
+	if (!_active || _minimized || !resetBackoff()) {
+		return;
+	}
+	decide(RefreshReason::UserInput);
+	refreshOverdue();
+}
+
+rpl::producer<RefreshDecision> RefreshScheduler::decisions() const {
+	return _decisions.events();
+}
+
+void RefreshScheduler::decide(RefreshReason reason) {
+	for (auto &[address, account] : _accounts) {
+		applyDelay(address, account);
+	}
+	const auto i = _accounts.find(_current);
+	const auto current = (i != end(_accounts)) ? i->second : Account();
+	auto decision = RefreshDecision();
+	decision.reason = reason;
+	decision.delay = countDelay(current);
+	decision.backoff = current.backoff;
+	decision.paused = _minimized;
+	_decisions.fire_copy(decision);
+}
+
+void RefreshScheduler::applyDelay(const QString &address, Account &account) {
+	const auto delay = (address == _current)
+		? countDelay(account)
+		: kRefreshPausedDelay;
+	if (account.appliedDelay != delay) {
+		account.appliedDelay = delay;
+		_methods.setRefreshEach(address, delay);
+	}
+}
+
+void RefreshScheduler::setBackoff(Account &account, int backoff) {
+	if (account.backoff != backoff) {
+		account.backoff = backoff;
+		account.jitter = RandomJitter();
+	}
+}
+
+bool RefreshScheduler::resetBackoff() {
+	auto result = false;
+	for (auto &[address, account] : _accounts) {
+		if (account.backoff) {
+			setBackoff(account, 0);
+			result = true;
+		}
+	}
+	return result;
+}
+
+void RefreshScheduler::refreshDue(crl::time now) {
+	// Accounts refreshed less than half their delay ago can wait a round.
+	for (const auto &[address, account] : _accounts) {
+		if (address != _current
+			&& !account.refreshing
+			&& now - account.lastRefresh >= countDelay(account) / 2) {
+			_methods.refreshNow(address);
+		}
+	}
+}
+
+void RefreshScheduler::refreshOverdue() {
+	// The timer of the viewer may still count the long delay, so the
+	// refresh that is due with the new delay is made right now.
+	const auto i = _accounts.find(_current);
+	if (_minimized
+		|| i == end(_accounts)
+		|| i->second.refreshing
+		|| crl::now() - i->second.lastRefresh < countDelay(i->second)) {
+		return;
+	}
+	_methods.refreshNow(_current);
+}
+
+bool RefreshScheduler::sending() const {
+	return ranges::any_of(_accounts, [](const auto &pair) {
+		return pair.second.sending;
+	});
+}
+
+crl::time RefreshScheduler::countDelay(const Account &account) const {
+	if (_minimized) {
+		return kRefreshPausedDelay;
+	} else if (sending()) {
+		return AddJitter(kRefreshWhileSendingDelay, account.jitter);
+	}
+	const auto base = _active ? kRefreshEachDelay : kRefreshInactiveDelay;
+	return AddJitter(
+		std::min(base << account.backoff, kRefreshMaxDelay),
+		account.jitter);
+}
+
+} // namespace Wallet
@@ -0,0 +1,100 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+#include "base/flat_map.h"
+
+namespace Wallet {
+
+enum class RefreshReason {
+	Started,
+	Changed,
+	Unchanged,
+	UserInput,
+	Sending,
+	Switched,
+	Activated,
+	Deactivated,
+	Minimized,
+	Restored,
+};
+
+struct RefreshDecision {
+	RefreshReason reason = RefreshReason::Started;
+	crl::time delay = 0;
+	int backoff = 0;
+	bool paused = false;
+};
+
+[[nodiscard]] QString RefreshReasonText(RefreshReason reason);
+
+// Chooses how often the accounts are refreshed.
+//
+// Each account keeps its own delay: every refresh of it that brings
+// nothing new doubles the delay up to a limit and a change in it resets
+// the delay. User input or the window activation resets all of them,
+// and an overdue refresh is then made at once. While the window is
+// minimized nothing is refreshed, it is caught up on restore.
+// Every delay is randomly spread a bit, so that many running wallets
+// don't poll the servers at the same moments. The spread is chosen once
+// per backoff step, so that a delay doesn't change with each update.
+//
+// Only the viewer of the current account refreshes on its own timer,
+// the other accounts that are due are refreshed together with it.
+class RefreshScheduler final {
+public:
+	struct Methods {
+		Fn<void(const QString &address, crl::time delay)> setRefreshEach;
+		Fn<void(const QString &address)> refreshNow;
+	};
+
+	explicit RefreshScheduler(Methods &&methods);
+
+	void addAccount(const QString &address);
+	void setCurrent(const QString &address);
+	void stateChanged(
+		const QString &address,
+		const Ton::WalletViewerState &state);
+	void setActive(bool active);
+	void setMinimized(bool minimized);
+	void userInput();
+
+	[[nodiscard]] rpl::producer<RefreshDecision> decisions() const;
+
+private:
+	struct Account {
+		crl::time lastRefresh = 0;
+		int64 balance = Ton::kUnknownBalance;
+		Ton::TransactionId lastTransactionId;
+		crl::time appliedDelay = 0;
+		int backoff = 0;
+		int jitter = 0;
+		bool refreshing = false;
+		bool sending = false;
+	};
+
+	void decide(RefreshReason reason);
+	void applyDelay(const QString &address, Account &account);
+	void setBackoff(Account &account, int backoff);
+	bool resetBackoff();
+	void refreshDue(crl::time now);
+	void refreshOverdue();
+	[[nodiscard]] bool sending() const;
+	[[nodiscard]] crl::time countDelay(const Account &account) const;
+
+	Methods _methods;
+	base::flat_map<QString, Account> _accounts;
+	QString _current;
+	bool _active = true;
+	bool _minimized = false;
+
+	rpl::event_stream<RefreshDecision> _decisions;
+
+};
+
+} // namespace Wallet
@@ -0,0 +1,184 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_search_index.h"
+
+#include "wallet/wallet_common.h"
+
+#include <unordered_set>
+
+namespace Wallet {
+namespace {
+
+constexpr auto kTrigramLength = 3;
+
+void RemoveFromList(std::vector<int64> &list, int64 lt) {
+	const auto i = ranges::find(list, lt);
+	if (i != end(list)) {
+		*i = list.back();
+		list.pop_back();
+	}
+}
+
+template <typename Key>
+void RemoveFromMap(
+		std::map<Key, std::vector<int64>> &map,
+		const Key &key,
+		int64 lt) {
+	const auto i = map.find(key);
+	if (i != end(map)) {
+		RemoveFromList(i->second, lt);
+		if (i->second.empty()) {
+			map.erase(i);
+		}
+	}
+}
+
+template <typename Callback>
+void EnumeratePrefixed(
+		const std::map<QString, std::vector<int64>> &map,
+		const QString &prefix,
+		Callback &&callback) {
+	for (auto i = map.lower_bound(prefix); i != end(map); ++i) {
+		if (!i->first.startsWith(prefix)) {
+			break;
+		}
+		for (const auto lt : i->second) {
+			callback(lt);
+		}
+	}
+}
+
+} // namespace
+
+void SearchIndex::add(const Ton::Transaction &data) {
+	const auto lt = data.id.lt;
+	if (!lt) {
+		return;
+	}
+	remove(lt);
+	auto entry = Entry{
+		ExtractAddress(data),
+		NormalizeComment(ExtractMessage(data))
+	};
+	if (!entry.address.isEmpty()) {
+		_addresses[entry.address].push_back(lt);
+	}
+	for (const auto trigram : CollectTrigrams(entry.comment)) {
+		_trigrams[trigram].push_back(lt);
+	}
+	for (const auto &word : CollectWords(entry.comment)) {
+		_words[word].push_back(lt);
+	}
+	_entries.emplace(lt, std::move(entry));
+}
+
+void SearchIndex::remove(int64 lt) {
+	const auto i = _entries.find(lt);
+	if (i == end(_entries)) {
+		return;
+	}
+	const auto &entry = i->second;
+	RemoveFromMap(_addresses, entry.address, lt);
+	for (const auto &word : CollectWords(entry.comment)) {
+		RemoveFromMap(_words, word, lt);
+	}
+	for (const auto trigram : CollectTrigrams(entry.comment)) {
+		const auto j = _trigrams.find(trigram);
+		Assert(j != end(_trigrams));
+		RemoveFromList(j->second, lt);
+		if (j->second.empty()) {
+			_trigrams.erase(j);
+		}
+	}
+	_entries.erase(i);
+}
+
+void SearchIndex::clear() {
+	_entries.clear();
+	_trigrams.clear();
+	_addresses.clear();
+	_words.clear();
+}
+
+std::vector<int64> SearchIndex::find(const QString &query) const {
+	const auto address = query.trimmed();
+	if (address.isEmpty()) {
+		return {};
+	}
+	auto result = std::unordered_set<int64>();
+	const auto match = [&](int64 lt) {
+		result.emplace(lt);
+	};
+	EnumeratePrefixed(_addresses, address, match);
+
+	const auto comment = NormalizeComment(query);
+	if (comment.size() < kTrigramLength) {
+		EnumeratePrefixed(_words, comment, match);
+		return { begin(result), end(result) };
+	}
+	auto candidates = static_cast<const std::vector<int64>*>(nullptr);
+	for (const auto trigram : CollectTrigrams(comment)) {
+		const auto i = _trigrams.find(trigram);
+		if (i == end(_trigrams)) {
+			candidates = nullptr;
+			break;
+		} else if (!candidates || i->second.size() < candidates->size()) {
+			candidates = &i->second;
+		}
+	}
+	if (candidates) {
+		for (const auto lt : *candidates) {
+			const auto i = _entries.find(lt);
+			Assert(i != end(_entries));
+			if (i->second.comment.contains(comment)) {
+				match(lt);
+			}
+		}
+	}
+	return { begin(result), end(result) };
+}
+
+QString SearchIndex::NormalizeComment(const QString &text) {
+	return text.simplified().toLower();
+}
+
+auto SearchIndex::CollectTrigrams(const QString &text)
+-> std::vector<Trigram> {
+	auto result = std::vector<Trigram>();
+	const auto count = text.size() - kTrigramLength + 1;
+	if (count <= 0) {
+		return result;
+	}
+	result.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		result.push_back((Trigram(text[i].unicode()) << 32)
+			| (Trigram(text[i + 1].unicode()) << 16)
+			| Trigram(text[i + 2].unicode()));
+	}
+	ranges::sort(result);
+	result.erase(ranges::unique(result), end(result));
+	return result;
+}
+
+std::vector<QString> SearchIndex::CollectWords(const QString &text) {
+	auto result = std::vector<QString>();
+	auto from = 0;
+	const auto size = text.size();
+	for (auto i = 0; i <= size; ++i) {
+		if (i < size && text[i].isLetterOrNumber()) {
+			continue;
+		} else if (i > from) {
+			result.push_back(text.mid(from, i - from));
+		}
+		from = i + 1;
+	}
+	ranges::sort(result);
+	result.erase(ranges::unique(result), end(result));
+	return result;
+}
+
+} // namespace Wallet
@@ -0,0 +1,52 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+
+#include <map>
+#include <unordered_map>
+
+namespace Wallet {
+
+// Search over the loaded transactions by counterparty address and comment.
+//
+// Addresses are kept sorted for exact and prefix lookups, comments are
+// split into trigrams, so a query checks only the transactions that have
+// the rarest trigram of it instead of every transaction. Queries shorter
+// than a trigram are looked up among the sorted comment words by prefix.
+class SearchIndex final {
+public:
+	// Adds a transaction or replaces the indexed one with the same lt.
+	void add(const Ton::Transaction &data);
+	void remove(int64 lt);
+	void clear();
+
+	// Lt values of all the found transactions, in no particular order.
+	[[nodiscard]] std::vector<int64> find(const QString &query) const;
+
+private:
+	using Trigram = uint64;
+	struct Entry {
+		QString address;
+		QString comment;
+	};
+
+	[[nodiscard]] static QString NormalizeComment(const QString &text);
+	[[nodiscard]] static std::vector<Trigram> CollectTrigrams(
+		const QString &text);
+	[[nodiscard]] static std::vector<QString> CollectWords(
+		const QString &text);
+
+	std::unordered_map<int64, Entry> _entries;
+	std::unordered_map<Trigram, std::vector<int64>> _trigrams;
+	std::map<QString, std::vector<int64>> _addresses;
+	std::map<QString, std::vector<int64>> _words;
+
+};
+
+} // namespace Wallet
@@ -9,6 +9,7 @@
 #include "wallet/wallet_phrases.h"
 #include "wallet/wallet_update_info.h"
 #include "wallet/wallet_common.h"
+#include "wallet/wallet_trace.h"
 #include "ton/ton_settings.h"
 #include "ui/widgets/buttons.h"
 #include "ui/widgets/checkbox.h"
@@ -199,6 +200,7 @@ void SettingsBox(
 		const Ton::Settings &settings,
 		UpdateInfo *updateInfo,
 		Fn<void(QString, Fn<void(QByteArray)>)> checkConfig,
+		Fn<void()> exportTrace,
 		Fn<void(Ton::Settings)> save) {
 	using namespace rpl::mappers;
 
@@ -342,6 +344,30 @@ void SettingsBox(
 			settings.test.blockchainName),
 		st::boxRowPadding);
 
+	box->addRow(
+		object_ptr<Ui::BoxContentDivider>(box),
+		st::walletSettingsDividerMargin);
+	AddBoxSubtitle(box, ph::lng_wallet_settings_diagnostics());
+	box->addRow(
+		object_ptr<Ui::SettingsButton>(
+			box,
+			ph::lng_wallet_settings_record_trace(),
+			st::defaultSettingsButton),
+		QMargins()
+	)->toggleOn(
+		rpl::single(Trace::Enabled())
+	)->toggledValue(
+	) | rpl::start_with_next([](bool toggled) {
+		Trace::SetEnabled(toggled);
+	}, box->lifetime());
+	box->addRow(
+		object_ptr<Ui::SettingsButton>(
+			box,
+			ph::lng_wallet_settings_export_trace(),
+			st::defaultSettingsButton),
+		QMargins()
+	)->addClickHandler(exportTrace);
+
 	net->setChangedCallback([=](int test) {
 		const auto &now = settings.net(test);
 		*modified = now.config;
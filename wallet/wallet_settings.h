@@ -22,6 +22,7 @@ void SettingsBox(
 	const Ton::Settings &settings,
 	UpdateInfo *updateInfo,
 	Fn<void(QString, Fn<void(QByteArray)>)> checkConfig,
+	Fn<void()> exportTrace,
 	Fn<void(Ton::Settings)> save);
 
 } // namespace Wallet
@@ -21,6 +21,15 @@ namespace Wallet {
 namespace {
 
 constexpr auto kMsInMinute = 60 * crl::time(1000);
+constexpr auto kShortAddressPart = 6;
+
+[[nodiscard]] QString ShortAddress(const QString &address) {
+	return (address.size() > 3 * kShortAddressPart)
+		? (address.left(kShortAddressPart)
+			+ QChar(0x2026)
+			+ address.right(kShortAddressPart))
+		: address;
+}
 
 [[nodiscard]] auto ToTopBarState(bool refreshing = false) {
 	return rpl::map([=](QString &&text) {
@@ -74,7 +83,8 @@ constexpr auto kMsInMinute = 60 * crl::time(1000);
 
 TopBar::TopBar(
 	not_null<Ui::RpWidget*> parent,
-	rpl::producer<TopBarState> state)
+	rpl::producer<TopBarState> state,
+	rpl::producer<TopBarAccounts> accounts)
 : _widgetParent(parent)
 , _widget(parent) {
 	parent->widthValue(
@@ -82,6 +92,12 @@ TopBar::TopBar(
 		_widget.setGeometry(0, 0, width, st::walletTopBarHeight);
 	}, lifetime());
 
+	std::move(
+		accounts
+	) | rpl::start_with_next([=](TopBarAccounts &&accounts) {
+		_accounts = std::move(accounts);
+	}, lifetime());
+
 	setupControls(std::move(state));
 }
 
@@ -89,6 +105,10 @@ rpl::producer<Action> TopBar::actionRequests() const {
 	return _actionRequests.events();
 }
 
+rpl::producer<int> TopBar::switchRequests() const {
+	return _switchRequests.events();
+}
+
 rpl::lifetime &TopBar::lifetime() {
 	return _widget.lifetime();
 }
@@ -168,6 +188,7 @@ void TopBar::showMenu(not_null<Ui::IconButton*> toggle) {
 		}
 	}));
 
+	fillAccounts(menu);
 	menu->addAction(ph::lng_wallet_menu_settings(ph::now), [=] {
 		_actionRequests.fire(Action::ShowSettings);
 	});
@@ -177,6 +198,12 @@ void TopBar::showMenu(not_null<Ui::IconButton*> toggle) {
 	menu->addAction(ph::lng_wallet_menu_export(ph::now), [=] {
 		_actionRequests.fire(Action::Export);
 	});
+	menu->addAction(ph::lng_wallet_menu_export_history(ph::now), [=] {
+		_actionRequests.fire(Action::ExportHistory);
+	});
+	menu->addAction(ph::lng_wallet_menu_payout(ph::now), [=] {
+		_actionRequests.fire(Action::Payout);
+	});
 	menu->addAction(ph::lng_wallet_menu_delete(ph::now), [=] {
 		_actionRequests.fire(Action::LogOut);
 	});
@@ -192,6 +219,26 @@ void TopBar::showMenu(not_null<Ui::IconButton*> toggle) {
 	menu->showAnimated(Ui::PanelAnimation::Origin::TopRight);
 }
 
+void TopBar::fillAccounts(not_null<Ui::DropdownMenu*> menu) {
+	const auto count = int(_accounts.addresses.size());
+	if (count < 2) {
+		return;
+	}
+	for (auto i = 0; i != count; ++i) {
+		const auto current = (i == _accounts.current);
+		const auto text = (current
+			? ph::lng_wallet_menu_account_current(ph::now)
+			: ph::lng_wallet_menu_account(ph::now)
+		).replace("{address}", ShortAddress(_accounts.addresses[i]));
+		menu->addAction(text, [=] {
+			if (!current) {
+				_switchRequests.fire_copy(i);
+			}
+		});
+	}
+	menu->addSeparator();
+}
+
 rpl::producer<TopBarState> MakeTopBarState(
 		rpl::producer<Ton::WalletViewerState> &&state,
 		rpl::producer<Ton::Update> &&updates,
@@ -27,21 +27,33 @@ struct TopBarState {
 	bool refreshing = false;
 };
 
+struct TopBarAccounts {
+	std::vector<QString> addresses;
+	int current = -1;
+};
+
 class TopBar final {
 public:
-	TopBar(not_null<Ui::RpWidget*> parent, rpl::producer<TopBarState> state);
+	TopBar(
+		not_null<Ui::RpWidget*> parent,
+		rpl::producer<TopBarState> state,
+		rpl::producer<TopBarAccounts> accounts);
 
 	[[nodiscard]] rpl::producer<Action> actionRequests() const;
+	[[nodiscard]] rpl::producer<int> switchRequests() const;
 
 	[[nodiscard]] rpl::lifetime &lifetime();
 
 private:
 	void setupControls(rpl::producer<TopBarState> &&state);
 	void showMenu(not_null<Ui::IconButton*> toggle);
+	void fillAccounts(not_null<Ui::DropdownMenu*> menu);
 
 	const not_null<Ui::RpWidget*> _widgetParent;
 	Ui::RpWidget _widget;
+	TopBarAccounts _accounts;
 	rpl::event_stream<Action> _actionRequests;
+	rpl::event_stream<int> _switchRequests;
 	base::unique_qptr<Ui::DropdownMenu> _menu;
 
 };
@@ -0,0 +1,153 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_trace.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <chrono>
+#include <deque>
+
+namespace Wallet::Trace {
+namespace {
+
+constexpr auto kMaxEvents = 65536;
+constexpr auto kCategory = "wallet";
+
+struct Event {
+	const char *name = nullptr;
+	char phase = 0;
+	int64 start = 0;
+	int64 duration = 0;
+	uint64 id = 0;
+	Tags tags;
+};
+
+std::deque<Event> Events;
+base::flat_map<uint64, const char*> Started;
+uint64 LastId = 0;
+bool Recording = false;
+
+[[nodiscard]] int64 Now() {
+	using namespace std::chrono;
+	static const auto start = steady_clock::now();
+	return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+void Push(Event &&event) {
+	Events.push_back(std::move(event));
+	if (int(Events.size()) > kMaxEvents) {
+		Events.pop_front();
+	}
+}
+
+[[nodiscard]] QJsonObject Serialize(const Tags &tags) {
+	auto result = QJsonObject();
+	if (!tags.key.isEmpty()) {
+		result.insert("key", tags.key);
+	}
+	if (tags.operation) {
+		result.insert("operation", QString::fromLatin1(tags.operation));
+	}
+	if (tags.size >= 0) {
+		result.insert("size", double(tags.size));
+	}
+	return result;
+}
+
+[[nodiscard]] QJsonObject Serialize(const Event &event) {
+	auto result = QJsonObject();
+	result.insert("name", QString::fromLatin1(event.name));
+	result.insert("cat", kCategory);
+	result.insert("ph", QString(QChar::fromLatin1(event.phase)));
+	result.insert("ts", double(event.start));
+	result.insert("pid", double(QCoreApplication::applicationPid()));
+	result.insert("tid", 1);
+	if (event.phase == 'X') {
+		result.insert("dur", double(event.duration));
+	} else {
+		result.insert("id", QString::number(event.id, 16).prepend("0x"));
+	}
+	const auto args = Serialize(event.tags);
+	if (!args.isEmpty()) {
+		result.insert("args", args);
+	}
+	return result;
+}
+
+} // namespace
+
+Scope::Scope(const char *name, Tags tags)
+: _name(Recording ? name : nullptr)
+, _tags(Recording ? std::move(tags) : Tags())
+, _start(Recording ? Now() : 0) {
+}
+
+Scope::~Scope() {
+	if (!_name) {
+		return;
+	}
+	auto event = Event();
+	event.name = _name;
+	event.phase = 'X';
+	event.start = _start;
+	event.duration = Now() - _start;
+	event.tags = std::move(_tags);
+	Push(std::move(event));
+}
+
+bool Enabled() {
+	return Recording;
+}
+
+void SetEnabled(bool enabled) {
+	Recording = enabled;
+}
+
+uint64 Begin(const char *name, Tags tags) {
+	if (!Recording) {
+		return 0;
+	}
+	const auto id = ++LastId;
+	auto event = Event();
+	event.name = name;
+	event.phase = 'b';
+	event.start = Now();
+	event.id = id;
+	event.tags = std::move(tags);
+	Push(std::move(event));
+	Started.emplace(id, name);
+	return id;
+}
+
+void End(uint64 id) {
+	const auto i = Started.find(id);
+	if (i == end(Started)) {
+		return;
+	}
+	auto event = Event();
+	event.name = i->second;
+	event.phase = 'e';
+	event.start = Now();
+	event.id = id;
+	Started.erase(i);
+	Push(std::move(event));
+}
+
+QByteArray ExportJson() {
+	auto events = QJsonArray();
+	for (const auto &event : Events) {
+		events.push_back(Serialize(event));
+	}
+	auto result = QJsonObject();
+	result.insert("traceEvents", events);
+	result.insert("displayTimeUnit", "ms");
+	return QJsonDocument(result).toJson(QJsonDocument::Compact);
+}
+
+} // namespace Wallet::Trace
@@ -0,0 +1,69 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+namespace Wallet::Trace {
+
+// Spans are kept in memory, the oldest ones are dropped after a limit,
+// and are exported in the Chrome Trace Event format on request.
+//
+// Nothing is recorded until it is enabled from the settings, all the
+// spans are recorded on the main thread.
+struct Tags {
+	QString key;
+	const char *operation = nullptr;
+	int64 size = -1;
+};
+
+[[nodiscard]] inline Tags Sized(int64 size) {
+	auto result = Tags();
+	result.size = size;
+	return result;
+}
+
+// Synchronous span, ends when the scope is left. Nested scopes are shown
+// nested in the trace viewer.
+class Scope final {
+public:
+	explicit Scope(const char *name, Tags tags = Tags());
+	Scope(const Scope &other) = delete;
+	Scope &operator=(const Scope &other) = delete;
+	~Scope();
+
+private:
+	const char *_name = nullptr;
+	Tags _tags;
+	int64 _start = 0;
+
+};
+
+[[nodiscard]] bool Enabled();
+void SetEnabled(bool enabled);
+
+// Asynchronous span, ends with End(id) called with the returned id.
+[[nodiscard]] uint64 Begin(const char *name, Tags tags = Tags());
+void End(uint64 id);
+
+// Wraps a completion callback so that the span ends when it is called.
+template <typename Callback>
+[[nodiscard]] auto Wrap(const char *name, Tags tags, Callback &&callback) {
+	const auto id = Begin(name, std::move(tags));
+	return [=, callback = std::forward<Callback>(callback)](
+			auto &&...args) mutable {
+		End(id);
+		return callback(std::forward<decltype(args)>(args)...);
+	};
+}
+
+[[nodiscard]] QByteArray ExportJson();
+
+} // namespace Wallet::Trace
+
+#define WALLET_TRACE_CONCAT(a, b) a##b
+#define WALLET_TRACE_NAME(line) WALLET_TRACE_CONCAT(walletTrace, line)
+#define WALLET_TRACE_SCOPE(...) \
+	const auto WALLET_TRACE_NAME(__LINE__) = ::Wallet::Trace::Scope(__VA_ARGS__)
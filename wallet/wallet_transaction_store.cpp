@@ -0,0 +1,379 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#include "wallet/wallet_transaction_store.h"
+
+namespace Wallet {
+namespace {
+
+// Approximate size of the shared data header of QString and QByteArray.
+constexpr auto kArrayHeaderSize = int64(24);
+
+// Released message slots are compacted only when there are enough of them.
+constexpr auto kCompactMinimum = 256;
+
+[[nodiscard]] int64 PayloadBytes(const QString &value) {
+	return value.isEmpty()
+		? 0
+		: (kArrayHeaderSize + (int64(value.capacity()) + 1) * 2);
+}
+
+[[nodiscard]] int64 PayloadBytes(const QByteArray &value) {
+	return value.isEmpty()
+		? 0
+		: (kArrayHeaderSize + int64(value.capacity()) + 1);
+}
+
+[[nodiscard]] int64 PayloadBytes(const Ton::Message &message) {
+	return PayloadBytes(message.source)
+		+ PayloadBytes(message.destination)
+		+ PayloadBytes(message.bodyHash)
+		+ PayloadBytes(message.message.text)
+		+ PayloadBytes(message.message.encrypted);
+}
+
+template <typename Container>
+[[nodiscard]] int64 ColumnBytes(const Container &column) {
+	return int64(column.size()) * sizeof(typename Container::value_type);
+}
+
+template <typename Container>
+[[nodiscard]] int64 PayloadsBytes(const Container &column) {
+	auto result = int64();
+	for (const auto &value : column) {
+		result += PayloadBytes(value);
+	}
+	return result;
+}
+
+} // namespace
+
+StringPool::StringPool() {
+	clear();
+}
+
+int StringPool::intern(const QString &value) {
+	if (value.isEmpty()) {
+		return 0;
+	}
+	const auto i = _indices.constFind(value);
+	if (i != _indices.cend()) {
+		return i.value();
+	}
+	const auto result = int(_values.size());
+	_values.push_back(value);
+	_indices.insert(value, result);
+	_bytes += sizeof(QString) + PayloadBytes(value) + sizeof(int);
+	return result;
+}
+
+const QString &StringPool::value(int index) const {
+	Expects(index >= 0 && index < _values.size());
+
+	return _values[index];
+}
+
+int64 StringPool::bytes() const {
+	return _bytes;
+}
+
+void StringPool::clear() {
+	_indices.clear();
+	_values.clear();
+	_values.push_back(QString());
+	_bytes = 0;
+}
+
+int TransactionStore::Messages::size() const {
+	return int(source.size());
+}
+
+int64 TransactionStore::Messages::bytes() const {
+	return ColumnBytes(source)
+		+ ColumnBytes(destination)
+		+ ColumnBytes(value)
+		+ ColumnBytes(created)
+		+ ColumnBytes(bodyHash)
+		+ ColumnBytes(refs)
+		+ int64(decrypted.size() / 8)
+		+ ColumnBytes(texts)
+		+ PayloadsBytes(texts)
+		+ ColumnBytes(encrypted)
+		+ PayloadsBytes(encrypted);
+}
+
+int TransactionStore::size() const {
+	return int(_lt.size());
+}
+
+bool TransactionStore::empty() const {
+	return _lt.empty();
+}
+
+Ton::TransactionId TransactionStore::id(int index) const {
+	Expects(index >= 0 && index < size());
+
+	auto result = Ton::TransactionId();
+	result.lt = _lt[index];
+	result.hash = unpack(_hash[index]);
+	return result;
+}
+
+Ton::Transaction TransactionStore::get(int index) const {
+	Expects(index >= 0 && index < size());
+
+	auto result = Ton::Transaction();
+	result.id = id(index);
+	result.time = _time[index];
+	result.fee = _fee[index];
+	result.storageFee = _storageFee[index];
+	result.otherFee = _otherFee[index];
+	result.initializing = _initializing[index];
+	const auto first = _firstMessage[index];
+	result.incoming = message(first);
+	result.outgoing.reserve(_outgoingCount[index]);
+	for (auto i = 0; i != _outgoingCount[index]; ++i) {
+		result.outgoing.push_back(message(first + 1 + i));
+	}
+	return result;
+}
+
+void TransactionStore::insert(int index, Iterator from, Iterator till) {
+	Expects(index >= 0 && index <= size());
+
+	auto firstMessages = std::vector<int>();
+	firstMessages.reserve(till - from);
+	for (auto i = from; i != till; ++i) {
+		Assert(i->outgoing.size() <= std::numeric_limits<ushort>::max());
+
+		firstMessages.push_back(addMessage(i->incoming));
+		for (const auto &message : i->outgoing) {
+			addMessage(message);
+		}
+		_plainBytes += CountBytes(*i);
+	}
+	const auto column = [&](auto &target, auto &&field) {
+		const auto values = ranges::make_subrange(
+			from,
+			till
+		) | ranges::view::transform(field) | ranges::to_vector;
+		target.insert(begin(target) + index, begin(values), end(values));
+	};
+	column(_lt, [](const Ton::Transaction &data) { return data.id.lt; });
+	column(_hash, [&](const Ton::Transaction &data) {
+		return pack(data.id.hash);
+	});
+	column(_time, &Ton::Transaction::time);
+	column(_fee, &Ton::Transaction::fee);
+	column(_storageFee, &Ton::Transaction::storageFee);
+	column(_otherFee, &Ton::Transaction::otherFee);
+	column(_outgoingCount, [](const Ton::Transaction &data) {
+		return ushort(data.outgoing.size());
+	});
+	column(_initializing, &Ton::Transaction::initializing);
+	_firstMessage.insert(
+		begin(_firstMessage) + index,
+		begin(firstMessages),
+		end(firstMessages));
+}
+
+void TransactionStore::replace(int index, const Ton::Transaction &data) {
+	Expects(index >= 0 && index < size());
+	Expects(data.id.lt == _lt[index]);
+	Expects(data.outgoing.size() <= std::numeric_limits<ushort>::max());
+
+	_plainBytes += CountBytes(data) - CountBytes(get(index));
+	_time[index] = data.time;
+	_fee[index] = data.fee;
+	_storageFee[index] = data.storageFee;
+	_otherFee[index] = data.otherFee;
+	_initializing[index] = data.initializing;
+
+	// Usually only the comment is decrypted, update it in place.
+	const auto was = int(_outgoingCount[index]);
+	const auto now = int(data.outgoing.size());
+	if (now > was) {
+		releaseMessages(_firstMessage[index], 1 + was);
+		_firstMessage[index] = addMessage(data.incoming);
+		for (const auto &message : data.outgoing) {
+			addMessage(message);
+		}
+	} else {
+		const auto first = _firstMessage[index];
+		setMessage(first, data.incoming);
+		for (auto i = 0; i != now; ++i) {
+			setMessage(first + 1 + i, data.outgoing[i]);
+		}
+		releaseMessages(first + 1 + now, was - now);
+	}
+	_outgoingCount[index] = ushort(now);
+
+	if (_releasedMessages >= kCompactMinimum
+		&& _releasedMessages * 2 >= _messages.size()) {
+		compactMessages();
+	}
+}
+
+void TransactionStore::clear() {
+	*this = TransactionStore();
+}
+
+int64 TransactionStore::bytes() const {
+	return ColumnBytes(_lt)
+		+ ColumnBytes(_hash)
+		+ ColumnBytes(_time)
+		+ ColumnBytes(_fee)
+		+ ColumnBytes(_storageFee)
+		+ ColumnBytes(_otherFee)
+		+ ColumnBytes(_firstMessage)
+		+ ColumnBytes(_outgoingCount)
+		+ ColumnBytes(_initializing)
+		+ _messages.bytes()
+		+ ColumnBytes(_longHashes)
+		+ PayloadsBytes(_longHashes)
+		+ _addresses.bytes();
+}
+
+int64 TransactionStore::plainBytes() const {
+	return _plainBytes;
+}
+
+auto TransactionStore::pack(const QByteArray &value) -> Hash {
+	auto result = Hash();
+	if (value.size() == kHashSize) {
+		std::copy(value.begin(), value.end(), result.bytes.begin());
+		result.size = kHashSize;
+	} else if (!value.isEmpty()) {
+		result.size = -1 - int(_longHashes.size());
+		_longHashes.push_back(value);
+	}
+	return result;
+}
+
+QByteArray TransactionStore::unpack(const Hash &hash) const {
+	if (hash.size < 0) {
+		return _longHashes[-1 - hash.size];
+	}
+	return QByteArray(hash.bytes.data(), hash.size);
+}
+
+int TransactionStore::addMessage(const Ton::Message &message) {
+	const auto result = _messages.size();
+	_messages.source.push_back(_addresses.intern(message.source));
+	_messages.destination.push_back(_addresses.intern(message.destination));
+	_messages.value.push_back(message.value);
+	_messages.created.push_back(message.created);
+	_messages.bodyHash.push_back(pack(message.bodyHash));
+	_messages.refs.emplace_back();
+	_messages.decrypted.push_back(false);
+	setMessage(result, message);
+	return result;
+}
+
+void TransactionStore::setMessage(int index, const Ton::Message &message) {
+	Expects(index >= 0 && index < _messages.size());
+
+	_messages.source[index] = _addresses.intern(message.source);
+	_messages.destination[index] = _addresses.intern(message.destination);
+	_messages.value[index] = message.value;
+	_messages.created[index] = message.created;
+	if (unpack(_messages.bodyHash[index]) != message.bodyHash) {
+		_messages.bodyHash[index] = pack(message.bodyHash);
+	}
+
+	const auto &data = message.message;
+	auto &ref = _messages.refs[index];
+	if (ref.text >= 0) {
+		_messages.texts[ref.text] = data.text;
+	} else if (!data.text.isEmpty()) {
+		ref.text = int(_messages.texts.size());
+		_messages.texts.push_back(data.text);
+	}
+	if (ref.encrypted >= 0) {
+		_messages.encrypted[ref.encrypted] = data.encrypted;
+	} else if (!data.encrypted.isEmpty()) {
+		ref.encrypted = int(_messages.encrypted.size());
+		_messages.encrypted.push_back(data.encrypted);
+	}
+	_messages.decrypted[index] = data.decrypted;
+}
+
+void TransactionStore::releaseMessages(int from, int count) {
+	Expects(from >= 0 && count >= 0 && from + count <= _messages.size());
+
+	// The slots stay until the next compaction, the payloads go now.
+	for (auto i = from; i != from + count; ++i) {
+		const auto &ref = _messages.refs[i];
+		if (ref.text >= 0) {
+			_messages.texts[ref.text] = QString();
+		}
+		if (ref.encrypted >= 0) {
+			_messages.encrypted[ref.encrypted] = QByteArray();
+		}
+	}
+	_releasedMessages += count;
+}
+
+void TransactionStore::compactMessages() {
+	auto was = std::exchange(_messages, Messages());
+	const auto move = [&](int index) {
+		_messages.source.push_back(was.source[index]);
+		_messages.destination.push_back(was.destination[index]);
+		_messages.value.push_back(was.value[index]);
+		_messages.created.push_back(was.created[index]);
+		_messages.bodyHash.push_back(was.bodyHash[index]);
+		_messages.decrypted.push_back(was.decrypted[index]);
+		auto ref = MessageRef();
+		if (const auto text = was.refs[index].text; text >= 0) {
+			ref.text = int(_messages.texts.size());
+			_messages.texts.push_back(std::move(was.texts[text]));
+		}
+		if (const auto encrypted = was.refs[index].encrypted; encrypted >= 0) {
+			ref.encrypted = int(_messages.encrypted.size());
+			_messages.encrypted.push_back(std::move(was.encrypted[encrypted]));
+		}
+		_messages.refs.push_back(ref);
+	};
+	for (auto i = 0, count = size(); i != count; ++i) {
+		const auto first = std::exchange(_firstMessage[i], _messages.size());
+		for (auto j = 0; j != 1 + _outgoingCount[i]; ++j) {
+			move(first + j);
+		}
+	}
+	_releasedMessages = 0;
+}
+
+Ton::Message TransactionStore::message(int index) const {
+	Expects(index >= 0 && index < _messages.size());
+
+	auto result = Ton::Message();
+	result.source = _addresses.value(_messages.source[index]);
+	result.destination = _addresses.value(_messages.destination[index]);
+	result.value = _messages.value[index];
+	result.created = _messages.created[index];
+	result.bodyHash = unpack(_messages.bodyHash[index]);
+	const auto &ref = _messages.refs[index];
+	if (ref.text >= 0) {
+		result.message.text = _messages.texts[ref.text];
+	}
+	if (ref.encrypted >= 0) {
+		result.message.encrypted = _messages.encrypted[ref.encrypted];
+	}
+	result.message.decrypted = _messages.decrypted[index];
+	return result;
+}
+
+int64 TransactionStore::CountBytes(const Ton::Transaction &data) {
+	auto result = int64(sizeof(Ton::Transaction))
+		+ PayloadBytes(data.id.hash)
+		+ PayloadBytes(data.incoming);
+	for (const auto &message : data.outgoing) {
+		result += sizeof(Ton::Message) + PayloadBytes(message);
+	}
+	return result;
+}
+
+} // namespace Wallet
@@ -0,0 +1,121 @@
+// This file is part of Desktop App Toolkit,
+// a set of libraries for developing nice desktop applications.
+//
+// For license and copyright information please follow this link:
+// https://github.com/desktop-app/legal/blob/master/LEGAL
+//
+#pragma once
+
+#include "ton/ton_state.h"
+
+#include <QtCore/QHash>
+#include <array>
+#include <deque>
+
+namespace Wallet {
+
+// Strings that repeat a lot, like addresses, kept once and used by index.
+class StringPool final {
+public:
+	StringPool();
+
+	[[nodiscard]] int intern(const QString &value);
+	[[nodiscard]] const QString &value(int index) const;
+	[[nodiscard]] int64 bytes() const;
+	void clear();
+
+private:
+	QHash<QString, int> _indices;
+	std::vector<QString> _values;
+	int64 _bytes = 0;
+
+};
+
+// Loaded transactions, newest first, stored by columns.
+//
+// Numbers and hashes are kept in packed columns, addresses are interned and
+// comments and encrypted bodies are kept out of line only for the messages
+// that have them. A Ton::Transaction is built back only when it is needed.
+//
+// Messages of a replaced transaction are rewritten in place when they fit,
+// otherwise their slots are released and the message columns are compacted
+// once the released slots make up half of them.
+class TransactionStore final {
+public:
+	using Iterator = std::vector<Ton::Transaction>::const_iterator;
+
+	[[nodiscard]] int size() const;
+	[[nodiscard]] bool empty() const;
+	[[nodiscard]] Ton::TransactionId id(int index) const;
+	[[nodiscard]] Ton::Transaction get(int index) const;
+
+	void insert(int index, Iterator from, Iterator till);
+	void replace(int index, const Ton::Transaction &data);
+	void clear();
+
+	// Estimated memory used by the store and by the same transactions
+	// if they were kept as a std::vector<Ton::Transaction>.
+	[[nodiscard]] int64 bytes() const;
+	[[nodiscard]] int64 plainBytes() const;
+
+private:
+	static constexpr auto kHashSize = 32;
+
+	// A hash of any other size is kept out of line, size is -1 - index.
+	struct Hash {
+		std::array<char, kHashSize> bytes = {};
+		int size = 0;
+	};
+	struct MessageRef {
+		int text = -1;
+		int encrypted = -1;
+	};
+
+	// Messages, the incoming one followed by the outgoing ones.
+	struct Messages {
+		std::vector<int> source;
+		std::vector<int> destination;
+		std::vector<int64> value;
+		std::vector<TimeId> created;
+		std::vector<Hash> bodyHash;
+		std::vector<MessageRef> refs;
+		std::vector<bool> decrypted;
+
+		// Out of line payloads.
+		std::vector<QString> texts;
+		std::vector<QByteArray> encrypted;
+
+		[[nodiscard]] int size() const;
+		[[nodiscard]] int64 bytes() const;
+	};
+
+	[[nodiscard]] Hash pack(const QByteArray &value);
+	[[nodiscard]] QByteArray unpack(const Hash &hash) const;
+	[[nodiscard]] int addMessage(const Ton::Message &message);
+	void setMessage(int index, const Ton::Message &message);
+	void releaseMessages(int from, int count);
+	void compactMessages();
+	[[nodiscard]] Ton::Message message(int index) const;
+	[[nodiscard]] static int64 CountBytes(const Ton::Transaction &data);
+
+	// Transactions.
+	std::deque<int64> _lt;
+	std::deque<Hash> _hash;
+	std::deque<TimeId> _time;
+	std::deque<int64> _fee;
+	std::deque<int64> _storageFee;
+	std::deque<int64> _otherFee;
+	std::deque<int> _firstMessage;
+	std::deque<ushort> _outgoingCount;
+	std::deque<bool> _initializing;
+
+	Messages _messages;
+	int _releasedMessages = 0;
+
+	std::vector<QByteArray> _longHashes;
+	StringPool _addresses;
+	int64 _plainBytes = 0;
+
+};
+
+} // namespace Wallet
@@ -7,6 +7,7 @@
 #include "wallet/wallet_view_transaction.h"
 
 #include "wallet/wallet_common.h"
+#include "wallet/wallet_decrypt_queue.h"
 #include "wallet/wallet_phrases.h"
 #include "ui/amount_label.h"
 #include "ui/address_label.h"
@@ -146,8 +147,7 @@ void SetupScrollByDrag(
 void ViewTransactionBox(
 		not_null<Ui::GenericBox*> box,
 		Ton::Transaction &&data,
-		rpl::producer<
-			not_null<std::vector<Ton::Transaction>*>> collectEncrypted,
+		rpl::producer<not_null<DecryptChunk*>> collectEncrypted,
 		rpl::producer<
 			not_null<const std::vector<Ton::Transaction>*>> decrypted,
 		Fn<void(QImage, QString)> share,
@@ -265,11 +265,22 @@ void ViewTransactionBox(
 
 			std::move(
 				collectEncrypted
-			) | rpl::take(
+			) | rpl::filter([=](not_null<DecryptChunk*> chunk) {
+				return !chunk->skip.contains(data.id.lt);
+			}) | rpl::take(
 				1
-			) | rpl::start_with_next([=](
-				not_null<std::vector<Ton::Transaction>*> list) {
-				list->push_back(data);
+			) | rpl::start_with_next([=](not_null<DecryptChunk*> chunk) {
+				// The opened transaction goes first.
+				auto &list = chunk->list;
+				const auto i = ranges::find(
+					list,
+					data.id,
+					&Ton::Transaction::id);
+				if (i != end(list)) {
+					std::rotate(begin(list), i, i + 1);
+				} else {
+					list.insert(begin(list), data);
+				}
 			}, comment->lifetime());
 
 			comment->setClickHandlerFilter([=](const auto &...) {
@@ -7,8 +7,19 @@
 #include "wallet/wallet_window.h"
 
 #include "wallet/wallet_phrases.h"
+#include "wallet/wallet_backend_ton.h"
 #include "wallet/wallet_common.h"
 #include "wallet/wallet_info.h"
+#include "wallet/wallet_decrypt_queue.h"
+#include "wallet/wallet_history.h"
+#include "wallet/wallet_history_export.h"
+#include "wallet/wallet_local_history.h"
+#include "wallet/wallet_payout.h"
+#include "wallet/wallet_comments_cache.h"
+#include "wallet/wallet_config_stamp.h"
+#include "wallet/wallet_refresh_scheduler.h"
+#include "wallet/wallet_log.h"
+#include "wallet/wallet_trace.h"
 #include "wallet/wallet_view_transaction.h"
 #include "wallet/wallet_receive_grams.h"
 #include "wallet/wallet_create_invoice.h"
@@ -25,11 +36,11 @@
 #include "wallet/wallet_update_info.h"
 #include "wallet/create/wallet_create_manager.h"
 #include "ton/ton_wallet.h"
-#include "ton/ton_account_viewer.h"
 #include "base/platform/base_platform_process.h"
 #include "base/qt_signal_producer.h"
-#include "base/last_user_input.h"
+#include "base/event_filter.h"
 #include "base/algorithm.h"
+#include "base/unixtime.h"
 #include "ui/address_label.h"
 #include "ui/widgets/window.h"
 #include "ui/widgets/labels.h"
@@ -44,7 +55,7 @@
 
 #include <QtCore/QMimeData>
 #include <QtCore/QDir>
-#include <QtCore/QRegularExpression>
+#include <QtCore/QStandardPaths>
 #include <QtGui/QtEvents>
 #include <QtGui/QClipboard>
 #include <QtGui/QGuiApplication>
@@ -56,27 +67,52 @@
 namespace Wallet {
 namespace {
 
-constexpr auto kRefreshEachDelay = 10 * crl::time(1000);
-constexpr auto kRefreshInactiveDelay = 60 * crl::time(1000);
-constexpr auto kRefreshWhileSendingDelay = 3 * crl::time(1000);
-
-[[nodiscard]] bool ValidateTransferLink(const QString &link) {
-	return QRegularExpression(
-		QString("^((ton://)?transfer/)?[a-z0-9_\\-]{%1}/?($|\\?)"
-		).arg(kAddressLength),
-		QRegularExpression::CaseInsensitiveOption
-	).match(link.trimmed()).hasMatch();
-}
+constexpr auto kHistoryCacheLimit = int64(32 * 1024 * 1024);
+constexpr auto kPayoutSearchLimit = 64;
+constexpr auto kPayoutSearchMargin = TimeId(600);
 
 } // namespace
 
+struct Window::Account {
+	QByteArray publicKey;
+	QString address;
+	std::unique_ptr<BackendViewer> viewer;
+	std::unique_ptr<LocalHistory> localHistory;
+	std::unique_ptr<CommentsCache> commentsCache;
+	rpl::variable<Ton::WalletState> state;
+	rpl::event_stream<Ton::TransactionsSlice> localHistoryLoaded;
+	rpl::event_stream<Ton::LoadedSlice> localSliceLoaded;
+	rpl::event_stream<
+		not_null<DecryptChunk*>> collectEncryptedRequests;
+	rpl::event_stream<
+		not_null<const std::vector<Ton::Transaction>*>> decrypted;
+	rpl::event_stream<not_null<HistoryChunk*>> collectHistoryRequests;
+
+	// Destroyed first, while the streams and the viewer are still alive.
+	std::unique_ptr<DecryptQueue> decryptQueue;
+	std::unique_ptr<Info> info;
+	rpl::lifetime lifetime;
+};
+
 Window::Window(
 	not_null<Ton::Wallet*> wallet,
-	UpdateInfo *updateInfo)
-: _wallet(wallet)
+	UpdateInfo *updateInfo,
+	const QString &localFolder)
+: Window(std::make_unique<TonBackend>(wallet), updateInfo, localFolder) {
+}
+
+Window::Window(
+	std::unique_ptr<Backend> backend,
+	UpdateInfo *updateInfo,
+	const QString &localFolder)
+: _wallet(std::move(backend))
 , _window(std::make_unique<Ui::Window>())
 , _layers(std::make_unique<Ui::LayerManager>(_window->body()))
-, _updateInfo(updateInfo) {
+, _updateInfo(updateInfo)
+, _localFolder(localFolder.isEmpty()
+	? (QStandardPaths::writableLocation(
+		QStandardPaths::AppLocalDataLocation) + "/wallet")
+	: localFolder) {
 	init();
 	const auto keys = _wallet->publicKeys();
 	if (keys.empty()) {
@@ -111,24 +147,60 @@ void Window::startWallet() {
 	if (was.useCustomConfig) {
 		return;
 	}
+	const auto path = ConfigStampPath(
+		_localFolder,
+		_wallet->settings().useTestNetwork);
+	const auto stamp = ReadConfigStamp(path);
+	const auto known = ConfigHash(was.config);
+
+	// The settings may have been saved without updating the stamp,
+	// its fetch time is trusted only if it describes the stored config.
+	const auto stamped = (stamp.url == was.configUrl)
+		&& !known.isEmpty()
+		&& (stamp.hash == known);
+	if (!stamped && !stamp.hash.isEmpty()) {
+		WALLET_LOG(("Config: stamp doesn't match the stored config."));
+	}
+	const auto fetched = stamped ? stamp.fetched : TimeId(0);
+
+	// Sync starts from the stored config, the fresh one is only waited
+	// for when there is nothing stored yet.
+	const auto cached = !known.isEmpty();
+	if (cached && _wallet->publicKeys().empty()) {
+		_wallet->sync();
+	}
 	const auto loaded = [=](Ton::Result<QByteArray> result) {
+		const auto hash = result ? ConfigHash(*result) : QByteArray();
 		auto copy = _wallet->settings();
-		if (result
+		const auto changed = !hash.isEmpty()
+			&& (hash != known)
 			&& !copy.net().useCustomConfig
-			&& copy.net().configUrl == was.configUrl
-			&& *result != copy.net().config) {
+			&& copy.net().configUrl == was.configUrl;
+		if (changed) {
+			WALLET_LOG(("Config: changed since %1, applying."
+				).arg(fetched));
 			copy.net().config = *result;
 			saveSettingsSure(copy, [=] {
-				if (_viewer) {
+				const auto now = base::unixtime::now();
+				WriteConfigStamp(path, { was.configUrl, hash, now });
+				if (_account) {
 					refreshNow();
+				} else {
+					_wallet->sync();
 				}
 			});
+			return;
+		} else if (!hash.isEmpty() && hash == known) {
+			const auto now = base::unixtime::now();
+			WriteConfigStamp(path, { was.configUrl, hash, now });
 		}
-		if (!_viewer) {
+		if (!cached && !_account) {
 			_wallet->sync();
 		}
 	};
-	_wallet->loadWebResource(was.configUrl, std::move(loaded));
+	_wallet->loadWebResource(
+		was.configUrl,
+		Trace::Wrap("loadWebResource", { was.configUrl }, loaded));
 }
 
 void Window::updatePalette() {
@@ -140,8 +212,13 @@ void Window::updatePalette() {
 
 void Window::showCreate() {
 	_layers->hideAll();
-	_info = nullptr;
-	_viewer = nullptr;
+	_historyExporter = nullptr;
+	_payout = nullptr;
+	_accountsLifetime.destroy();
+	_account = nullptr;
+	_accounts.clear();
+	_addresses = std::vector<QString>();
+	_refreshScheduler = nullptr;
 	_updateButton.destroy();
 
 	_window->setTitleStyle(st::defaultWindowTitle);
@@ -200,7 +277,7 @@ void Window::createImportKey(const std::vector<QString> &words) {
 	if (std::exchange(_importing, true)) {
 		return;
 	}
-	_wallet->importKey(words, crl::guard(this, [=](Ton::Result<> result) {
+	const auto done = [=](Ton::Result<> result) {
 		if (result) {
 			_createSyncing = rpl::event_stream<QString>();
 			_createManager->showPasscode(_createSyncing.events());
@@ -211,7 +288,11 @@ void Window::createImportKey(const std::vector<QString> &words) {
 			_importing = false;
 			showGenericError(result.error());
 		}
-	}));
+	};
+	_wallet->importKey(words, Trace::Wrap(
+		"importKey",
+		Trace::Sized(words.size()),
+		crl::guard(this, done)));
 }
 
 void Window::createKey(std::shared_ptr<bool> guard) {
@@ -224,7 +305,8 @@ void Window::createKey(std::shared_ptr<bool> guard) {
 		*guard = false;
 		_createManager->showCreated(std::move(*result));
 	};
-	_wallet->createKey(crl::guard(this, done));
+	_wallet->createKey(
+		Trace::Wrap("createKey", {}, crl::guard(this, done)));
 }
 
 void Window::createShowIncorrectWords() {
@@ -373,7 +455,8 @@ void Window::createSavePasscode(
 		}
 		createSaveKey(passcode, *result, guard);
 	};
-	_wallet->queryWalletAddress(crl::guard(this, done));
+	_wallet->queryWalletAddress(
+		Trace::Wrap("queryWalletAddress", {}, crl::guard(this, done)));
 }
 
 void Window::createSaveKey(
@@ -388,7 +471,10 @@ void Window::createSaveKey(
 		}
 		_createManager->showReady(*result);
 	};
-	_wallet->saveKey(passcode, address, crl::guard(this, done));
+	_wallet->saveKey(
+		passcode,
+		address,
+		Trace::Wrap("saveKey", { address }, crl::guard(this, done)));
 }
 
 void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
@@ -396,11 +482,41 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
 	_importing = false;
 	_createManager = nullptr;
 
-	_address = _wallet->getUsedAddress(publicKey);
-	_viewer = _wallet->createAccountViewer(publicKey, _address);
-	_state = _viewer->state() | rpl::map([](Ton::WalletViewerState &&state) {
-		return std::move(state.wallet);
-	});
+	if (_accounts.empty()) {
+		_window->setTitleStyle(st::walletWindowTitle);
+		setupAccounts();
+		for (const auto &key : _wallet->publicKeys()) {
+			createAccount(key);
+		}
+	}
+	const auto i = ranges::find(
+		_accounts,
+		publicKey,
+		[](const std::unique_ptr<Account> &account) {
+			return account->publicKey;
+		});
+	const auto account = (i != end(_accounts))
+		? not_null<Account*>(i->get())
+		: createAccount(publicKey);
+	if (!account->info) {
+		setupInfo(account, justCreated);
+	}
+	if (_account && _account != account) {
+		_account->info->setVisible(false);
+	}
+	_account = account;
+	_account->info->setVisible(true);
+	_refreshScheduler->setCurrent(_account->address);
+	_layers->raise();
+}
+
+void Window::switchAccount(int index) {
+	if (index >= 0 && index < int(_accounts.size())) {
+		showAccount(_accounts[index]->publicKey);
+	}
+}
+
+void Window::setupAccounts() {
 	_syncing = false;
 	_syncing = _wallet->updates() | rpl::map([](const Ton::Update &update) {
 		return update.data.match([&](const Ton::SyncState &data) {
@@ -410,37 +526,125 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
 		});
 	});
 
-	_window->setTitleStyle(st::walletWindowTitle);
+	setupRefreshScheduler();
+	setupUpdateWithInfo();
+
+	_wallet->updates(
+	) | rpl::filter([](const Ton::Update &update) {
+		return update.data.is<Ton::DecryptPasswordNeeded>();
+	}) | rpl::start_with_next([=](const Ton::Update &update) {
+		askDecryptPassword(update.data.get<Ton::DecryptPasswordNeeded>());
+	}, _accountsLifetime);
+
+	_wallet->updates(
+	) | rpl::filter([](const Ton::Update &update) {
+		return update.data.is<Ton::DecryptPasswordGood>();
+	}) | rpl::start_with_next([=](const Ton::Update &update) {
+		doneDecryptPassword(update.data.get<Ton::DecryptPasswordGood>());
+	}, _accountsLifetime);
+}
+
+auto Window::createAccount(const QByteArray &publicKey)
+-> not_null<Account*> {
+	Expects(_refreshScheduler != nullptr);
+
+	_accounts.push_back(std::make_unique<Account>());
+	const auto account = not_null<Account*>(_accounts.back().get());
+	const auto useTestNetwork = _wallet->settings().useTestNetwork;
+	account->publicKey = publicKey;
+	account->address = _wallet->getUsedAddress(publicKey);
+	account->viewer = _wallet->createAccountViewer(
+		publicKey,
+		account->address);
+	account->localHistory = std::make_unique<LocalHistory>(
+		LocalHistory::ComputePath(
+			_localFolder,
+			account->address,
+			useTestNetwork));
+	if (_commentsSecret.isEmpty()) {
+		_commentsSecret = CommentsCache::LocalSecret(_localFolder);
+	}
+	account->commentsCache = std::make_unique<CommentsCache>(
+		_localFolder,
+		account->address,
+		useTestNetwork,
+		_commentsSecret);
+	account->state = account->viewer->state(
+	) | rpl::map([](Ton::WalletViewerState &&state) {
+		return std::move(state.wallet);
+	});
+
+	auto addresses = _addresses.current();
+	addresses.push_back(account->address);
+	_addresses = std::move(addresses);
+
+	const auto address = account->address;
+	_refreshScheduler->addAccount(address);
+	account->viewer->state(
+	) | rpl::start_with_next([=](const Ton::WalletViewerState &state) {
+		_refreshScheduler->stateChanged(address, state);
+	}, account->lifetime);
+
+	return account;
+}
+
+Window::Account *Window::findAccount(const QString &address) const {
+	const auto i = ranges::find(
+		_accounts,
+		address,
+		[](const std::unique_ptr<Account> &account) {
+			return account->address;
+		});
+	return (i != end(_accounts)) ? i->get() : nullptr;
+}
+
+void Window::setupInfo(not_null<Account*> account, bool justCreated) {
+	Expects(account->info == nullptr);
+
 	auto data = Info::Data();
 	data.justCreated = justCreated;
-	data.state = _viewer->state();
-	data.loaded = _viewer->loaded();
+	data.state = account->viewer->state();
+	data.loaded = loadedSlices(account);
+	data.stored = account->localHistoryLoaded.events();
 	data.updates = _wallet->updates();
-	data.collectEncrypted = _collectEncryptedRequests.events();
-	data.updateDecrypted = _decrypted.events();
+	data.collectEncrypted = account->collectEncryptedRequests.events();
+	data.updateDecrypted = account->decrypted.events();
+	data.collectHistory = account->collectHistoryRequests.events();
+	data.accounts = _addresses.value(
+	) | rpl::map([address = account->address](
+			std::vector<QString> &&addresses) {
+		const auto i = ranges::find(addresses, address);
+		const auto current = int(i - begin(addresses));
+		return TopBarAccounts{ std::move(addresses), current };
+	});
+	data.restoreDecrypted = [=](not_null<Ton::Transaction*> transaction) {
+		return account->commentsCache->restore(transaction);
+	};
 	data.share = shareAddressCallback();
+	data.historyCacheLimit = kHistoryCacheLimit;
 	data.useTestNetwork = _wallet->settings().useTestNetwork;
-	_info = std::make_unique<Info>(_window->body(), std::move(data));
-	_layers->raise();
+	account->info = std::make_unique<Info>(_window->body(), std::move(data));
+	account->info->setGeometry(_infoGeometry);
+	const auto info = account->info.get();
 
-	setupRefreshEach();
+	setupLocalHistory(account);
 
-	_viewer->loaded(
-	) | rpl::filter([](const Ton::Result<Ton::LoadedSlice> &value) {
-		return !value;
+	account->viewer->loaded(
+	) | rpl::filter([=](const Ton::Result<Ton::LoadedSlice> &value) {
+		return !value && (_account == account);
 	}) | rpl::map([](Ton::Result<Ton::LoadedSlice> &&value) {
 		return std::move(value.error());
 	}) | rpl::start_with_next([=](const Ton::Error &error) {
 		showGenericError(error);
-	}, _info->lifetime());
+	}, info->lifetime());
 
-	setupUpdateWithInfo();
-
-	_info->actionRequests(
+	info->actionRequests(
 	) | rpl::start_with_next([=](Action action) {
 		switch (action) {
 		case Action::Refresh: refreshNow(); return;
 		case Action::Export: askExportPassword(); return;
+		case Action::ExportHistory: exportHistory(); return;
+		case Action::Payout: startPayout(); return;
 		case Action::Send: sendGrams(); return;
 		case Action::Receive: receiveGrams(); return;
 		case Action::ChangePassword: changePassword(); return;
@@ -448,14 +652,19 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
 		case Action::LogOut: logoutWithConfirmation(); return;
 		}
 		Unexpected("Action in Info::actionRequests().");
-	}, _info->lifetime());
+	}, info->lifetime());
 
-	_info->preloadRequests(
+	info->switchRequests(
+	) | rpl::start_with_next([=](int index) {
+		switchAccount(index);
+	}, info->lifetime());
+
+	info->preloadRequests(
 	) | rpl::start_with_next([=](const Ton::TransactionId &id) {
-		_viewer->preloadSlice(id);
-	}, _info->lifetime());
+		requestSlice(account, id);
+	}, info->lifetime());
 
-	_info->viewRequests(
+	info->viewRequests(
 	) | rpl::start_with_next([=](Ton::Transaction &&data) {
 		const auto send = [=](const QString &address) {
 			sendGrams(address);
@@ -463,51 +672,70 @@ void Window::showAccount(const QByteArray &publicKey, bool justCreated) {
 		_layers->showBox(Box(
 			ViewTransactionBox,
 			std::move(data),
-			_collectEncryptedRequests.events(),
-			_decrypted.events(),
+			account->collectEncryptedRequests.events(),
+			account->decrypted.events(),
 			shareAddressCallback(),
-			[=] { decryptEverything(publicKey); },
+			[=] { decryptEverything(account); },
 			send));
-	}, _info->lifetime());
+	}, info->lifetime());
 
-	_info->decryptRequests(
+	info->decryptRequests(
 	) | rpl::start_with_next([=] {
-		decryptEverything(publicKey);
-	}, _info->lifetime());
+		decryptEverything(account);
+	}, info->lifetime());
+}
 
-	_wallet->updates(
-	) | rpl::filter([](const Ton::Update &update) {
-		return update.data.is<Ton::DecryptPasswordNeeded>();
-	}) | rpl::start_with_next([=](const Ton::Update &update) {
-		askDecryptPassword(update.data.get<Ton::DecryptPasswordNeeded>());
-	}, _info->lifetime());
+void Window::decryptEverything(not_null<Account*> account) {
+	if (!account->decryptQueue) {
+		auto methods = DecryptQueue::Methods();
+		methods.collect = [=](not_null<DecryptChunk*> chunk) {
+			account->collectEncryptedRequests.fire_copy(chunk);
+		};
+		methods.decrypt = [=](
+				std::vector<Ton::Transaction> &&list,
+				Fn<void(DecryptQueue::Result)> done) {
+			auto tags = Trace::Tags{ account->address };
+			tags.size = int64(list.size());
+			_wallet->decrypt(
+				account->publicKey,
+				std::move(list),
+				Trace::Wrap("decrypt", std::move(tags), std::move(done)));
+		};
+		methods.decrypted = [=](
+				not_null<const std::vector<Ton::Transaction>*> list) {
+			account->commentsCache->save(*list);
+			account->decrypted.fire_copy(list);
+		};
+		methods.failed = [=](const Ton::Error &error) {
+			showGenericError(error);
+		};
+		account->decryptQueue = std::make_unique<DecryptQueue>(
+			std::move(methods));
+	}
+	account->decryptQueue->start();
+}
 
-	_wallet->updates(
-	) | rpl::filter([](const Ton::Update &update) {
-		return update.data.is<Ton::DecryptPasswordGood>();
-	}) | rpl::start_with_next([=](const Ton::Update &update) {
-		doneDecryptPassword(update.data.get<Ton::DecryptPasswordGood>());
-	}, _info->lifetime());
+void Window::restoreDecrypted(not_null<Account*> account) {
+	// Comments shown before the cache was loaded are restored here,
+	// the later ones are restored by the history itself.
+	auto chunk = DecryptChunk{ std::numeric_limits<int>::max() };
+	account->collectEncryptedRequests.fire(&chunk);
+	auto restored = std::vector<Ton::Transaction>();
+	for (auto &transaction : chunk.list) {
+		if (account->commentsCache->restore(&transaction)) {
+			restored.push_back(std::move(transaction));
+		}
+	}
+	if (!restored.empty()) {
+		account->decrypted.fire(&restored);
+	}
 }
 
-void Window::decryptEverything(const QByteArray &publicKey) {
-	auto transactions = std::vector<Ton::Transaction>();
-	_collectEncryptedRequests.fire(&transactions);
-	if (transactions.empty()) {
-		return;
+void Window::unlockComments(const QByteArray &passcode) {
+	// The passcode is the same for all the accounts of the wallet.
+	for (const auto &account : _accounts) {
+		account->commentsCache->unlock(passcode);
 	}
-	const auto done = [=](
-			const Ton::Result<std::vector<Ton::Transaction>> &result) {
-		if (!result) {
-			showGenericError(result.error());
-			return;
-		}
-		_decrypted.fire(&result.value());
-	};
-	_wallet->decrypt(
-		publicKey,
-		std::move(transactions),
-		crl::guard(this, done));
 }
 
 void Window::askDecryptPassword(const Ton::DecryptPasswordNeeded &data) {
@@ -528,6 +756,7 @@ void Window::askDecryptPassword(const Ton::DecryptPasswordNeeded &data) {
 				const QByteArray &passcode,
 				Fn<void(QString)> showError) {
 			_decryptPasswordState->showError = showError;
+			_decryptPasswordState->passcode = passcode;
 			_wallet->updateViewersPassword(key, passcode);
 		});
 		QObject::connect(box, &QObject::destroyed, [=] {
@@ -548,18 +777,71 @@ void Window::doneDecryptPassword(const Ton::DecryptPasswordGood &data) {
 	if (_decryptPasswordState
 		&& _decryptPasswordState->generation < data.generation) {
 		_decryptPasswordState->success = true;
+		unlockComments(_decryptPasswordState->passcode);
 		_decryptPasswordState->box->closeBox();
 	}
 }
 
-void Window::setupUpdateWithInfo() {
-	Expects(_info != nullptr);
+void Window::setupLocalHistory(not_null<Account*> account) {
+	Expects(account->info != nullptr);
+
+	account->localHistory->load([=](
+			std::vector<Ton::TransactionsSlice> &&slices) {
+		for (auto &slice : slices) {
+			account->localHistoryLoaded.fire(std::move(slice));
+		}
+	});
+	account->commentsCache->open([=] {
+		restoreDecrypted(account);
+	});
+
+	account->viewer->state(
+	) | rpl::start_with_next([=](const Ton::WalletViewerState &state) {
+		account->localHistory->save(state.wallet.lastTransactions);
+	}, account->info->lifetime());
+
+	account->viewer->loaded(
+	) | rpl::filter([](const Ton::Result<Ton::LoadedSlice> &value) {
+		return value.has_value();
+	}) | rpl::start_with_next([=](const Ton::Result<Ton::LoadedSlice> &value) {
+		account->localHistory->save(value->data);
+	}, account->info->lifetime());
+}
+
+void Window::requestSlice(
+		not_null<Account*> account,
+		const Ton::TransactionId &id) {
+	account->localHistory->read(id, [=](
+			std::optional<Ton::LoadedSlice> slice) {
+		if (slice) {
+			account->localSliceLoaded.fire(std::move(*slice));
+		} else {
+			account->viewer->preloadSlice(id);
+		}
+	});
+}
+
+auto Window::loadedSlices(not_null<Account*> account) const
+-> rpl::producer<Ton::Result<Ton::LoadedSlice>> {
+	return rpl::merge(
+		account->viewer->loaded(),
+		account->localSliceLoaded.events(
+		) | rpl::map([](Ton::LoadedSlice &&slice) {
+			return Ton::Result<Ton::LoadedSlice>(std::move(slice));
+		}));
+}
 
+void Window::setupUpdateWithInfo() {
 	rpl::combine(
 		_window->body()->sizeValue(),
 		_updateButtonHeight.events() | rpl::flatten_latest()
 	) | rpl::start_with_next([=](QSize size, int height) {
-		_info->setGeometry({ 0, 0, size.width(), size.height() - height });
+		_infoGeometry = { 0, 0, size.width(), size.height() - height };
+		for (const auto &account : _accounts) {
+			if (account->info) {
+				account->info->setGeometry(_infoGeometry);
+			}
+		}
 		if (height > 0) {
 			_updateButton->setGeometry(
 				0,
@@ -567,7 +849,7 @@ void Window::setupUpdateWithInfo() {
 				size.width(),
 				height);
 		}
-	}, _info->lifetime());
+	}, _accountsLifetime);
 
 	if (!_updateInfo) {
 		_updateButtonHeight.fire(rpl::single(0));
@@ -602,50 +884,75 @@ void Window::setupUpdateWithInfo() {
 			}
 			_updateButton.destroy();
 		}
-	}, _info->lifetime());
+	}, _accountsLifetime);
 }
 
-void Window::setupRefreshEach() {
-	Expects(_viewer != nullptr);
-	Expects(_info != nullptr);
-
-	const auto basedOnActivity = _viewer->state(
-	) | rpl::map([] {
-		return (base::SinceLastUserInput() > kRefreshEachDelay)
-			? kRefreshInactiveDelay
-			: kRefreshEachDelay;
-	});
+void Window::setupRefreshScheduler() {
+	auto methods = RefreshScheduler::Methods();
+	methods.setRefreshEach = [=](const QString &address, crl::time delay) {
+		if (const auto account = findAccount(address)) {
+			account->viewer->setRefreshEach(delay);
+		}
+	};
+	methods.refreshNow = [=](const QString &address) {
+		if (const auto account = findAccount(address)) {
+			account->viewer->refreshNow(Trace::Wrap(
+				"refreshNow",
+				{ address, "scheduled" },
+				[](Ton::Result<>) {}));
+		}
+	};
+	_refreshScheduler = std::make_unique<RefreshScheduler>(
+		std::move(methods));
+
+	_refreshScheduler->decisions(
+	) | rpl::start_with_next([=](const RefreshDecision &decision) {
+		WALLET_LOG(("Refresh: %1, %2, backoff %3."
+			).arg(RefreshReasonText(decision.reason)
+			).arg(decision.paused
+				? QString("paused")
+				: QString("each %1 ms").arg(decision.delay)
+			).arg(decision.backoff));
+	}, _accountsLifetime);
 
-	const auto basedOnWindowActive = rpl::single(
+	rpl::single(
 		rpl::empty_value()
 	) | rpl::then(base::qt_signal_producer(
 		_window->windowHandle(),
 		&QWindow::activeChanged
-	)) | rpl::map([=]() -> rpl::producer<crl::time> {
-		if (!_window->isActiveWindow()) {
-			return rpl::single(kRefreshInactiveDelay);
-		}
-		return rpl::duplicate(basedOnActivity);
-	}) | rpl::flatten_latest();
-
-	const auto basedOnPending = _viewer->state(
-	) | rpl::map([=](const Ton::WalletViewerState &state) {
-		return !state.wallet.pendingTransactions.empty();
-	}) | rpl::distinct_until_changed(
-	) | rpl::map([=](bool hasPending) -> rpl::producer<crl::time> {
-		if (hasPending) {
-			return rpl::single(kRefreshWhileSendingDelay);
-		}
-		return rpl::duplicate(basedOnWindowActive);
-	}) | rpl::flatten_latest(
-	);
-
-	rpl::duplicate(
-		basedOnPending
-	) | rpl::distinct_until_changed(
-	) | rpl::start_with_next([=](crl::time delay) {
-		_viewer->setRefreshEach(delay);
-	}, _info->lifetime());
+	)) | rpl::start_with_next([=] {
+		_refreshScheduler->setActive(_window->isActiveWindow());
+	}, _accountsLifetime);
+
+	_window->events(
+	) | rpl::filter([](not_null<QEvent*> e) {
+		return (e->type() == QEvent::WindowStateChange);
+	}) | rpl::start_with_next([=] {
+		_refreshScheduler->setMinimized(_window->isMinimized());
+	}, _accountsLifetime);
+	_refreshScheduler->setMinimized(_window->isMinimized());
+
+	// All the input of the window passes through its native window.
+	const auto filter = base::install_event_filter(
+		_window->windowHandle(),
+		[=](not_null<QEvent*> e) {
+			switch (e->type()) {
+			case QEvent::MouseButtonPress:
+			case QEvent::KeyPress:
+			case QEvent::Wheel:
+			case QEvent::TouchBegin:
+				if (_refreshScheduler) {
+					_refreshScheduler->userInput();
+				}
+				break;
+			default:
+				break;
+			}
+			return base::EventFilterResult::Continue;
+		});
+	_accountsLifetime.add([filter = QPointer<QObject>(filter.get())] {
+		delete filter.data();
+	});
 }
 
 void Window::showAndActivate() {
@@ -664,7 +971,7 @@ not_null<Ui::RpWidget*> Window::widget() const {
 }
 
 bool Window::handleLinkOpen(const QString &link) {
-	if (_viewer && ValidateTransferLink(link)) {
+	if (_account && ValidateTransferLink(link)) {
 		sendGrams(link);
 	}
 	return true;
@@ -691,31 +998,40 @@ void Window::showConfigUpgrade(Ton::ConfigUpgrade upgrade) {
 	}
 }
 
-void Window::sendGrams(const QString &invoice) {
-	if (_sendConfirmBox) {
-		_sendConfirmBox->closeBox();
-	}
-	if (_sendBox) {
-		_sendBox->closeBox();
-	}
-	if (!_state.current().pendingTransactions.empty()) {
+bool Window::ensureCanSend(not_null<Account*> account) {
+	const auto paying = _payout
+		&& (_payout->current().status == Payout::Status::Sending);
+	if (paying || !account->state.current().pendingTransactions.empty()) {
 		showSimpleError(
 			ph::lng_wallet_warning(),
 			ph::lng_wallet_wait_pending(),
 			ph::lng_wallet_ok());
-		return;
+		return false;
 	} else if (_syncing.current()) {
 		showSimpleError(
 			ph::lng_wallet_warning(),
 			ph::lng_wallet_wait_syncing(),
 			ph::lng_wallet_ok());
+		return false;
+	}
+	return true;
+}
+
+void Window::sendGrams(const QString &invoice) {
+	if (_sendConfirmBox) {
+		_sendConfirmBox->closeBox();
+	}
+	if (_sendBox) {
+		_sendBox->closeBox();
+	}
+	if (!ensureCanSend(_account)) {
 		return;
 	}
 	const auto checking = std::make_shared<bool>();
 	const auto send = [=](
 			const PreparedInvoice &invoice,
 			Fn<void(InvoiceField)> showError) {
-		const auto account = _state.current().account;
+		const auto account = _account->state.current().account;
 		const auto available = account.fullBalance - account.lockedBalance;
 		if (!Ton::Wallet::CheckAddress(invoice.address)) {
 			showError(InvoiceField::Address);
@@ -725,7 +1041,7 @@ void Window::sendGrams(const QString &invoice) {
 			confirmTransaction(invoice, showError, checking);
 		}
 	};
-	auto unlockedBalance = _state.value(
+	auto unlockedBalance = _account->state.value(
 	) | rpl::map([](const Ton::WalletState &state) {
 		return state.account.fullBalance - state.account.lockedBalance;
 	});
@@ -766,16 +1082,22 @@ void Window::confirmTransaction(
 			*result,
 			showInvoiceError);
 	};
+	auto tags = Trace::Tags{ _account->address };
+	tags.size = invoice.amount;
 	_wallet->checkSendGrams(
-		_wallet->publicKeys().front(),
+		_account->publicKey,
 		TransactionFromInvoice(invoice),
-		crl::guard(_sendBox.data(), done));
+		Trace::Wrap(
+			"checkSendGrams",
+			std::move(tags),
+			crl::guard(_sendBox.data(), done)));
 }
 
 void Window::askSendPassword(
 		const PreparedInvoice &invoice,
 		Fn<void(InvoiceField)> showInvoiceError) {
-	const auto publicKey = _wallet->publicKeys().front();
+	const auto publicKey = _account->publicKey;
+	const auto address = _account->address;
 	const auto sending = std::make_shared<bool>();
 	const auto ready = [=](
 			const QByteArray &passcode,
@@ -805,7 +1127,10 @@ void Window::askSendPassword(
 			}
 			showSendingTransaction(*result, confirmations->events());
 			_wallet->updateViewersPassword(publicKey, passcode);
-			decryptEverything(publicKey);
+			unlockComments(passcode);
+			if (const auto account = findAccount(address)) {
+				decryptEverything(account);
+			}
 		};
 		const auto sent = [=](Ton::Result<> result) {
 			if (!result) {
@@ -814,12 +1139,14 @@ void Window::askSendPassword(
 			}
 			confirmations->fire({});
 		};
+		auto tags = Trace::Tags{ invoice.address };
+		tags.size = invoice.amount;
 		_wallet->sendGrams(
 			publicKey,
 			passcode,
 			TransactionFromInvoice(invoice),
-			crl::guard(this, ready),
-			crl::guard(this, sent));
+			Trace::Wrap("sendGrams", tags, crl::guard(this, ready)),
+			Trace::Wrap("sendGrams.sent", tags, crl::guard(this, sent)));
 	};
 	if (_sendConfirmBox) {
 		_sendConfirmBox->closeBox();
@@ -837,7 +1164,7 @@ void Window::showSendConfirmation(
 		const PreparedInvoice &invoice,
 		const Ton::TransactionCheckResult &checkResult,
 		Fn<void(InvoiceField)> showInvoiceError) {
-	const auto account = _state.current().account;
+	const auto account = _account->state.current().account;
 	const auto available = account.fullBalance - account.lockedBalance;
 	// This may be enabled in the future, but right now it is not safe.
 	// You could think that you transfer specific amount, but really
@@ -852,7 +1179,7 @@ void Window::showSendConfirmation(
 		return;
 	}
 	const auto confirmed = [=] {
-		if (invoice.address == _address) {
+		if (invoice.address == _account->address) {
 			_layers->showBox(Box([=](not_null<Ui::GenericBox*> box) {
 				box->setTitle(ph::lng_wallet_same_address_title());
 				box->addRow(object_ptr<Ui::FlatLabel>(
@@ -891,7 +1218,7 @@ void Window::showSendingTransaction(
 	}
 	auto box = Box(SendingTransactionBox, std::move(confirmed));
 	_sendBox = box.data();
-	_state.value(
+	_account->state.value(
 	) | rpl::filter([=](const Ton::WalletState &state) {
 		return ranges::find(state.pendingTransactions, transaction)
 			== end(state.pendingTransactions);
@@ -930,8 +1257,8 @@ void Window::showSendingDone(std::optional<Ton::Transaction> result) {
 void Window::receiveGrams() {
 	_layers->showBox(Box(
 		ReceiveGramsBox,
-		_address,
-		TransferLink(_address),
+		_account->address,
+		TransferLink(_account->address),
 		_testnet,
 		[=] { createInvoice(); },
 		shareAddressCallback()));
@@ -940,7 +1267,7 @@ void Window::receiveGrams() {
 void Window::createInvoice() {
 	_layers->showBox(Box(
 		CreateInvoiceBox,
-		_address,
+		_account->address,
 		_testnet,
 		[=](const QString &link) { showInvoiceQr(link); },
 		shareCallback(
@@ -1013,9 +1340,16 @@ void Window::changePassword() {
 			if (*weakBox) {
 				(*weakBox)->closeBox();
 			}
+			unlockComments(old);
+			for (const auto &account : _accounts) {
+				account->commentsCache->changePasscode(now);
+			}
 			showToast(ph::lng_wallet_change_passcode_done(ph::now));
 		};
-		_wallet->changePassword(old, now, crl::guard(this, done));
+		_wallet->changePassword(
+			old,
+			now,
+			Trace::Wrap("changePassword", {}, crl::guard(this, done)));
 	});
 	*weakBox = box.data();
 	_layers->showBox(std::move(box));
@@ -1034,6 +1368,7 @@ void Window::showSettings() {
 		_wallet->settings(),
 		_updateInfo,
 		checkConfig,
+		[=] { exportTrace(); },
 		[=](const Ton::Settings &settings) { saveSettings(settings); });
 	_settingsBox = box.data();
 	_layers->showBox(std::move(box));
@@ -1079,7 +1414,10 @@ void Window::saveSettings(const Ton::Settings &settings) {
 			saveSettingsWithLoaded(copy);
 		});
 	};
-	_wallet->loadWebResource(settings.net().configUrl, loaded);
+	const auto url = settings.net().configUrl;
+	_wallet->loadWebResource(
+		url,
+		Trace::Wrap("loadWebResource", { url, "settings" }, loaded));
 }
 
 void Window::saveSettingsWithLoaded(const Ton::Settings &settings) {
@@ -1096,10 +1434,19 @@ void Window::saveSettingsWithLoaded(const Ton::Settings &settings) {
 		return;
 	}
 	saveSettingsSure(settings, [=] {
+		if (!settings.net().useCustomConfig) {
+			const auto path = ConfigStampPath(
+				_localFolder,
+				settings.useTestNetwork);
+			WriteConfigStamp(path, {
+				settings.net().configUrl,
+				ConfigHash(settings.net().config),
+				base::unixtime::now() });
+		}
 		if (_settingsBox) {
 			_settingsBox->closeBox();
 		}
-		if (_viewer) {
+		if (_account) {
 			refreshNow();
 		}
 	});
@@ -1114,7 +1461,7 @@ void Window::saveSettingsSure(
 		}
 		showGenericError(error);
 	};
-	_wallet->updateSettings(settings, [=](Ton::Result<> result) {
+	const auto updated = [=](Ton::Result<> result) {
 		if (!result) {
 			if (_wallet->publicKeys().empty()) {
 				showCreate();
@@ -1123,15 +1470,22 @@ void Window::saveSettingsSure(
 		} else {
 			done();
 		}
-	});
+	};
+	_wallet->updateSettings(
+		settings,
+		Trace::Wrap("updateSettings", {}, updated));
 }
 
 void Window::refreshNow() {
-	_viewer->refreshNow([=](Ton::Result<> result) {
+	const auto done = [=](Ton::Result<> result) {
 		if (!result) {
 			showGenericError(result.error());
 		}
-	});
+	};
+	_account->viewer->refreshNow(Trace::Wrap(
+		"refreshNow",
+		{ _account->address, "manual" },
+		done));
 }
 
 void Window::showSwitchTestNetworkWarning(const Ton::Settings &settings) {
@@ -1182,6 +1536,7 @@ void Window::showSettingsWithLogoutWarning(
 }
 
 void Window::askExportPassword() {
+	const auto publicKey = _account->publicKey;
 	const auto exporting = std::make_shared<bool>();
 	const auto weakBox = std::make_shared<QPointer<Ui::GenericBox>>();
 	const auto ready = [=](
@@ -1207,7 +1562,7 @@ void Window::askExportPassword() {
 			showExported(*result);
 		};
 		_wallet->exportKey(
-			_wallet->publicKeys().front(),
+			publicKey,
 			passcode,
 			crl::guard(this, ready));
 	};
@@ -1224,6 +1579,291 @@ void Window::showExported(const std::vector<QString> &words) {
 	_layers->showBox(Box(ExportedBox, words));
 }
 
+void Window::exportHistory() {
+	if (_historyExporter || !_account) {
+		return;
+	}
+	const auto filter = QString("CSV Files (*.csv);;JSON Files (*.json)");
+	const auto path = QFileDialog::getSaveFileName(
+		_window.get(),
+		ph::lng_wallet_export_history_title(ph::now),
+		QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation)
+			+ "/wallet_history.csv",
+		filter);
+	if (path.isEmpty()) {
+		return;
+	}
+	const auto account = _account;
+	auto source = HistoryExporter::Source();
+	source.collect = [=](not_null<HistoryChunk*> chunk) {
+		account->collectHistoryRequests.fire_copy(chunk);
+	};
+	source.requestSlice = [=](const Ton::TransactionId &id) {
+		requestSlice(account, id);
+	};
+	source.loaded = loadedSlices(account);
+	_historyExporter = std::make_unique<HistoryExporter>(
+		path,
+		HistoryExporter::FormatFromPath(path),
+		std::move(source));
+	const auto exporter = _historyExporter.get();
+
+	auto box = Box(ExportHistoryBox, exporter->exportedValue());
+	const auto weak = Ui::MakeWeak(box.data());
+	QObject::connect(box, &QObject::destroyed, [=] {
+		// Closing the box cancels the export if it is still running.
+		crl::on_main(this, [=] {
+			_historyExporter = nullptr;
+		});
+	});
+	exporter->finished(
+	) | rpl::start_with_next([=](bool success) {
+		if (weak) {
+			weak->closeBox();
+		}
+		showToast(success
+			? ph::lng_wallet_export_history_done(ph::now)
+			: ph::lng_wallet_export_history_failed(ph::now));
+	}, exporter->lifetime());
+	_layers->showBox(std::move(box));
+	exporter->start();
+}
+
+void Window::startPayout() {
+	if (_payout || !_account || !ensureCanSend(_account)) {
+		return;
+	}
+	const auto path = QFileDialog::getOpenFileName(
+		_window.get(),
+		ph::lng_wallet_payout_title(ph::now),
+		QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
+		QString("CSV Files (*.csv)"));
+	if (path.isEmpty()) {
+		return;
+	}
+	auto file = QFile(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		showToast(ph::lng_wallet_payout_bad_file(ph::now));
+		return;
+	}
+	const auto data = file.readAll();
+	auto parsed = ParsePayoutCsv(data);
+	if (parsed.rows.empty() && parsed.errors.empty()) {
+		showToast(ph::lng_wallet_payout_empty(ph::now));
+		return;
+	}
+	const auto account = _account;
+	const auto publicKey = account->publicKey;
+	const auto address = account->address;
+	const auto passcode = std::make_shared<QByteArray>();
+	const auto passcodeChecked = std::make_shared<bool>();
+	const auto passcodeError = std::make_shared<Fn<void(QString)>>();
+	const auto confirmations = std::make_shared<rpl::lifetime>();
+	const auto closePasscodeBox = [=] {
+		*passcodeError = nullptr;
+		if (_sendConfirmBox) {
+			_sendConfirmBox->closeBox();
+		}
+	};
+	const auto inHistory = [=](const PayoutTransfer &transfer) {
+		// New transfers are on top, the older part is not looked through.
+		auto from = Ton::TransactionId();
+		while (true) {
+			auto chunk = HistoryChunk{ from, kPayoutSearchLimit };
+			account->collectHistoryRequests.fire(&chunk);
+			for (const auto &transaction : chunk.list) {
+				if (IsPayoutTransfer(transaction, transfer)) {
+					return true;
+				} else if (transaction.time + kPayoutSearchMargin
+					< transfer.created) {
+					return false;
+				}
+			}
+			if (chunk.list.empty() || !chunk.previousId.lt) {
+				return false;
+			}
+			from = chunk.previousId;
+		}
+	};
+	auto methods = Payout::Methods();
+	methods.check = [=](
+			const PreparedInvoice &invoice,
+			Fn<void(Ton::Result<Ton::TransactionCheckResult>)> done) {
+		auto tags = Trace::Tags{ address };
+		tags.size = invoice.amount;
+		_wallet->checkSendGrams(
+			publicKey,
+			TransactionFromInvoice(invoice),
+			Trace::Wrap("payout.checkSendGrams", std::move(tags), done));
+	};
+	methods.send = [=](
+			const PreparedInvoice &invoice,
+			Fn<void(Ton::Result<Ton::PendingTransaction>)> ready) {
+		const auto accepted = [=](
+				Ton::Result<Ton::PendingTransaction> result) {
+			if (*passcodeError) {
+				// The first transfer checks the passcode, as a single one.
+				if (!result && IsIncorrectPasswordError(result.error())) {
+					const auto show = *passcodeError;
+					show(ph::lng_wallet_passcode_incorrect(ph::now));
+				} else {
+					closePasscodeBox();
+				}
+			}
+			if (result && !std::exchange(*passcodeChecked, true)) {
+				_wallet->updateViewersPassword(publicKey, *passcode);
+				unlockComments(*passcode);
+				decryptEverything(account);
+			}
+			ready(std::move(result));
+		};
+		const auto sent = [=](Ton::Result<> result) {
+			// The transfer is done once it leaves the pending list.
+			if (!result) {
+				WALLET_LOG(("Payout: sending failed, %1."
+					).arg(result.error().details));
+			}
+		};
+		auto tags = Trace::Tags{ invoice.address };
+		tags.size = invoice.amount;
+		_wallet->sendGrams(
+			publicKey,
+			*passcode,
+			TransactionFromInvoice(invoice),
+			Trace::Wrap("payout.sendGrams", tags, crl::guard(this, accepted)),
+			Trace::Wrap("payout.sendGrams.sent", tags, crl::guard(this, sent)));
+	};
+	methods.find = [=](
+			const PayoutTransfer &transfer,
+			Fn<void(bool)> done) {
+		account->state.value(
+		) | rpl::filter([=](const Ton::WalletState &state) {
+			return ranges::none_of(
+				state.pendingTransactions,
+				[&](const Ton::PendingTransaction &pending) {
+					return IsPayoutTransfer(pending.fake, transfer);
+				});
+		}) | rpl::take(
+			1
+		) | rpl::start_with_next([=](const Ton::WalletState &state) {
+			const auto &list = state.lastTransactions.list;
+			const auto found = ranges::any_of(list, [&](
+					const Ton::Transaction &transaction) {
+				return IsPayoutTransfer(transaction, transfer);
+			});
+
+			// The history gets the same state, look it through after that.
+			crl::on_main(this, [=] {
+				done(found || inHistory(transfer));
+			});
+		}, *confirmations);
+	};
+	_payout = std::make_unique<Payout>(
+		std::move(parsed),
+		(_localFolder.isEmpty()
+			? QString()
+			: Payout::ProgressPath(_localFolder, address, data)),
+		std::move(methods));
+
+	const auto send = [=] {
+		if (!ensureCanSend(account)) {
+			return;
+		}
+		auto box = Box(EnterPasscodeBox, [=](
+				const QByteArray &value,
+				Fn<void(QString)> showError) {
+			if (!_payout
+				|| _payout->current().status == Payout::Status::Sending) {
+				return;
+			}
+			*passcode = value;
+			*passcodeChecked = false;
+			*passcodeError = showError;
+			_payout->send();
+		});
+
+		// Closed when the first transfer is accepted or the payout stops
+		// for any other reason than a wrong passcode.
+		_payout->state(
+		) | rpl::filter([=](const Payout::State &state) {
+			return *passcodeError
+				&& (state.status != Payout::Status::Sending)
+				&& !(state.sendError
+					&& IsIncorrectPasswordError(*state.sendError));
+		}) | rpl::start_with_next([=](const Payout::State &) {
+			closePasscodeBox();
+		}, box->lifetime());
+		QObject::connect(box, &QObject::destroyed, [=] {
+			*passcodeError = nullptr;
+		});
+		_sendConfirmBox = box.data();
+		_layers->showBox(std::move(box));
+	};
+	const auto pause = [=] {
+		if (_payout) {
+			_payout->pause();
+		}
+	};
+	auto unlockedBalance = account->state.value(
+	) | rpl::map([](const Ton::WalletState &state) {
+		return state.account.fullBalance - state.account.lockedBalance;
+	});
+	auto box = Box(
+		PayoutBox,
+		_payout->state(),
+		std::move(unlockedBalance),
+		send,
+		pause);
+	QObject::connect(box, &QObject::destroyed, [=] {
+		crl::on_main(this, [=] {
+			releasePayout();
+		});
+	});
+	_layers->showBox(std::move(box));
+	_payout->estimate();
+}
+
+void Window::releasePayout() {
+	if (!_payout) {
+		return;
+	} else if (_payout->current().status != Payout::Status::Sending) {
+		_payout = nullptr;
+		return;
+	}
+
+	// Let the transfer being sent reach the progress file first.
+	_payout->pause();
+	_payout->state(
+	) | rpl::filter([](const Payout::State &state) {
+		return (state.status != Payout::Status::Sending);
+	}) | rpl::take(
+		1
+	) | rpl::start_with_next([=](const Payout::State &) {
+		crl::on_main(this, [=] {
+			_payout = nullptr;
+		});
+	}, _payout->lifetime());
+}
+
+void Window::exportTrace() {
+	const auto path = QFileDialog::getSaveFileName(
+		_window.get(),
+		ph::lng_wallet_export_trace_title(ph::now),
+		QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation)
+			+ "/wallet_trace.json",
+		QString("JSON Files (*.json)"));
+	if (path.isEmpty()) {
+		return;
+	}
+	const auto data = Trace::ExportJson();
+	auto file = QFile(path);
+	const auto success = file.open(QIODevice::WriteOnly)
+		&& (file.write(data) == data.size());
+	showToast(success
+		? ph::lng_wallet_export_trace_done(ph::now)
+		: ph::lng_wallet_export_trace_failed(ph::now));
+}
+
 void Window::logoutWithConfirmation() {
 	_layers->showBox(Box(DeleteWalletBox, [=] { logout(); }));
 }
@@ -1234,6 +1874,12 @@ void Window::logout() {
 			showGenericError(result.error());
 			return;
 		}
+		for (const auto &account : _accounts) {
+			account->localHistory->remove();
+			account->commentsCache->remove();
+		}
+		CommentsCache::RemoveLocalSecret(_localFolder);
+		_commentsSecret = QByteArray();
 		showCreate();
 	}));
 }
@@ -14,7 +14,6 @@
 
 namespace Ton {
 class Wallet;
-class AccountViewer;
 struct TransactionCheckResult;
 struct PendingTransaction;
 struct Transaction;
@@ -37,14 +36,30 @@ namespace Create {
 class Manager;
 } // namespace Create
 
+class Backend;
 class Info;
+class LocalHistory;
+class CommentsCache;
+class HistoryExporter;
+class Payout;
+class DecryptQueue;
+class RefreshScheduler;
+struct DecryptChunk;
+struct HistoryChunk;
 struct PreparedInvoice;
 enum class InvoiceField;
 class UpdateInfo;
 
 class Window final : public base::has_weak_ptr {
 public:
-	Window(not_null<Ton::Wallet*> wallet, UpdateInfo *updateInfo = nullptr);
+	Window(
+		not_null<Ton::Wallet*> wallet,
+		UpdateInfo *updateInfo = nullptr,
+		const QString &localFolder = QString());
+	Window(
+		std::unique_ptr<Backend> backend,
+		UpdateInfo *updateInfo = nullptr,
+		const QString &localFolder = QString());
 	~Window();
 
 	void showAndActivate();
@@ -53,9 +68,11 @@ public:
 	void showConfigUpgrade(Ton::ConfigUpgrade upgrade);
 
 private:
+	struct Account;
 	struct DecryptPasswordState {
 		int generation = 0;
 		bool success = false;
+		QByteArray passcode;
 		QPointer<Ui::GenericBox> box;
 		Fn<void(QString)> showError;
 	};
@@ -88,13 +105,27 @@ private:
 		const QString &address,
 		std::shared_ptr<bool> guard);
 
-	void decryptEverything(const QByteArray &publicKey);
+	void decryptEverything(not_null<Account*> account);
+	void restoreDecrypted(not_null<Account*> account);
+	void unlockComments(const QByteArray &passcode);
 	void askDecryptPassword(const Ton::DecryptPasswordNeeded &data);
 	void doneDecryptPassword(const Ton::DecryptPasswordGood &data);
 
 	void showAccount(const QByteArray &publicKey, bool justCreated = false);
+	void switchAccount(int index);
+	void setupAccounts();
+	not_null<Account*> createAccount(const QByteArray &publicKey);
+	[[nodiscard]] Account *findAccount(const QString &address) const;
+	void setupInfo(not_null<Account*> account, bool justCreated);
+	void setupLocalHistory(not_null<Account*> account);
+	void requestSlice(
+		not_null<Account*> account,
+		const Ton::TransactionId &id);
+	[[nodiscard]] auto loadedSlices(not_null<Account*> account) const
+		-> rpl::producer<Ton::Result<Ton::LoadedSlice>>;
 	void setupUpdateWithInfo();
-	void setupRefreshEach();
+	void setupRefreshScheduler();
+	[[nodiscard]] bool ensureCanSend(not_null<Account*> account);
 	void sendGrams(const QString &invoice = QString());
 	void confirmTransaction(
 		const PreparedInvoice &invoice,
@@ -118,6 +149,10 @@ private:
 	void changePassword();
 	void askExportPassword();
 	void showExported(const std::vector<QString> &words);
+	void exportHistory();
+	void startPayout();
+	void releasePayout();
+	void exportTrace();
 	void showSettings();
 	void checkConfigFromContent(QByteArray bytes, Fn<void(QByteArray)> good);
 	void saveSettings(const Ton::Settings &settings);
@@ -139,29 +174,32 @@ private:
 	// Before _layers, because box destructor can set this pointer.
 	std::unique_ptr<DecryptPasswordState> _decryptPasswordState;
 
-	const not_null<Ton::Wallet*> _wallet;
+	const std::unique_ptr<Backend> _wallet;
 	const std::unique_ptr<Ui::Window> _window;
 	const std::unique_ptr<Ui::LayerManager> _layers;
 	UpdateInfo * const _updateInfo = nullptr;
+	const QString _localFolder;
+	QByteArray _commentsSecret;
 
 	std::unique_ptr<Create::Manager> _createManager;
 	rpl::event_stream<QString> _createSyncing;
 	bool _importing = false;
 	bool _testnet = false;
 
-	QString _address;
-	std::unique_ptr<Ton::AccountViewer> _viewer;
-	rpl::variable<Ton::WalletState> _state;
+	// Accounts of all the keys, the ones shown once keep their Info
+	// hidden while another one is shown, so switching back is instant.
+	std::unique_ptr<RefreshScheduler> _refreshScheduler;
+	std::vector<std::unique_ptr<Account>> _accounts;
+	Account *_account = nullptr;
+	rpl::variable<std::vector<QString>> _addresses;
 	rpl::variable<bool> _syncing;
-	std::unique_ptr<Info> _info;
+	QRect _infoGeometry;
+	rpl::lifetime _accountsLifetime;
+	std::unique_ptr<HistoryExporter> _historyExporter;
+	std::unique_ptr<Payout> _payout;
 	object_ptr<Ui::FlatButton> _updateButton = { nullptr };
 	rpl::event_stream<rpl::producer<int>> _updateButtonHeight;
 
-	rpl::event_stream<
-		not_null<std::vector<Ton::Transaction>*>> _collectEncryptedRequests;
-	rpl::event_stream<
-		not_null<const std::vector<Ton::Transaction>*>> _decrypted;
-
 	QPointer<Ui::GenericBox> _sendBox;
 	QPointer<Ui::GenericBox> _sendConfirmBox;
 	QPointer<Ui::GenericBox> _simpleErrorBox;